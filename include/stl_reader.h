@@ -30,6 +30,13 @@
  * whether an *ASCII* or a *Binary* file is to be read. It identifies matching corner
  * coordinates of triangles with each other, so that the resulting coordinate
  * array does not contain the same coordinate-triple multiple times.
+ * Through `ReadOptions` one may choose a hash based algorithm for this step,
+ * which can also merge corners that only match up to a tolerance.
+ *
+ * Files compressed with gzip (e.g. `geometry.stl.gz`) or zlib are read as they
+ * are. They are inflated on a separate thread, while the triangle records of
+ * binary files are decoded as soon as they become available. The gzip CRC-32
+ * and size or the zlib Adler-32 of the inflated data are checked afterwards.
  *
  * The function operates on template container types. Those containers should
  * have similar interfaces as `std::vector` and operate on `float` or `double` types
@@ -128,11 +135,44 @@
 #define __H__STL_READER
 
 #include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
 #include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include <vector>
 
+//	Memory mapping is used for reading binary files on POSIX systems. Define
+//	STL_READER_NO_MMAP to read the whole file into memory instead.
+//	(windows.h is deliberately not included, since it clashes with raylib.h)
+//	Numbers in ascii files are parsed with std::from_chars where available.
+#if __cplusplus >= 201703L && defined(__has_include)
+	#if __has_include(<charconv>)
+		#include <charconv>
+		#if defined(__cpp_lib_to_chars)
+			#define STL_READER_USE_FROM_CHARS
+		#endif
+	#endif
+#endif
+
+#if !defined(STL_READER_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+	#define STL_READER_USE_MMAP
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/resource.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
 #ifdef STL_READER_NO_EXCEPTIONS
 	#define STL_READER_THROW(msg) return false;
 	#define STL_READER_COND_THROW(cond, msg) if(cond) return false;
@@ -147,6 +187,99 @@
 
 namespace stl_reader {
 
+/// Algorithms which identify matching triangle corners with each other
+enum WeldMode {
+	/// sorts all corners and merges corners with identical coordinates.
+	/** Vertices are ordered by their coordinates.*/
+	WELD_SORT,
+
+	/// merges corners through a spatial hash in O(n), optionally with a tolerance.
+	/** Corners are merged if their coordinates are identical or, if
+	 * ReadOptions::weldEpsilon is positive, if they lie within about
+	 * weldEpsilon of each other. Vertices are ordered by their first
+	 * occurrence in the file. Work is distributed over ReadOptions::numThreads
+	 * threads by hash partition, the result does not depend on the number of
+	 * threads.*/
+	WELD_HASH
+};
+
+/// Peak resident set size of the process during the stages of a read, in bytes
+/** Filled if ReadOptions::stats is set. Each public read function resets the
+ * peak when it starts, which only works on Linux. Elsewhere, each value is the
+ * peak of the process up to the end of the stage. Values are 0 if the
+ * platform does not provide them. Stages which do not occur in a read are
+ * left untouched.*/
+struct ReadStats {
+	ReadStats () :
+		inflatePeakRss (0),
+		parsePeakRss (0),
+		weldPeakRss (0),
+		outputPeakRss (0),
+		spilledBytes (0)
+	{}
+
+	/// inflating compressed data which is not decoded while it is inflated
+	size_t	inflatePeakRss;
+
+	/// decoding triangles. Includes inflating, where both overlap.
+	size_t	parsePeakRss;
+
+	/// merging corners. Equals parsePeakRss with ReadOptions::lowMemory.
+	size_t	weldPeakRss;
+
+	/// reading spilled triangles back. Only with ReadOptions::lowMemory.
+	size_t	outputPeakRss;
+
+	/// number of bytes written to temporary files
+	size_t	spilledBytes;
+};
+
+/// Options which control how a stl file is read
+/** The default options read the file serially, exactly as earlier versions
+ * of this reader did.*/
+struct ReadOptions {
+	ReadOptions () :
+		numThreads (1),
+		weldMode (WELD_SORT),
+		weldEpsilon (0),
+		readNormals (true),
+		lowMemory (false),
+		memoryBudget (0),
+		stats (NULL)
+	{}
+
+	/// number of threads used to decode triangles. 0 uses all hardware threads.
+	/** ASCII files are split at `facet` boundaries for this purpose.*/
+	unsigned int	numThreads;
+
+	/// algorithm used to merge matching triangle corners.
+	WeldMode		weldMode;
+
+	/// corners closer than this distance are merged. Only used with WELD_HASH.
+	double			weldEpsilon;
+
+	/// if false, normalsOut is returned empty.
+	bool			readNormals;
+
+	/// reads with low peak memory.
+	/** Corners are merged one triangle after the other while the file is
+	 * decoded, instead of collecting all corners first. This works like
+	 * WELD_HASH, whatever the weldMode, and yields the same result, but on a
+	 * single thread. The parts of a file which have been decoded are released
+	 * from memory. Compressed data is still inflated completely.*/
+	bool			lowMemory;
+
+	/// memory budget in bytes for lowMemory reads. 0 means no budget.
+	/** Whenever vertices, triangles and normals exceed the budget, triangles
+	 * and normals are moved to temporary files. They are read back once all
+	 * corners are merged and the lookup tables are released. Vertices are
+	 * always kept in memory.*/
+	size_t			memoryBudget;
+
+	/// receives the peak memory of each stage if not NULL.
+	ReadStats*		stats;
+};
+
 /// Reads an ASCII or binary stl file into several arrays
 /** Reads a stl file and writes its coordinates, normals and triangle-corner-indices
  * to the provided containers. It also fills a container solidRangesOut, which
@@ -154,6 +287,8 @@ namespace stl_reader {
  *
  * Double vertex entries are removed on the fly, so that triangle corners with
  * equal coordinates are represented by a single coordinate entry in coordsOut.
+ * With WELD_HASH and a positive weldEpsilon in options, corners which are
+ * closer than the tolerance are merged, too (see WeldMode).
  * 
  *
  * \param filename	[in] The name of the file which shall be read
@@ -186,6 +321,10 @@ namespace stl_reader {
  *							The type TIndexContainer should have the same interface
  *							as std::vector<size_t>.
  *
+ * \param options	[in] Controls e.g. the number of threads used for reading
+ *					and how corners are merged. See ReadOptions. The result
+ *					does not depend on the number of threads.
+ *
  * \returns		true if the file was successfully read into the provided container.
  */
 template <class TNumberContainer1, class TNumberContainer2,
@@ -194,7 +333,8 @@ bool ReadStlFile(const char* filename,
                 TNumberContainer1& coordsOut,
                 TNumberContainer2& normalsOut,
                 TIndexContainer1& trisOut,
-				TIndexContainer2& solidRangesOut);
+				TIndexContainer2& solidRangesOut,
+                const ReadOptions& options = ReadOptions());
 
 
 /// Reads an ASCII stl file into several arrays
@@ -207,7 +347,39 @@ bool ReadStlFile_ASCII(const char* filename,
                        TNumberContainer1& coordsOut,
                        TNumberContainer2& normalsOut,
                        TIndexContainer1& trisOut,
-					   TIndexContainer2& solidRangesOut);
+					   TIndexContainer2& solidRangesOut,
+                       const ReadOptions& options = ReadOptions());
+
+/// Reads ASCII or binary stl data from a memory buffer into several arrays
+/** The buffer has to contain the complete file. Its format is determined
+ * with StlBufferHasASCIIFormat. Compressed buffers are decompressed first,
+ * see StlBufferIsCompressed.
+ * \copydetails ReadStlFile
+ * \sa ReadStlFile, ReadStlBuffer_ASCII, ReadStlBuffer_BINARY
+ */
+template <class TNumberContainer1, class TNumberContainer2,
+		  class TIndexContainer1, class TIndexContainer2>
+bool ReadStlBuffer(const char* buffer,
+                   size_t bufferSize,
+                   TNumberContainer1& coordsOut,
+                   TNumberContainer2& normalsOut,
+                   TIndexContainer1& trisOut,
+                   TIndexContainer2& solidRangesOut,
+                   const ReadOptions& options = ReadOptions());
+
+/// Reads ASCII stl data from a memory buffer into several arrays
+/** \copydetails ReadStlFile
+ * \sa ReadStlFile_ASCII
+ */
+template <class TNumberContainer1, class TNumberContainer2,
+		  class TIndexContainer1, class TIndexContainer2>
+bool ReadStlBuffer_ASCII(const char* buffer,
+                         size_t bufferSize,
+                         TNumberContainer1& coordsOut,
+                         TNumberContainer2& normalsOut,
+                         TIndexContainer1& trisOut,
+                         TIndexContainer2& solidRangesOut,
+                         const ReadOptions& options = ReadOptions());
 
 /// Reads a binary stl file into several arrays
 /** \copydetails ReadStlFile
@@ -220,15 +392,45 @@ bool ReadStlFile_BINARY(const char* filename,
                         TNumberContainer1& coordsOut,
                         TNumberContainer2& normalsOut,
                         TIndexContainer1& trisOut,
-					    TIndexContainer2& solidRangesOut);
+					    TIndexContainer2& solidRangesOut,
+                        const ReadOptions& options = ReadOptions());
+
+/// Reads binary stl data from a memory buffer into several arrays
+/** The buffer has to contain the complete file, i.e. the 80 byte header,
+ * the triangle count and the 50 byte triangle records.
+ * \copydetails ReadStlFile
+ * \sa ReadStlFile_BINARY
+ */
+template <class TNumberContainer1, class TNumberContainer2,
+		  class TIndexContainer1, class TIndexContainer2>
+bool ReadStlBuffer_BINARY(const char* buffer,
+                          size_t bufferSize,
+                          TNumberContainer1& coordsOut,
+                          TNumberContainer2& normalsOut,
+                          TIndexContainer1& trisOut,
+                          TIndexContainer2& solidRangesOut,
+                          const ReadOptions& options = ReadOptions());
 
 /// Determines whether a stl file has ASCII format
-/** The underlying mechanism is simply checks whether the provided file starts
- * with the keyword solid. This should work for many stl files, but may
- * fail, of course.
+/** A file whose size matches `84 + 50 * numTris` exactly, where numTris is
+ * the triangle count stored at byte 80, is considered binary, even if its
+ * header starts with `solid` (as written by several exporters).
+ * Otherwise the file is considered to be ASCII if it starts with the keyword
+ * solid. This should work for most stl files, but may fail, of course.
  */
 inline bool StlFileHasASCIIFormat(const char* filename);
 
+/// Determines whether stl data in a memory buffer has ASCII format
+/** The buffer has to contain the complete file.
+ * \sa StlFileHasASCIIFormat*/
+inline bool StlBufferHasASCIIFormat(const char* buffer, size_t bufferSize);
+
+/// Determines whether a memory buffer holds gzip or zlib compressed data
+/** Such buffers and files are decompressed transparently by ReadStlFile and
+ * ReadStlBuffer. A buffer with zlib header bytes which has the exact layout
+ * of a binary stl file is considered uncompressed.*/
+inline bool StlBufferIsCompressed(const char* buffer, size_t bufferSize);
+
 
 ///	convenience mesh class which makes accessing the stl data more easy
 template <class TNumber = float, class TIndex = unsigned int>
@@ -251,11 +453,16 @@ public:
 	{
 		read_file (filename);
 	}
+
+	StlMesh (const char* filename, const ReadOptions& options)
+	{
+		read_file (filename, options);
+	}
 	/** \} */
 
 	/// fills the mesh with the contents of the specified stl-file
 	/** \{ */
-	bool read_file (const char* filename)
+	bool read_file (const char* filename, const ReadOptions& options = ReadOptions())
 	{
 		bool res = false;
 
@@ -263,7 +470,7 @@ public:
 		try {
 		#endif
 
-			res = ReadStlFile (filename, coords, normals, tris, solids);
+			res = ReadStlFile (filename, coords, normals, tris, solids, options);
 
 		#ifndef STL_READER_NO_EXCEPTIONS
 		} catch (std::exception& e) {
@@ -281,9 +488,9 @@ public:
 		return res;
 	}
 
-	bool read_file (const std::string& filename)
+	bool read_file (const std::string& filename, const ReadOptions& options = ReadOptions())
 	{
-		return read_file (filename.c_str());
+		return read_file (filename.c_str(), options);
 	}
 	/** \} */
 
@@ -408,6 +615,127 @@ private:
 };
 
 
+/// Reads a stl file batch by batch, so that arbitrarily large files can be processed
+/** In contrast to ReadStlFile, the whole mesh is never held in memory. Triangles
+ * are handed out in batches of at most `batchSize` triangles, each batch
+ * belonging to a single solid. Triangle corners are *not* merged, each triangle
+ * provides its own 3 corner coordinates. The file may also be a pipe, or stdin
+ * if "-" is passed as filename.
+ *
+ * \code
+ *	stl_reader::StlStreamReader <float> reader ("huge.stl");
+ *	while(reader.read_batch ()) {
+ *		for(size_t itri = 0; itri < reader.num_tris(); ++itri) {
+ *			const float* c0 = reader.tri_corner_coords (itri, 0);
+ *			const float* n = reader.tri_normal (itri);
+ *			// ...
+ *		}
+ *	}
+ * \endcode
+ *
+ * If exceptions are disabled, open and read_batch return `false` on errors.
+ */
+template <class TNumber = float>
+class StlStreamReader {
+public:
+	/// creates a reader which is not associated with a stream
+	StlStreamReader (size_t batchSize = 65536);
+
+	/// opens the given file (or stdin for "-")
+	StlStreamReader (const char* filename, size_t batchSize = 65536);
+
+	/// reads from an already opened stream, which has to outlive the reader
+	StlStreamReader (std::istream& in, size_t batchSize = 65536);
+
+	/// opens the given file (or stdin for "-") and determines its format
+	/** \{ */
+	bool open (const char* filename);
+	bool open (std::istream& in);
+	/** \} */
+
+	/// reads the next batch of triangles
+	/** \returns false if there are no more triangles.*/
+	bool read_batch ();
+
+	/// returns true if the stream contains ASCII stl data
+	bool is_ascii () const						{return m_ascii;}
+
+	/// returns the number of triangles in the current batch
+	size_t num_tris () const					{return m_normals.size() / 3;}
+
+	/// returns the 3 coordinates of the corner `0<=ci<3` of triangle ti of the current batch
+	const TNumber* tri_corner_coords (const size_t ti, const size_t ci) const
+	{
+		return &m_coords [ti * 9 + ci * 3];
+	}
+
+	/// returns the 3 components of the normal of triangle ti of the current batch
+	const TNumber* tri_normal (const size_t ti) const
+	{
+		return &m_normals [ti * 3];
+	}
+
+	/// returns the index of the solid to which all triangles of the current batch belong
+	size_t solid_index () const					{return m_solid;}
+
+	/// returns the number of triangles read so far, including the current batch
+	size_t num_tris_read () const				{return m_numTrisRead;}
+
+	/// returns the corner coordinates of the current batch, containing `num_tris()*9` entries.
+	/** Storage layout: `t0c0x,t0c0y,t0c0z,t0c1x,...,t0c2z,t1c0x,...`*/
+	const TNumber* raw_coords () const			{return m_coords.empty() ? NULL : &m_coords[0];}
+
+	/// returns the normals of the current batch, containing `num_tris()*3` entries.
+	const TNumber* raw_normals () const			{return m_normals.empty() ? NULL : &m_normals[0];}
+
+private:
+	StlStreamReader (const StlStreamReader&);
+	StlStreamReader& operator = (const StlStreamReader&);
+
+	bool fill_buffer ();
+	bool read_binary_batch ();
+	bool read_ascii_batch ();
+
+	std::ifstream			m_file;
+	std::istream*			m_in;
+	size_t					m_batchSize;
+	bool					m_ascii;
+
+	std::vector<TNumber>	m_coords;
+	std::vector<TNumber>	m_normals;
+	size_t					m_solid;
+	size_t					m_nextSolid;
+	size_t					m_numTrisRead;
+
+//	input buffer. Bytes in [m_bufPos, m_bufEnd) have not been processed yet.
+	std::vector<char>		m_buf;
+	size_t					m_bufPos;
+	size_t					m_bufEnd;
+	bool					m_eof;
+
+//	binary state
+	size_t					m_numBinaryTrisLeft;
+
+//	ascii state
+	size_t					m_lineCount;
+	size_t					m_numFaceVrts;
+	bool					m_solidSeen;
+	TNumber					m_facet[12];	// normal and the 3 corners of the current facet
+};
+
+
+/// Reads a stl file batch by batch and passes each batch to a callback
+/** The callback is called as
+ * \code
+ *	callback (const TNumber* coords, const TNumber* normals, size_t numTris, size_t solidIndex)
+ * \endcode
+ * where coords and normals have the layout described in StlStreamReader.
+ * \sa StlStreamReader
+ */
+template <class TNumber, class TCallback>
+bool ReadStlFileBatches (const char* filename, TCallback callback, size_t batchSize = 65536);
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //	IMPLEMENTATION
 ////////////////////////////////////////////////////////////////////////////////
@@ -443,8 +771,429 @@ namespace stl_reader_impl {
 		inline number_t operator [] (const size_t i) const	{return data[i];}
 	};
 
+	// Read-only view of the contents of a file. The file is memory mapped where
+	// possible, otherwise its contents are read into an internal buffer.
+	class MappedFile {
+	public:
+		MappedFile () : m_data (NULL), m_size (0), m_mapped (false)	{}
+		~MappedFile ()	{close ();}
+
+		bool open (const char* filename)
+		{
+			close ();
+			#ifdef STL_READER_USE_MMAP
+				int fd = ::open (filename, O_RDONLY);
+				if(fd < 0)
+					return false;
+
+				struct stat st;
+				if(fstat (fd, &st) != 0){
+					::close (fd);
+					return false;
+				}
+
+				m_size = static_cast<size_t> (st.st_size);
+				if(m_size > 0){
+					void* p = mmap (NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+					if(p != MAP_FAILED){
+						madvise (p, m_size, MADV_SEQUENTIAL);
+						m_data = static_cast<const char*> (p);
+						m_mapped = true;
+					}
+				}
+				::close (fd);
+				if(m_mapped || m_size == 0)
+					return true;
+			#endif
+
+			std::ifstream in (filename, std::ios::binary);
+			if(!in)
+				return false;
+			in.seekg (0, std::ios::end);
+			m_size = static_cast<size_t> (in.tellg ());
+			in.seekg (0, std::ios::beg);
+			m_buffer.resize (m_size);
+			if(m_size > 0 && !in.read (&m_buffer[0], m_size)){
+				close ();
+				return false;
+			}
+			m_data = m_buffer.empty () ? NULL : &m_buffer[0];
+			return true;
+		}
+
+		void close ()
+		{
+			#ifdef STL_READER_USE_MMAP
+				if(m_mapped)
+					munmap (const_cast<char*> (m_data), m_size);
+			#endif
+			std::vector<char> ().swap (m_buffer);
+			m_data = NULL;
+			m_size = 0;
+			m_mapped = false;
+		}
+
+		const char* data () const	{return m_data;}
+		size_t size () const		{return m_size;}
+
+		// drops the pages of [begin, end) from memory. Mapped pages are read
+		// from the file again if they are accessed later on.
+		void release (const char* begin, const char* end)
+		{
+			#ifdef STL_READER_USE_MMAP
+				if(!m_mapped)
+					return;
+				const size_t pageSize = static_cast<size_t> (sysconf (_SC_PAGESIZE));
+				const size_t first = (static_cast<size_t> (begin - m_data) + pageSize - 1) / pageSize * pageSize;
+				const size_t last = static_cast<size_t> (end - m_data) / pageSize * pageSize;
+				if(first < last)
+					madvise (const_cast<char*> (m_data) + first, last - first, MADV_DONTNEED);
+			#else
+				(void) begin;
+				(void) end;
+			#endif
+		}
+
+	private:
+		MappedFile (const MappedFile&);
+		MappedFile& operator = (const MappedFile&);
+
+		const char*			m_data;
+		size_t				m_size;
+		bool				m_mapped;
+		std::vector<char>	m_buffer;
+	};
+
+	// peak resident set size of the process in bytes, or 0 if unknown
+	inline size_t PeakRss ()
+	{
+		#if defined(__linux__)
+			std::ifstream status ("/proc/self/status");
+			std::string line;
+			while(std::getline (status, line)){
+				if(line.compare (0, 6, "VmHWM:") == 0)
+					return static_cast<size_t> (atoll (line.c_str() + 6)) * 1024;
+			}
+			return 0;
+		#elif defined(STL_READER_USE_MMAP)
+			struct rusage usage;
+			if(getrusage (RUSAGE_SELF, &usage) != 0)
+				return 0;
+			#ifdef __APPLE__
+				return static_cast<size_t> (usage.ru_maxrss);
+			#else
+				return static_cast<size_t> (usage.ru_maxrss) * 1024;
+			#endif
+		#else
+			return 0;
+		#endif
+	}
+
+	// sets the peak resident set size to the current one, if supported
+	inline void ResetPeakRss (const ReadOptions& options)
+	{
+		#if defined(__linux__)
+			if(options.stats){
+				std::ofstream clearRefs ("/proc/self/clear_refs");
+				clearRefs << "5";
+			}
+		#else
+			(void) options;
+		#endif
+	}
+
+	// stores the peak of the finished stage and starts the next one
+	inline void RecordPeakRss (const ReadOptions& options, size_t ReadStats::* stage)
+	{
+		if(options.stats){
+			options.stats->*stage = PeakRss ();
+			ResetPeakRss (options);
+		}
+	}
+
+	// size of the binary stl header (80 bytes header + 4 bytes triangle count)
+	// and of a single triangle record (normal, 3 corners, attribute byte count)
+	const size_t BINARY_HEADER_SIZE = 84;
+	const size_t BINARY_TRI_SIZE = 50;
+
+	// reads the little endian triangle count of a binary stl buffer.
+	// Returns false if the buffer is too small to hold a header.
+	inline bool BinaryTriangleCount (const char* data, size_t size, size_t& numTrisOut)
+	{
+		if(size < BINARY_HEADER_SIZE)
+			return false;
+		unsigned char c[4];
+		memcpy (c, data + 80, 4);
+		numTrisOut =	 static_cast<size_t> (c[0])
+					| (static_cast<size_t> (c[1]) << 8)
+					| (static_cast<size_t> (c[2]) << 16)
+					| (static_cast<size_t> (c[3]) << 24);
+		return true;
+	}
+
+	// returns true if the buffer size matches 84 + 50 * numTris exactly
+	inline bool HasBinaryLayout (const char* data, size_t size)
+	{
+		size_t numTris;
+		if(!BinaryTriangleCount (data, size, numTris))
+			return false;
+		return (size - BINARY_HEADER_SIZE) % BINARY_TRI_SIZE == 0
+			&& (size - BINARY_HEADER_SIZE) / BINARY_TRI_SIZE == numTris;
+	}
+
+	// number of threads which shall be used for numThreads (0 means all
+	// hardware threads) and a workload of n items.
+	inline unsigned int NumWorkerThreads (unsigned int numThreads, size_t n,
+	                                      size_t minItemsPerThread)
+	{
+		if(numThreads == 0)
+			numThreads = std::max (std::thread::hardware_concurrency (), 1u);
+		const size_t maxThreads = std::max<size_t> (n / minItemsPerThread, 1);
+		return static_cast<unsigned int> (std::min<size_t> (numThreads, maxThreads));
+	}
+
+	// splits [0, n) into numChunks contiguous chunks and calls
+	// func(chunk, begin, end) for each chunk on its own thread.
+	template <class TFunc>
+	void ParallelForChunks (size_t n, unsigned int numChunks, TFunc func)
+	{
+		if(numChunks <= 1){
+			func (size_t(0), size_t(0), n);
+			return;
+		}
+
+		std::vector<std::thread> threads;
+		threads.reserve (numChunks - 1);
+		for(size_t i = 1; i < numChunks; ++i)
+			threads.push_back (std::thread (func, i, i * n / numChunks, (i + 1) * n / numChunks));
+
+		func (size_t(0), size_t(0), n / numChunks);
+
+		for(size_t i = 0; i < threads.size(); ++i)
+			threads[i].join ();
+	}
+
+	// splits [0, n) into contiguous chunks and calls func(begin, end) for each
+	// chunk on its own thread. The chunk boundaries only depend on n and on the
+	// number of used threads.
+	template <class TFunc>
+	void ParallelFor (size_t n, unsigned int numThreads, TFunc func,
+	                  size_t minItemsPerThread = 4096)
+	{
+		ParallelForChunks (n, NumWorkerThreads (numThreads, n, minItemsPerThread),
+			[&func] (size_t, size_t begin, size_t end) {func (begin, end);});
+	}
+
+	// decodes the binary triangle records [triBegin, triEnd) into the pre-sized
+	// arrays. Corner i of the whole mesh is stored at coordsWithIndexOut[i] and
+	// gets the index i, so that RemoveDoubles can re-index the triangles later on.
+	template <class TNumberContainer, class TCoordContainer, class TIndexContainer>
+	void DecodeBinaryTriangles (const char* data,
+	                            size_t triBegin,
+	                            size_t triEnd,
+	                            TNumberContainer& normalsOut,
+	                            TCoordContainer& coordsWithIndexOut,
+	                            TIndexContainer& trisOut)
+	{
+		typedef typename TNumberContainer::value_type	normal_t;
+		typedef typename TIndexContainer::value_type	index_t;
+
+		const char* rec = data + BINARY_HEADER_SIZE + triBegin * BINARY_TRI_SIZE;
+		for(size_t tri = triBegin; tri < triEnd; ++tri, rec += BINARY_TRI_SIZE){
+			float d[12];
+			memcpy (d, rec, 12 * sizeof(float));
+
+			for(size_t i = 0; i < 3; ++i)
+				normalsOut[tri * 3 + i] = static_cast<normal_t> (d[i]);
+
+			for(size_t icorner = 0; icorner < 3; ++icorner){
+				const size_t ci = tri * 3 + icorner;
+				for(size_t i = 0; i < 3; ++i)
+					coordsWithIndexOut[ci][i] = d[(icorner + 1) * 3 + i];
+				coordsWithIndexOut[ci].index = static_cast<index_t> (ci);
+				trisOut[ci] = static_cast<index_t> (ci);
+			}
+		}
+	}
+
+	// Scanning of ascii stl data. The buffer is tokenized in place, keywords
+	// are compared without copying them and numbers are parsed with
+	// std::from_chars where available.
+	inline bool IsBlank (char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	inline const char* SkipBlanks (const char* p, const char* end)
+	{
+		while(p < end && IsBlank (*p))
+			++p;
+		return p;
+	}
+
+	inline const char* TokenEnd (const char* p, const char* end)
+	{
+		while(p < end && !IsBlank (*p))
+			++p;
+		return p;
+	}
+
+	inline const char* LineEnd (const char* p, const char* end)
+	{
+		const char* e = static_cast<const char*> (memchr (p, '\n', end - p));
+		return e ? e : end;
+	}
+
+	template <size_t N>
+	inline bool TokenIs (const char* tok, const char* tokEnd, const char (&keyword)[N])
+	{
+		return static_cast<size_t> (tokEnd - tok) == N - 1 && memcmp (tok, keyword, N - 1) == 0;
+	}
+
+	// parses the next number on the line [p, lineEnd) and advances p behind it.
+	// Like atof, trailing characters of the token are ignored.
+	inline bool ParseAsciiNumber (const char*& p, const char* lineEnd, double& valOut)
+	{
+		const char* tok = SkipBlanks (p, lineEnd);
+		const char* tokEnd = TokenEnd (tok, lineEnd);
+		p = tokEnd;
+		if(tok == tokEnd)
+			return false;
+
+		#ifdef STL_READER_USE_FROM_CHARS
+			if(*tok == '+' && tok + 1 < tokEnd)
+				++tok;
+			return std::from_chars (tok, tokEnd, valOut).ptr != tok;
+		#else
+			char buf[64];
+			const size_t len = std::min<size_t> (tokEnd - tok, sizeof(buf) - 1);
+			memcpy (buf, tok, len);
+			buf[len] = 0;
+			char* numEnd;
+			valOut = strtod (buf, &numEnd);
+			return numEnd != buf;
+		#endif
+	}
+
+	// returns the beginning of the first line at or behind p whose first
+	// token is 'facet', or end if there is no such line.
+	inline const char* FindFacetLine (const char* data, const char* p, const char* end)
+	{
+		if(p > data && p[-1] != '\n')
+			p = LineEnd (p, end) + 1;
+
+		while(p < end){
+			const char* lineEnd = LineEnd (p, end);
+			const char* tok = SkipBlanks (p, lineEnd);
+			if(TokenIs (tok, TokenEnd (tok, lineEnd), "facet"))
+				return p;
+			p = lineEnd + 1;
+		}
+		return end;
+	}
+
+	// contents of a range of an ascii stl buffer. Indices are relative to the range.
+	template <typename number_t, typename index_t>
+	struct AsciiChunk {
+		AsciiChunk () : errorPos (NULL), errorMsg (NULL)	{}
+
+		std::vector<number_t>								normals;
+		std::vector<CoordWithIndex <number_t, index_t> >	coords;
+		std::vector<index_t>								tris;
+		std::vector<size_t>									solids;	// triangle index of each 'solid'
+		const char*											errorPos;
+		const char*											errorMsg;
+	};
+
+	// parses the lines in [begin, end). Errors are reported through
+	// chunk.errorPos and chunk.errorMsg, so that this can run on worker threads.
+	template <typename number_t, typename index_t>
+	void ParseAsciiRange (const char* begin, const char* end,
+	                      AsciiChunk<number_t, index_t>& chunk)
+	{
+	//	an ascii facet takes roughly 250 bytes
+		const size_t estNumTris = static_cast<size_t> (end - begin) / 200 + 1;
+		chunk.normals.reserve (estNumTris * 3);
+		chunk.coords.reserve (estNumTris * 3);
+		chunk.tris.reserve (estNumTris * 3);
+
+		size_t numFaceVrts = 0;
+		for(const char* line = begin; line < end; ){
+			const char* lineEnd = LineEnd (line, end);
+			const char* tok = SkipBlanks (line, lineEnd);
+			const char* tokEnd = TokenEnd (tok, lineEnd);
+
+			if(TokenIs (tok, tokEnd, "vertex")){
+				CoordWithIndex <number_t, index_t> c;
+				const char* p = tokEnd;
+				for(size_t i = 0; i < 3; ++i){
+					double v;
+					if(!ParseAsciiNumber (p, lineEnd, v)){
+						chunk.errorPos = line;
+						chunk.errorMsg = "vertex not specified correctly";
+						return;
+					}
+					c[i] = static_cast<number_t> (v);
+				}
+				c.index = static_cast<index_t> (chunk.coords.size());
+				chunk.coords.push_back (c);
+				++numFaceVrts;
+			}
+			else if(TokenIs (tok, tokEnd, "facet")){
+				const char* normal = SkipBlanks (tokEnd, lineEnd);
+				const char* normalEnd = TokenEnd (normal, lineEnd);
+				if(normal == normalEnd){
+					chunk.errorPos = line;
+					chunk.errorMsg = "triangle not specified correctly";
+					return;
+				}
+				if(!TokenIs (normal, normalEnd, "normal")){
+					chunk.errorPos = line;
+					chunk.errorMsg = "Missing normal specifier";
+					return;
+				}
+
+				const char* p = normalEnd;
+				for(size_t i = 0; i < 3; ++i){
+					double v;
+					if(!ParseAsciiNumber (p, lineEnd, v)){
+						chunk.errorPos = line;
+						chunk.errorMsg = "triangle not specified correctly";
+						return;
+					}
+					chunk.normals.push_back (static_cast<number_t> (v));
+				}
+				numFaceVrts = 0;
+			}
+			else if(TokenIs (tok, tokEnd, "outer")){
+				const char* loop = SkipBlanks (tokEnd, lineEnd);
+				if(!TokenIs (loop, TokenEnd (loop, lineEnd), "loop")){
+					chunk.errorPos = line;
+					chunk.errorMsg = "expecting outer loop";
+					return;
+				}
+			}
+			else if(TokenIs (tok, tokEnd, "endfacet")){
+				if(numFaceVrts != 3){
+					chunk.errorPos = line;
+					chunk.errorMsg = "bad number of vertices specified for face";
+					return;
+				}
+				const size_t numCoords = chunk.coords.size();
+				chunk.tris.push_back (static_cast<index_t> (numCoords - 3));
+				chunk.tris.push_back (static_cast<index_t> (numCoords - 2));
+				chunk.tris.push_back (static_cast<index_t> (numCoords - 1));
+			}
+			else if(TokenIs (tok, tokEnd, "solid")){
+				chunk.solids.push_back (chunk.tris.size() / 3);
+			}
+
+			line = lineEnd + 1;
+		}
+	}
+
 	// sorts the array coordsWithIndexInOut and copies unique indices to coordsOut.
-	// Triangle-corners are re-indexed on the fly and degenerated triangles are removed.
+	// Triangle-corners are re-indexed on the fly.
 	template <class TNumberContainer, class TIndexContainer>
 	void RemoveDoubles (TNumberContainer& uniqueCoordsOut,
 	                    TIndexContainer& trisInOut,
@@ -458,6 +1207,12 @@ namespace stl_reader_impl {
 		typedef typename TNumberContainer::value_type	number_t;
 		typedef typename TIndexContainer::value_type	index_t;
 
+		if(coordsWithIndexInOut.empty()){
+			uniqueCoordsOut.clear();
+			trisInOut.clear();
+			return;
+		}
+
 		sort (coordsWithIndexInOut.begin(), coordsWithIndexInOut.end());
 	
 	//	first count unique indices
@@ -489,149 +1244,1684 @@ namespace stl_reader_impl {
 		}
 
 	//	re-index triangles, so that they refer to 'uniqueCoordsOut'
-	//	make sure to only add triangles which refer to three different indices
-		index_t numUniqueTriInds = 0;
-		for(index_t i = 0; i < trisInOut.size(); i+=3){
-			int ni[3];
-			for(int j = 0; j < 3; ++j)
-				ni[j] = newIndex[trisInOut[i+j]];
+		for(size_t i = 0; i < trisInOut.size(); ++i)
+			trisInOut[i] = newIndex[trisInOut[i]];
+	}
 
-			if((ni[0] != ni[1]) && (ni[0] != ni[2]) && (ni[1] != ni[2])){
-				for(int j = 0; j < 3; ++j)
-					trisInOut[numUniqueTriInds + j] = ni[j];
-				numUniqueTriInds += 3;
+	// integer key of the weld cell of a coordinate. With invEps == 0 the key
+	// is the bit pattern of the coordinate itself, so that only identical
+	// coordinates share a cell (-0 and +0 are treated as equal).
+	template <typename number_t>
+	inline void WeldKey (const number_t* p, number_t invEps, long long* keyOut)
+	{
+		const number_t maxKey = static_cast<number_t> (1LL << 60);
+		for(int i = 0; i < 3; ++i){
+			if(invEps > 0){
+				const number_t k = std::floor (p[i] * invEps);
+				keyOut[i] = static_cast<long long> (std::max (-maxKey, std::min (k, maxKey)));
+			}
+			else{
+				const number_t v = (p[i] == 0) ? number_t(0) : p[i];
+				keyOut[i] = 0;
+				memcpy (&keyOut[i], &v, sizeof(number_t));
 			}
 		}
-
-		if(numUniqueTriInds < trisInOut.size())
-			trisInOut.resize (numUniqueTriInds);
 	}
-}// end of namespace stl_reader_impl
-
-
-template <class TNumberContainer1, class TNumberContainer2,
-		  class TIndexContainer1, class TIndexContainer2>
-bool ReadStlFile(const char* filename,
-                TNumberContainer1& coordsOut,
-                TNumberContainer2& normalsOut,
-                TIndexContainer1& trisOut,
-				TIndexContainer2& solidRangesOut)
-{
-	if(StlFileHasASCIIFormat(filename))
-		return ReadStlFile_ASCII(filename, coordsOut, normalsOut, trisOut, solidRangesOut);
-	else
-		return ReadStlFile_BINARY(filename, coordsOut, normalsOut, trisOut, solidRangesOut);
-}
 
+	inline unsigned int WeldHash (const long long* key)
+	{
+		unsigned long long h = static_cast<unsigned long long> (key[0]) * 0x9E3779B97F4A7C15ULL;
+		h = (h ^ static_cast<unsigned long long> (key[1])) * 0xC2B2AE3D27D4EB4FULL;
+		h = (h ^ static_cast<unsigned long long> (key[2])) * 0x165667B19E3779F9ULL;
+		h ^= h >> 29;
+		return static_cast<unsigned int> (h ^ (h >> 32));
+	}
 
-template <class TNumberContainer1, class TNumberContainer2,
-		  class TIndexContainer1, class TIndexContainer2>
-bool ReadStlFile_ASCII(const char* filename,
-                       TNumberContainer1& coordsOut,
-                       TNumberContainer2& normalsOut,
-                       TIndexContainer1& trisOut,
-					   TIndexContainer2& solidRangesOut)
-{
-	using namespace std;
-	using namespace stl_reader_impl;
-
-	typedef typename TNumberContainer1::value_type	number_t;
-	typedef typename TIndexContainer1::value_type	index_t;
+	// Open addressing hash table of weld cells for one hash partition.
+	// Slots only store the hash and the id of a cell, keys are recomputed from
+	// the cell's representative corner on collisions.
+	template <typename index_t>
+	struct WeldTable {
+		struct Slot {
+			unsigned int	hash;
+			index_t			cell;	// cell id + 1, 0 marks an empty slot
+		};
+
+		std::vector<Slot>		slots;
+		std::vector<index_t>	cellRep;	// first corner of each cell
+		size_t					mask;
+
+		void init (size_t maxNumCells)
+		{
+			size_t numSlots = 16;
+			while(numSlots < 2 * maxNumCells)
+				numSlots *= 2;
+			const Slot empty = {0, 0};
+			slots.assign (numSlots, empty);
+			cellRep.clear ();
+			mask = numSlots - 1;
+		}
 
-	coordsOut.clear();
-	normalsOut.clear();
-	trisOut.clear();
-	solidRangesOut.clear();
+		// returns the local id of the cell with the given key, or -1
+		template <class TCoordContainer, typename number_t>
+		long long find (const long long* key, unsigned int hash,
+		                const TCoordContainer& corners, number_t invEps) const
+		{
+			for(size_t slot = hash & mask; slots[slot].cell != 0; slot = (slot + 1) & mask){
+				if(slots[slot].hash != hash)
+					continue;
+				const index_t cell = slots[slot].cell - 1;
+				long long k[3];
+				WeldKey (corners[cellRep[cell]].data, invEps, k);
+				if(k[0] == key[0] && k[1] == key[1] && k[2] == key[2])
+					return static_cast<long long> (cell);
+			}
+			return -1;
+		}
 
-	ifstream in(filename);
-	STL_READER_COND_THROW(!in, "Couldn't open file " << filename);
+		// returns the local id of the cell with the given key. If no such cell
+		// exists yet, it is created with 'corner' as representative.
+		template <class TCoordContainer, typename number_t>
+		index_t insert (const long long* key, unsigned int hash, index_t corner,
+		                const TCoordContainer& corners, number_t invEps)
+		{
+			size_t slot = hash & mask;
+			for(; slots[slot].cell != 0; slot = (slot + 1) & mask){
+				if(slots[slot].hash != hash)
+					continue;
+				const index_t cell = slots[slot].cell - 1;
+				long long k[3];
+				WeldKey (corners[cellRep[cell]].data, invEps, k);
+				if(k[0] == key[0] && k[1] == key[1] && k[2] == key[2])
+					return cell;
+			}
+			slots[slot].hash = hash;
+			slots[slot].cell = static_cast<index_t> (cellRep.size() + 1);
+			cellRep.push_back (corner);
+			return static_cast<index_t> (cellRep.size() - 1);
+		}
+	};
 
-	vector<CoordWithIndex <number_t, index_t> > coordsWithIndex;
+	// Merges matching corners in O(n) through a spatial hash and re-indexes
+	// triangles like RemoveDoubles. Degenerated triangles are removed.
+	//
+	// Corners are assigned to cells of a grid with spacing epsilon (or to their
+	// exact coordinate for epsilon == 0). Cells are distributed over hash
+	// partitions, and each thread fills the hash table of one partition. Each
+	// cell is represented by its first corner. For epsilon > 0, a cell is then
+	// linked to the neighbour cell with the smallest representative which lies
+	// within epsilon, so that corners close to a cell border are merged as well.
+	// All 26 neighbours are searched: with cells of size epsilon, a corner
+	// within epsilon may lie beyond the farther border, too.
+	// The resulting vertices are ordered by their first occurrence in
+	// coordsWithIndex, independent of the number of threads.
+	template <class TNumberContainer, class TIndexContainer>
+	void WeldVertices (TNumberContainer& uniqueCoordsOut,
+	                   TIndexContainer& trisInOut,
+	                   const std::vector <CoordWithIndex<
+	                   		typename TNumberContainer::value_type,
+	                   		typename TIndexContainer::value_type> >
+	                   			&coordsWithIndex,
+	                   double epsilon,
+	                   unsigned int numThreads)
+	{
+		using namespace std;
 
-	string buffer;
-	vector<string> tokens;
-	int lineCount = 1;
-	int maxNumTokens = 0;
-	size_t numFaceVrts = 0;
+		typedef typename TNumberContainer::value_type	number_t;
+		typedef typename TIndexContainer::value_type	index_t;
 
-	while(!(in.eof() || in.fail()))
-	{
-	//	read the line and tokenize.
-	//	In order to reuse memory in between lines, 'tokens' won't be cleared.
-	//	Instead we count the number of tokens using 'tokenCount'.
-		getline(in, buffer);
+		const size_t numCorners = coordsWithIndex.size();
+		if(numCorners == 0){
+			uniqueCoordsOut.clear();
+			trisInOut.clear();
+			return;
+		}
 
-		istringstream line(buffer);
-		int tokenCount = 0;
-		while(!(line.eof() || line.fail())){
-			if(tokenCount >= maxNumTokens){
-				maxNumTokens = tokenCount + 1;
-				tokens.resize(maxNumTokens);
+		const number_t invEps = (epsilon > 0) ? static_cast<number_t> (1.0 / epsilon) : 0;
+		const unsigned int numParts = NumWorkerThreads (numThreads, numCorners, 16384);
+
+	//	hash each corner and count the corners of each partition per chunk
+		vector<unsigned int> hashes (numCorners);
+		vector<size_t> partCounts (numParts * numParts, 0);
+		ParallelForChunks (numCorners, numParts,
+			[&] (size_t chunk, size_t begin, size_t end) {
+				size_t* counts = &partCounts[chunk * numParts];
+				for(size_t i = begin; i < end; ++i){
+					long long key[3];
+					WeldKey (coordsWithIndex[i].data, invEps, key);
+					hashes[i] = WeldHash (key);
+					++counts[(static_cast<unsigned long long> (hashes[i]) * numParts) >> 32];
+				}
+			});
+
+	//	sort the corner ids by partition. Corners of a partition stay in
+	//	ascending order, so that the first corner of a cell becomes its representative.
+		vector<size_t> partBegin (numParts + 1, 0);
+		vector<size_t> chunkOffsets (numParts * numParts);
+		for(size_t part = 0, offset = 0; part < numParts; ++part){
+			partBegin[part] = offset;
+			for(size_t chunk = 0; chunk < numParts; ++chunk){
+				chunkOffsets[chunk * numParts + part] = offset;
+				offset += partCounts[chunk * numParts + part];
 			}
-			line >> tokens[tokenCount];
-			++tokenCount;
 		}
-
-		if(tokenCount > 0)
-		{
-			string& tok = tokens[0];
-			if(tok.compare("vertex") == 0){
-				if(tokenCount < 4){
-					STL_READER_THROW("ERROR while reading from " << filename <<
-						": vertex not specified correctly in line " << lineCount);
+		partBegin[numParts] = numCorners;
+
+		vector<index_t> order (numCorners);
+		ParallelForChunks (numCorners, numParts,
+			[&] (size_t chunk, size_t begin, size_t end) {
+				size_t* offsets = &chunkOffsets[chunk * numParts];
+				for(size_t i = begin; i < end; ++i)
+					order[offsets[(static_cast<unsigned long long> (hashes[i]) * numParts) >> 32]++] = static_cast<index_t> (i);
+			});
+
+	//	fill the hash table of each partition and assign a local cell to each corner
+		vector<WeldTable<index_t> > tables (numParts);
+		vector<index_t> cornerCell (numCorners);
+		ParallelForChunks (numParts, numParts,
+			[&] (size_t, size_t partBeginIdx, size_t partEndIdx) {
+				for(size_t part = partBeginIdx; part < partEndIdx; ++part){
+					WeldTable<index_t>& table = tables[part];
+					table.init (partBegin[part + 1] - partBegin[part]);
+					for(size_t i = partBegin[part]; i < partBegin[part + 1]; ++i){
+						const index_t corner = order[i];
+						long long key[3];
+						WeldKey (coordsWithIndex[corner].data, invEps, key);
+						cornerCell[corner] = table.insert (key, hashes[corner], corner,
+						                                   coordsWithIndex, invEps);
+					}
 				}
-				
-			//	read the position
-				CoordWithIndex <number_t, index_t> c;
-				for(size_t i = 0; i < 3; ++i)
-					c[i] = static_cast<number_t> (atof(tokens[i+1].c_str()));
-				c.index = static_cast<index_t>(coordsWithIndex.size());
-				coordsWithIndex.push_back(c);
-				++numFaceVrts;
+			});
+
+		vector<unsigned int> ().swap (hashes);
+
+	//	global cell ids: cells of partition i follow those of partition i-1
+		vector<size_t> cellBegin (numParts + 1, 0);
+		for(size_t part = 0; part < numParts; ++part)
+			cellBegin[part + 1] = cellBegin[part] + tables[part].cellRep.size();
+		const size_t numCells = cellBegin[numParts];
+
+		vector<index_t> cellRep (numCells);
+		ParallelForChunks (numParts, numParts,
+			[&] (size_t, size_t partBeginIdx, size_t partEndIdx) {
+				for(size_t part = partBeginIdx; part < partEndIdx; ++part){
+					const index_t offset = static_cast<index_t> (cellBegin[part]);
+					copy (tables[part].cellRep.begin(), tables[part].cellRep.end(),
+					      cellRep.begin() + cellBegin[part]);
+					for(size_t i = partBegin[part]; i < partBegin[part + 1]; ++i)
+						cornerCell[order[i]] += offset;
+				}
+			});
+
+		vector<index_t> ().swap (order);
+
+	//	with a tolerance, each cell is merged into the neighbour cell with the
+	//	smallest representative corner within epsilon. The resulting links point
+	//	to smaller representatives only, so that following them terminates.
+		vector<index_t> cellRoot;
+		if(invEps > 0){
+			cellRoot.resize (numCells);
+			const double sqEps = epsilon * epsilon;
+			ParallelFor (numCells, numThreads,
+				[&] (size_t begin, size_t end) {
+					for(size_t cell = begin; cell < end; ++cell){
+						const number_t* p = coordsWithIndex[cellRep[cell]].data;
+						long long key[3];
+						WeldKey (p, invEps, key);
+
+						index_t best = static_cast<index_t> (cell);
+						for(int n = 0; n < 27; ++n){
+							if(n == 13)
+								continue;
+							const long long nkey[3] = {key[0] + n % 3 - 1,
+							                           key[1] + n / 3 % 3 - 1,
+							                           key[2] + n / 9 - 1};
+							const unsigned int nhash = WeldHash (nkey);
+							const size_t part = (static_cast<unsigned long long> (nhash) * numParts) >> 32;
+							const long long ncell = tables[part].find (nkey, nhash, coordsWithIndex, invEps);
+							if(ncell < 0)
+								continue;
+
+							const index_t nglobal = static_cast<index_t> (cellBegin[part] + ncell);
+							if(cellRep[nglobal] >= cellRep[best])
+								continue;
+
+							const number_t* q = coordsWithIndex[cellRep[nglobal]].data;
+							double sqDist = 0;
+							for(int i = 0; i < 3; ++i)
+								sqDist += (double(p[i]) - double(q[i])) * (double(p[i]) - double(q[i]));
+							if(sqDist <= sqEps)
+								best = nglobal;
+						}
+						cellRoot[cell] = best;
+					}
+				}, 1024);
+
+			for(size_t cell = 0; cell < numCells; ++cell){
+				index_t root = cellRoot[cell];
+				while(cellRoot[root] != root)
+					root = cellRoot[root];
+				cellRoot[cell] = root;
 			}
-			else if(tok.compare("facet") == 0)
-			{
-				STL_READER_COND_THROW(tokenCount < 5,
-						"ERROR while reading from " << filename <<
-						": triangle not specified correctly in line " << lineCount);
-				
-				STL_READER_COND_THROW(tokens[1].compare("normal") != 0,
-						"ERROR while reading from " << filename <<
-						": Missing normal specifier in line " << lineCount);
-				
-			//	read the normal
-				for(size_t i = 0; i < 3; ++i)
-					normalsOut.push_back (static_cast<number_t> (atof(tokens[i+2].c_str())));
+		}
 
-				numFaceVrts = 0;
-			}
-			else if(tok.compare("outer") == 0){
-				STL_READER_COND_THROW ((tokenCount < 2) || (tokens[1].compare("loop") != 0),
-				    "ERROR while reading from " << filename <<
-					": expecting outer loop in line " << lineCount);
-			}
-			else if(tok.compare("endfacet") == 0){
-				STL_READER_COND_THROW(numFaceVrts != 3,
-					"ERROR while reading from " << filename <<
-					": bad number of vertices specified for face in line " << lineCount);
+		vector<WeldTable<index_t> > ().swap (tables);
 
-				trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 3));
-				trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 2));
-				trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 1));
-			}
-			else if(tok.compare("solid") == 0){
-				solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
-			}
+	//	number the root cells by the position of their representatives, which
+	//	orders the vertices by their first occurrence.
+		vector<index_t> vertexOfCorner (numCorners, 0);
+		for(size_t cell = 0; cell < numCells; ++cell){
+			if(cellRoot.empty() || cellRoot[cell] == cell)
+				vertexOfCorner[cellRep[cell]] = 1;
 		}
-		lineCount++;
-	}
 
-	solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
-
-	RemoveDoubles (coordsOut, trisOut, coordsWithIndex);
+		index_t numUnique = 0;
+		for(size_t i = 0; i < numCorners; ++i){
+			const index_t isVertex = vertexOfCorner[i];
+			vertexOfCorner[i] = numUnique;
+			numUnique += isVertex;
+		}
 
-	return true;
-}
+		uniqueCoordsOut.resize (numUnique * 3);
+		ParallelFor (numCells, numThreads,
+			[&] (size_t begin, size_t end) {
+				for(size_t cell = begin; cell < end; ++cell){
+					if(!cellRoot.empty() && cellRoot[cell] != cell)
+						continue;
+					const index_t rep = cellRep[cell];
+					for(size_t i = 0; i < 3; ++i)
+						uniqueCoordsOut[vertexOfCorner[rep] * 3 + i] = coordsWithIndex[rep][i];
+				}
+			});
+
+	//	re-index triangles, so that they refer to 'uniqueCoordsOut'
+		ParallelFor (trisInOut.size(), numThreads,
+			[&] (size_t begin, size_t end) {
+				for(size_t i = begin; i < end; ++i){
+					index_t cell = cornerCell[trisInOut[i]];
+					if(!cellRoot.empty())
+						cell = cellRoot[cell];
+					trisInOut[i] = vertexOfCorner[cellRep[cell]];
+				}
+			});
+	}
+
+	// removes triangles which do not refer to three different vertices.
+	// Face normals and solid ranges are compacted alongside, so that they
+	// stay valid for the remaining triangles.
+	template <class TNumberContainer, class TIndexContainer1, class TIndexContainer2>
+	void RemoveDegenerateTriangles (TIndexContainer1& trisInOut,
+	                                TNumberContainer& normalsInOut,
+	                                TIndexContainer2& solidRangesInOut)
+	{
+		typedef typename TIndexContainer1::value_type	index_t;
+		typedef typename TIndexContainer2::value_type	range_t;
+
+		const size_t numTris = trisInOut.size() / 3;
+		const bool hasNormals = normalsInOut.size() == numTris * 3;
+
+		size_t numKept = 0;
+		size_t nextSolid = 0;
+		for(size_t tri = 0; tri < numTris; ++tri){
+		//	solid ranges which start at this triangle now start at numKept
+			while(nextSolid < solidRangesInOut.size()
+			      && static_cast<size_t> (solidRangesInOut[nextSolid]) <= tri)
+			{
+				solidRangesInOut[nextSolid++] = static_cast<range_t> (numKept);
+			}
+
+			const index_t a = trisInOut[tri * 3], b = trisInOut[tri * 3 + 1], c = trisInOut[tri * 3 + 2];
+			if((a == b) || (a == c) || (b == c))
+				continue;
+
+			trisInOut[numKept * 3] = a;
+			trisInOut[numKept * 3 + 1] = b;
+			trisInOut[numKept * 3 + 2] = c;
+			if(hasNormals){
+				for(size_t i = 0; i < 3; ++i)
+					normalsInOut[numKept * 3 + i] = normalsInOut[tri * 3 + i];
+			}
+			++numKept;
+		}
+
+		for(; nextSolid < solidRangesInOut.size(); ++nextSolid)
+			solidRangesInOut[nextSolid] = static_cast<range_t> (numKept);
+
+		if(numKept < numTris){
+			trisInOut.resize (numKept * 3);
+			if(hasNormals)
+				normalsInOut.resize (numKept * 3);
+		}
+	}
+
+	// merges matching corners with the algorithm selected in options and
+	// removes triangles which collapsed in the process
+	template <class TNumberContainer1, class TNumberContainer2,
+			  class TIndexContainer1, class TIndexContainer2>
+	void WeldCorners (TNumberContainer1& uniqueCoordsOut,
+	                  TNumberContainer2& normalsInOut,
+	                  TIndexContainer1& trisInOut,
+	                  TIndexContainer2& solidRangesInOut,
+	                  std::vector <CoordWithIndex<
+	                  		typename TNumberContainer1::value_type,
+	                  		typename TIndexContainer1::value_type> >
+	                  			&coordsWithIndexInOut,
+	                  const ReadOptions& options)
+	{
+		if(options.weldMode == WELD_HASH)
+			WeldVertices (uniqueCoordsOut, trisInOut, coordsWithIndexInOut,
+			              options.weldEpsilon, options.numThreads);
+		else
+			RemoveDoubles (uniqueCoordsOut, trisInOut, coordsWithIndexInOut);
+
+		RemoveDegenerateTriangles (trisInOut, normalsInOut, solidRangesInOut);
+		if(!options.readNormals)
+			TNumberContainer2 ().swap (normalsInOut);
+	}
+
+	// Merges corners one after the other for ReadOptions::lowMemory. Yields
+	// the same vertices in the same order as WeldVertices, but only stores a
+	// hash table of the weld cells instead of all corners. Cells are numbered
+	// in the order of their creation, so the cell with the smallest id is the
+	// one with the smallest representative in WeldVertices.
+	template <typename number_t, typename index_t>
+	class IncrementalWelder {
+	public:
+		IncrementalWelder (double epsilon) :
+			m_epsilon (epsilon),
+			m_invEps (epsilon > 0 ? static_cast<number_t> (1.0 / epsilon) : 0),
+			m_numCells (0)
+		{
+			resize_table (1 << 16);
+		}
+
+		// returns the vertex of the given corner. New vertices are appended to coords.
+		template <class TNumberContainer>
+		index_t insert (const number_t* p, TNumberContainer& coords)
+		{
+			long long key[3];
+			WeldKey (p, m_invEps, key);
+			const unsigned int hash = WeldHash (key);
+
+			size_t slot;
+			const long long cell = find (key, hash, coords, slot);
+			if(cell >= 0)
+				return vertex (static_cast<index_t> (cell));
+
+		//	a new cell joins the oldest neighbour cell within epsilon. All 26
+		//	neighbours are searched, like in WeldVertices.
+			index_t vrt = static_cast<index_t> (coords.size() / 3);
+			if(m_invEps > 0){
+				long long best = -1;
+				for(int n = 0; n < 27; ++n){
+					if(n == 13)
+						continue;
+					const long long nkey[3] = {key[0] + n % 3 - 1,
+					                           key[1] + n / 3 % 3 - 1,
+					                           key[2] + n / 9 - 1};
+					size_t nslot;
+					const long long ncell = find (nkey, WeldHash (nkey), coords, nslot);
+					if(ncell < 0 || (best >= 0 && ncell >= best))
+						continue;
+
+					const number_t* q = cell_coords (static_cast<index_t> (ncell), coords);
+					double sqDist = 0;
+					for(int i = 0; i < 3; ++i)
+						sqDist += (double(p[i]) - double(q[i])) * (double(p[i]) - double(q[i]));
+					if(sqDist <= m_epsilon * m_epsilon)
+						best = ncell;
+				}
+				if(best >= 0)
+					vrt = vertex (static_cast<index_t> (best));
+
+				m_cellVertex.push_back (vrt);
+				for(int i = 0; i < 3; ++i)
+					m_cellCoords.push_back (p[i]);
+			}
+
+			if(vrt == coords.size() / 3){
+				for(int i = 0; i < 3; ++i)
+					coords.push_back (p[i]);
+			}
+
+			m_slots[slot].hash = hash;
+			m_slots[slot].cell = static_cast<index_t> (++m_numCells);
+			if(2 * m_numCells > m_slots.size())
+				resize_table (2 * m_slots.size());
+			return vrt;
+		}
+
+		// bytes held by the lookup tables
+		size_t memory_size () const
+		{
+			return m_slots.size() * sizeof(Slot) + m_cellVertex.size() * sizeof(index_t)
+				 + m_cellCoords.size() * sizeof(number_t);
+		}
+
+		// releases the lookup tables
+		void clear ()
+		{
+			std::vector<Slot> ().swap (m_slots);
+			std::vector<index_t> ().swap (m_cellVertex);
+			std::vector<number_t> ().swap (m_cellCoords);
+			m_numCells = 0;
+		}
+
+	private:
+		struct Slot {
+			unsigned int	hash;
+			index_t			cell;	// cell id + 1, 0 marks an empty slot
+		};
+
+		// without a tolerance, each cell is a vertex of its own
+		index_t vertex (index_t cell) const
+		{
+			return m_invEps > 0 ? m_cellVertex[cell] : cell;
+		}
+
+		template <class TNumberContainer>
+		const number_t* cell_coords (index_t cell, const TNumberContainer& coords) const
+		{
+			return m_invEps > 0 ? &m_cellCoords[cell * 3] : &coords[cell * 3];
+		}
+
+		// returns the cell with the given key or -1. slotOut receives the slot
+		// at which the search stopped.
+		template <class TNumberContainer>
+		long long find (const long long* key, unsigned int hash,
+		                const TNumberContainer& coords, size_t& slotOut) const
+		{
+			size_t slot = hash & m_mask;
+			for(; m_slots[slot].cell != 0; slot = (slot + 1) & m_mask){
+				if(m_slots[slot].hash != hash)
+					continue;
+				const index_t cell = m_slots[slot].cell - 1;
+				long long k[3];
+				WeldKey (cell_coords (cell, coords), m_invEps, k);
+				if(k[0] == key[0] && k[1] == key[1] && k[2] == key[2]){
+					slotOut = slot;
+					return static_cast<long long> (cell);
+				}
+			}
+			slotOut = slot;
+			return -1;
+		}
+
+		void resize_table (size_t numSlots)
+		{
+			std::vector<Slot> old;
+			old.swap (m_slots);
+			const Slot empty = {0, 0};
+			m_slots.assign (numSlots, empty);
+			m_mask = numSlots - 1;
+			for(size_t i = 0; i < old.size(); ++i){
+				if(old[i].cell == 0)
+					continue;
+				size_t slot = old[i].hash & m_mask;
+				while(m_slots[slot].cell != 0)
+					slot = (slot + 1) & m_mask;
+				m_slots[slot] = old[i];
+			}
+		}
+
+		double					m_epsilon;
+		number_t				m_invEps;
+		std::vector<Slot>		m_slots;
+		size_t					m_mask;
+		size_t					m_numCells;
+		std::vector<index_t>	m_cellVertex;	// only with a tolerance
+		std::vector<number_t>	m_cellCoords;	// only with a tolerance
+	};
+
+	// Collects the triangles of a ReadOptions::lowMemory read. Degenerated
+	// triangles are dropped right away. Whenever the memory budget is
+	// exceeded, the collected triangles and normals are appended to
+	// temporary files, from which they are read back by finish().
+	template <class TNumberContainer1, class TNumberContainer2,
+			  class TIndexContainer1, class TIndexContainer2>
+	class LowMemoryOutput {
+	public:
+		typedef typename TNumberContainer1::value_type	number_t;
+		typedef typename TNumberContainer2::value_type	normal_t;
+		typedef typename TIndexContainer1::value_type	index_t;
+		typedef typename TIndexContainer2::value_type	range_t;
+
+		LowMemoryOutput (TNumberContainer1& coordsOut,
+		                 TNumberContainer2& normalsOut,
+		                 TIndexContainer1& trisOut,
+		                 TIndexContainer2& solidRangesOut,
+		                 const ReadOptions& options) :
+			m_coords (coordsOut),
+			m_normals (normalsOut),
+			m_tris (trisOut),
+			m_solidRanges (solidRangesOut),
+			m_options (options),
+			m_numTris (0),
+			m_numSpilledTris (0),
+			m_trisFile (NULL),
+			m_normalsFile (NULL)
+		{
+			m_coords.clear();
+			m_normals.clear();
+			m_tris.clear();
+			m_solidRanges.clear();
+		}
+
+		~LowMemoryOutput ()
+		{
+			if(m_trisFile)
+				fclose (m_trisFile);
+			if(m_normalsFile)
+				fclose (m_normalsFile);
+		}
+
+		void begin_solid ()
+		{
+			m_solidRanges.push_back (static_cast<range_t> (m_numTris));
+		}
+
+		void add_triangle (const float* normal, index_t a, index_t b, index_t c)
+		{
+			if((a == b) || (a == c) || (b == c))
+				return;
+			m_tris.push_back (a);
+			m_tris.push_back (b);
+			m_tris.push_back (c);
+			if(m_options.readNormals){
+				for(size_t i = 0; i < 3; ++i)
+					m_normals.push_back (static_cast<normal_t> (normal[i]));
+			}
+			++m_numTris;
+		}
+
+		// spills triangles and normals if the budget is exceeded.
+		// 'tableSize' is the memory used for merging corners.
+		bool check_budget (size_t tableSize)
+		{
+			if(m_options.memoryBudget == 0 || m_tris.empty())
+				return true;
+
+			const size_t size = tableSize + m_coords.size() * sizeof(number_t)
+							  + m_tris.size() * sizeof(index_t)
+							  + m_normals.size() * sizeof(normal_t);
+			return size <= m_options.memoryBudget || spill ();
+		}
+
+		// appends the final solid range and reads spilled data back. The
+		// tables for merging corners should be released before.
+		bool finish ()
+		{
+			m_solidRanges.push_back (static_cast<range_t> (m_numTris));
+			if(!m_trisFile)
+				return true;
+
+			if(!spill ())
+				return false;
+
+			m_tris.resize (m_numTris * 3);
+			rewind (m_trisFile);
+			bool ok = m_numTris == 0 || fread (&m_tris[0], sizeof(index_t), m_numTris * 3, m_trisFile) == m_numTris * 3;
+			if(m_options.readNormals){
+				m_normals.resize (m_numTris * 3);
+				rewind (m_normalsFile);
+				ok = ok && (m_numTris == 0 || fread (&m_normals[0], sizeof(normal_t), m_numTris * 3, m_normalsFile) == m_numTris * 3);
+			}
+			return ok;
+		}
+
+	private:
+		LowMemoryOutput (const LowMemoryOutput&);
+		LowMemoryOutput& operator = (const LowMemoryOutput&);
+
+		bool spill ()
+		{
+			if(!m_trisFile){
+				m_trisFile = tmpfile ();
+				m_normalsFile = tmpfile ();
+				if(!m_trisFile || !m_normalsFile)
+					return false;
+			}
+
+			const size_t numTris = m_numTris - m_numSpilledTris;
+			if(numTris > 0){
+				if(fwrite (&m_tris[0], sizeof(index_t), numTris * 3, m_trisFile) != numTris * 3)
+					return false;
+				if(m_options.readNormals
+				   && fwrite (&m_normals[0], sizeof(normal_t), numTris * 3, m_normalsFile) != numTris * 3)
+				{
+					return false;
+				}
+			}
+
+			if(m_options.stats){
+				m_options.stats->spilledBytes += numTris * 3
+					* (sizeof(index_t) + (m_options.readNormals ? sizeof(normal_t) : 0));
+			}
+
+			m_numSpilledTris = m_numTris;
+			TIndexContainer1 ().swap (m_tris);
+			TNumberContainer2 ().swap (m_normals);
+			return true;
+		}
+
+		TNumberContainer1&	m_coords;
+		TNumberContainer2&	m_normals;
+		TIndexContainer1&	m_tris;
+		TIndexContainer2&	m_solidRanges;
+		const ReadOptions&	m_options;
+		size_t				m_numTris;
+		size_t				m_numSpilledTris;
+		FILE*				m_trisFile;
+		FILE*				m_normalsFile;
+	};
+
+	// reads binary stl data for ReadOptions::lowMemory. If source is given,
+	// decoded parts of the file are released from memory.
+	template <class TNumberContainer1, class TNumberContainer2,
+			  class TIndexContainer1, class TIndexContainer2>
+	bool ReadLowMemoryBinary (const char* name,
+	                          const char* buffer,
+	                          size_t bufferSize,
+	                          TNumberContainer1& coordsOut,
+	                          TNumberContainer2& normalsOut,
+	                          TIndexContainer1& trisOut,
+	                          TIndexContainer2& solidRangesOut,
+	                          const ReadOptions& options,
+	                          MappedFile* source)
+	{
+		typedef typename TNumberContainer1::value_type	number_t;
+		typedef typename TIndexContainer1::value_type	index_t;
+
+		size_t numTris = 0;
+		STL_READER_COND_THROW(!BinaryTriangleCount(buffer, bufferSize, numTris),
+			"Error while parsing binary stl header of " << name << ": buffer too small");
+		STL_READER_COND_THROW((bufferSize - BINARY_HEADER_SIZE) / BINARY_TRI_SIZE < numTris,
+			"Error while parsing binary stl data of " << name << ": " << numTris
+			<< " triangles don't fit into " << bufferSize << " bytes");
+
+		LowMemoryOutput <TNumberContainer1, TNumberContainer2, TIndexContainer1, TIndexContainer2>
+			out (coordsOut, normalsOut, trisOut, solidRangesOut, options);
+		IncrementalWelder <number_t, index_t> welder (options.weldEpsilon);
+
+		out.begin_solid ();
+
+		const size_t batchSize = 1 << 16;
+		const char* rec = buffer + BINARY_HEADER_SIZE;
+		for(size_t batchBegin = 0; batchBegin < numTris; batchBegin += batchSize){
+			const char* batchData = rec;
+			const size_t batchEnd = std::min (numTris, batchBegin + batchSize);
+			for(size_t tri = batchBegin; tri < batchEnd; ++tri, rec += BINARY_TRI_SIZE){
+				float d[12];
+				memcpy (d, rec, 12 * sizeof(float));
+
+				index_t corners[3];
+				for(size_t icorner = 0; icorner < 3; ++icorner){
+					number_t c[3];
+					for(size_t i = 0; i < 3; ++i)
+						c[i] = d[(icorner + 1) * 3 + i];
+					corners[icorner] = welder.insert (c, coordsOut);
+				}
+				out.add_triangle (d, corners[0], corners[1], corners[2]);
+			}
+
+			STL_READER_COND_THROW(!out.check_budget (welder.memory_size ()),
+				"Couldn't write temporary data while reading " << name);
+			if(source)
+				source->release (batchData, rec);
+		}
+
+		RecordPeakRss (options, &ReadStats::parsePeakRss);
+		if(options.stats)
+			options.stats->weldPeakRss = options.stats->parsePeakRss;
+
+		welder.clear ();
+		STL_READER_COND_THROW(!out.finish (),
+			"Couldn't read temporary data back while reading " << name);
+		RecordPeakRss (options, &ReadStats::outputPeakRss);
+		return true;
+	}
+
+	// reads ascii stl data for ReadOptions::lowMemory. The buffer is parsed
+	// in ranges of a few megabytes, each of which is merged right away.
+	template <class TNumberContainer1, class TNumberContainer2,
+			  class TIndexContainer1, class TIndexContainer2>
+	bool ReadLowMemoryAscii (const char* name,
+	                         const char* buffer,
+	                         size_t bufferSize,
+	                         TNumberContainer1& coordsOut,
+	                         TNumberContainer2& normalsOut,
+	                         TIndexContainer1& trisOut,
+	                         TIndexContainer2& solidRangesOut,
+	                         const ReadOptions& options,
+	                         MappedFile* source)
+	{
+		typedef typename TNumberContainer1::value_type	number_t;
+		typedef typename TIndexContainer1::value_type	index_t;
+
+		LowMemoryOutput <TNumberContainer1, TNumberContainer2, TIndexContainer1, TIndexContainer2>
+			out (coordsOut, normalsOut, trisOut, solidRangesOut, options);
+		IncrementalWelder <number_t, index_t> welder (options.weldEpsilon);
+
+		const char* end = buffer + bufferSize;
+		const size_t rangeSize = 4 << 20;
+		for(const char* rangeBegin = buffer; rangeBegin < end; ){
+			const char* rangeEnd = end;
+			if(static_cast<size_t> (end - rangeBegin) > rangeSize)
+				rangeEnd = FindFacetLine (buffer, rangeBegin + rangeSize, end);
+
+			AsciiChunk <number_t, index_t> chunk;
+			ParseAsciiRange (rangeBegin, rangeEnd, chunk);
+			if(chunk.errorPos){
+				const size_t lineCount = 1 + std::count (buffer, chunk.errorPos, '\n');
+				STL_READER_THROW("ERROR while reading from " << name << ": "
+					<< chunk.errorMsg << " in line " << lineCount);
+			}
+
+			const size_t numTris = chunk.tris.size() / 3;
+			const float noNormal[3] = {0, 0, 0};
+			size_t nextSolid = 0;
+			for(size_t tri = 0; tri < numTris; ++tri){
+				for(; nextSolid < chunk.solids.size() && chunk.solids[nextSolid] <= tri; ++nextSolid)
+					out.begin_solid ();
+
+				float n[3];
+				const bool hasNormal = (tri + 1) * 3 <= chunk.normals.size();
+				for(size_t i = 0; i < 3; ++i)
+					n[i] = hasNormal ? static_cast<float> (chunk.normals[tri * 3 + i]) : noNormal[i];
+
+				index_t corners[3];
+				for(size_t icorner = 0; icorner < 3; ++icorner)
+					corners[icorner] = welder.insert (chunk.coords[chunk.tris[tri * 3 + icorner]].data, coordsOut);
+				out.add_triangle (n, corners[0], corners[1], corners[2]);
+			}
+			for(; nextSolid < chunk.solids.size(); ++nextSolid)
+				out.begin_solid ();
+
+			STL_READER_COND_THROW(!out.check_budget (welder.memory_size ()),
+				"Couldn't write temporary data while reading " << name);
+			if(source)
+				source->release (rangeBegin, rangeEnd);
+			rangeBegin = rangeEnd;
+		}
+
+		RecordPeakRss (options, &ReadStats::parsePeakRss);
+		if(options.stats)
+			options.stats->weldPeakRss = options.stats->parsePeakRss;
+
+		welder.clear ();
+		STL_READER_COND_THROW(!out.finish (),
+			"Couldn't read temporary data back while reading " << name);
+		RecordPeakRss (options, &ReadStats::outputPeakRss);
+		return true;
+	}
+
+	// parses an ascii stl buffer. 'name' is only used for error messages.
+	// source is only used by ReadOptions::lowMemory reads, see ReadLowMemoryAscii.
+	template <class TNumberContainer1, class TNumberContainer2,
+			  class TIndexContainer1, class TIndexContainer2>
+	bool ReadAsciiBuffer (const char* name,
+	                      const char* buffer,
+	                      size_t bufferSize,
+	                      TNumberContainer1& coordsOut,
+	                      TNumberContainer2& normalsOut,
+	                      TIndexContainer1& trisOut,
+	                      TIndexContainer2& solidRangesOut,
+	                      const ReadOptions& options,
+	                      MappedFile* source = NULL)
+	{
+		using namespace std;
+
+		if(options.lowMemory)
+			return ReadLowMemoryAscii (name, buffer, bufferSize, coordsOut, normalsOut,
+			                           trisOut, solidRangesOut, options, source);
+
+		typedef typename TNumberContainer1::value_type	number_t;
+		typedef typename TIndexContainer1::value_type	index_t;
+
+		coordsOut.clear();
+		normalsOut.clear();
+		trisOut.clear();
+		solidRangesOut.clear();
+
+		const char* end = buffer + bufferSize;
+
+	//	split the buffer at lines starting with 'facet', so that each facet is
+	//	parsed completely by a single thread.
+		const unsigned int numChunks = NumWorkerThreads (options.numThreads, bufferSize, 1 << 20);
+		vector<const char*> chunkBegin (numChunks + 1, end);
+		chunkBegin[0] = buffer;
+		for(size_t i = 1; i < numChunks; ++i){
+			const char* guess = max (buffer + i * (bufferSize / numChunks), chunkBegin[i - 1]);
+			chunkBegin[i] = FindFacetLine (buffer, guess, end);
+		}
+
+		vector<AsciiChunk <number_t, index_t> > chunks (numChunks);
+		ParallelForChunks (numChunks, numChunks,
+			[&] (size_t, size_t begin, size_t chunkEnd) {
+				for(size_t i = begin; i < chunkEnd; ++i)
+					ParseAsciiRange (chunkBegin[i], chunkBegin[i + 1], chunks[i]);
+			});
+
+		for(size_t i = 0; i < numChunks; ++i){
+			if(chunks[i].errorPos){
+				const size_t lineCount = 1 + count (buffer, chunks[i].errorPos, '\n');
+				STL_READER_THROW("ERROR while reading from " << name << ": "
+					<< chunks[i].errorMsg << " in line " << lineCount);
+			}
+		}
+
+	//	concatenate the chunks. Each chunk is copied by its own thread.
+		vector<size_t> coordOffset (numChunks + 1, 0);
+		vector<size_t> triOffset (numChunks + 1, 0);
+		vector<size_t> normalOffset (numChunks + 1, 0);
+		for(size_t i = 0; i < numChunks; ++i){
+			coordOffset[i + 1] = coordOffset[i] + chunks[i].coords.size();
+			triOffset[i + 1] = triOffset[i] + chunks[i].tris.size();
+			normalOffset[i + 1] = normalOffset[i] + chunks[i].normals.size();
+			for(size_t j = 0; j < chunks[i].solids.size(); ++j)
+				solidRangesOut.push_back(static_cast<index_t> (triOffset[i] / 3 + chunks[i].solids[j]));
+		}
+		solidRangesOut.push_back(static_cast<index_t> (triOffset[numChunks] / 3));
+
+		vector<CoordWithIndex <number_t, index_t> > coordsWithIndex;
+		if(numChunks == 1)
+			coordsWithIndex.swap (chunks[0].coords);
+		else
+			coordsWithIndex.resize (coordOffset[numChunks]);
+		normalsOut.resize (normalOffset[numChunks]);
+		trisOut.resize (triOffset[numChunks]);
+
+		ParallelForChunks (numChunks, numChunks,
+			[&] (size_t, size_t begin, size_t chunkEnd) {
+				for(size_t i = begin; i < chunkEnd; ++i){
+					AsciiChunk <number_t, index_t>& chunk = chunks[i];
+					const index_t offset = static_cast<index_t> (coordOffset[i]);
+					if(numChunks > 1){
+						for(size_t j = 0; j < chunk.coords.size(); ++j){
+							coordsWithIndex[offset + j] = chunk.coords[j];
+							coordsWithIndex[offset + j].index += offset;
+						}
+					}
+					for(size_t j = 0; j < chunk.tris.size(); ++j)
+						trisOut[triOffset[i] + j] = chunk.tris[j] + offset;
+					for(size_t j = 0; j < chunk.normals.size(); ++j)
+						normalsOut[normalOffset[i] + j] = chunk.normals[j];
+					vector<CoordWithIndex <number_t, index_t> > ().swap (chunk.coords);
+				}
+			});
+
+		vector<AsciiChunk <number_t, index_t> > ().swap (chunks);
+		RecordPeakRss (options, &ReadStats::parsePeakRss);
+
+		WeldCorners (coordsOut, normalsOut, trisOut, solidRangesOut, coordsWithIndex, options);
+		RecordPeakRss (options, &ReadStats::weldPeakRss);
+
+		return true;
+	}
+
+	// Streaming inflate (RFC 1951) of a deflate stream which is completely in
+	// memory. The decoding follows the one of stb_image.h, which however only
+	// inflates into a single buffer at once. This one hands out its output
+	// while decoding proceeds, so that it can be parsed at the same time.
+	class Inflater {
+	public:
+		// maximum number of bytes which are written behind the limit given to inflate
+		static const size_t MAX_OVERSHOOT = 258;
+
+		Inflater (const unsigned char* data, size_t size) :
+			m_in (data),
+			m_inEnd (data + size),
+			m_bits (0),
+			m_numBits (0),
+			m_numPadBytes (0),
+			m_error (NULL),
+			m_blockEnded (false),
+			m_finished (false)
+		{}
+
+		// decodes into out until the stream ends or limit bytes have been
+		// produced. out is enlarged as required. Every flushSize bytes,
+		// flush(numProduced) is called. It may resize out and returns the new
+		// limit. Returns false on corrupt data, see error().
+		template <class TFlush>
+		bool inflate (std::vector<char>& out, size_t limit, size_t flushSize,
+		              TFlush flush, size_t& numProducedOut)
+		{
+			m_out = &out;
+			m_pos = 0;
+			m_limit = limit;
+			m_finished = false;
+
+			bool last = false;
+			size_t nextFlush = flushSize;
+			while(!last && m_pos < m_limit){
+				last = bits (1) != 0;
+				const unsigned int type = bits (2);
+
+				bool ok;
+				if(type == 0)
+					ok = stored_block ();
+				else if(type == 1){
+					build_fixed_tables ();
+					ok = huffman_block (nextFlush, flushSize, flush);
+				}
+				else if(type == 2)
+					ok = read_dynamic_tables () && huffman_block (nextFlush, flushSize, flush);
+				else
+					ok = fail ("bad block type");
+
+				if(!ok)
+					return false;
+				if(m_numPadBytes * 8 > static_cast<size_t> (m_numBits))
+					return fail ("unexpected end of compressed data");
+				m_finished = last && m_blockEnded;
+
+				if(m_pos >= nextFlush){
+					m_limit = flush (m_pos);
+					nextFlush = m_pos + flushSize;
+				}
+			}
+
+			numProducedOut = m_pos;
+			return true;
+		}
+
+		const char* error () const	{return m_error;}
+
+		// true once the final block has been decoded completely, i.e. the
+		// stream was not cut short by the limit
+		bool finished () const		{return m_finished;}
+
+		// first byte behind the deflate stream, valid once finished
+		const unsigned char* stream_end () const
+		{
+			return m_in - (m_numBits / 8 - m_numPadBytes);
+		}
+
+	private:
+		static const int FAST_BITS = 9;
+
+		// canonical huffman code with a lookup table for codes of up to FAST_BITS bits
+		struct Huffman {
+			unsigned short	fast[1 << FAST_BITS];	// (length << 9) | symbol, 0 for longer codes
+			unsigned short	firstCode[16];
+			unsigned short	firstSymbol[16];
+			int				maxCode[17];			// shifted to 16 bits
+			unsigned char	size[288];
+			unsigned short	value[288];
+		};
+
+		bool fail (const char* msg)
+		{
+			m_error = msg;
+			return false;
+		}
+
+		// bytes behind the end of the input are read as zeros and counted
+		void refill ()
+		{
+			while(m_numBits <= 56){
+				uint64_t b = 0;
+				if(m_in < m_inEnd)
+					b = *m_in++;
+				else
+					++m_numPadBytes;
+				m_bits |= b << m_numBits;
+				m_numBits += 8;
+			}
+		}
+
+		unsigned int bits (int n)
+		{
+			if(m_numBits < n)
+				refill ();
+			const unsigned int v = static_cast<unsigned int> (m_bits & ((uint64_t(1) << n) - 1));
+			m_bits >>= n;
+			m_numBits -= n;
+			return v;
+		}
+
+		static int reverse_bits (int v, int numBits)
+		{
+			int r = 0;
+			for(int i = 0; i < numBits; ++i, v >>= 1)
+				r = (r << 1) | (v & 1);
+			return r;
+		}
+
+		bool build_huffman (Huffman& h, const unsigned char* sizes, int num)
+		{
+			int count[17] = {0};
+			memset (h.fast, 0, sizeof(h.fast));
+			for(int i = 0; i < num; ++i)
+				++count[sizes[i]];
+			count[0] = 0;
+
+			int nextCode[16];
+			int code = 0, k = 0;
+			for(int i = 1; i < 16; ++i){
+				if(count[i] > (1 << i))
+					return fail ("bad code lengths");
+				nextCode[i] = code;
+				h.firstCode[i] = static_cast<unsigned short> (code);
+				h.firstSymbol[i] = static_cast<unsigned short> (k);
+				code += count[i];
+				if(count[i] && code - 1 >= (1 << i))
+					return fail ("bad code lengths");
+				h.maxCode[i] = code << (16 - i);
+				code <<= 1;
+				k += count[i];
+			}
+			h.maxCode[16] = 0x10000;
+
+			for(int i = 0; i < num; ++i){
+				const int s = sizes[i];
+				if(!s)
+					continue;
+				const int c = nextCode[s] - h.firstCode[s] + h.firstSymbol[s];
+				h.size[c] = static_cast<unsigned char> (s);
+				h.value[c] = static_cast<unsigned short> (i);
+				if(s <= FAST_BITS){
+					for(int j = reverse_bits (nextCode[s], s); j < (1 << FAST_BITS); j += 1 << s)
+						h.fast[j] = static_cast<unsigned short> ((s << 9) | i);
+				}
+				++nextCode[s];
+			}
+			return true;
+		}
+
+		// returns the next symbol or -1 for an invalid code
+		int decode (const Huffman& h)
+		{
+			if(m_numBits < 16)
+				refill ();
+
+			const int f = h.fast[m_bits & ((1 << FAST_BITS) - 1)];
+			if(f){
+				m_bits >>= f >> 9;
+				m_numBits -= f >> 9;
+				return f & 511;
+			}
+
+			const int k = reverse_bits (static_cast<int> (m_bits & 0xFFFF), 16);
+			int s = FAST_BITS + 1;
+			while(k >= h.maxCode[s])
+				++s;
+			if(s >= 16)
+				return -1;
+			const int c = (k >> (16 - s)) - h.firstCode[s] + h.firstSymbol[s];
+			if(c >= 288 || h.size[c] != s)
+				return -1;
+			m_bits >>= s;
+			m_numBits -= s;
+			return h.value[c];
+		}
+
+		void build_fixed_tables ()
+		{
+			unsigned char sizes[288];
+			memset (sizes, 8, 144);
+			memset (sizes + 144, 9, 112);
+			memset (sizes + 256, 7, 24);
+			memset (sizes + 280, 8, 8);
+			build_huffman (m_lit, sizes, 288);
+			memset (sizes, 5, 32);
+			build_huffman (m_dist, sizes, 32);
+		}
+
+		bool read_dynamic_tables ()
+		{
+			static const unsigned char order[19] =
+				{16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+			const int numLit = static_cast<int> (bits (5)) + 257;
+			const int numDist = static_cast<int> (bits (5)) + 1;
+			const int numCodeLen = static_cast<int> (bits (4)) + 4;
+
+			unsigned char codeLenSizes[19] = {0};
+			for(int i = 0; i < numCodeLen; ++i)
+				codeLenSizes[order[i]] = static_cast<unsigned char> (bits (3));
+
+			Huffman codeLen;
+			if(!build_huffman (codeLen, codeLenSizes, 19))
+				return false;
+
+			unsigned char sizes[286 + 32 + 137];
+			int n = 0;
+			while(n < numLit + numDist){
+				int c = decode (codeLen);
+				if(c < 0 || c >= 19)
+					return fail ("bad code lengths");
+				if(c < 16){
+					sizes[n++] = static_cast<unsigned char> (c);
+					continue;
+				}
+
+				unsigned char fill = 0;
+				if(c == 16){
+					if(n == 0)
+						return fail ("bad code lengths");
+					c = static_cast<int> (bits (2)) + 3;
+					fill = sizes[n - 1];
+				}
+				else if(c == 17)
+					c = static_cast<int> (bits (3)) + 3;
+				else
+					c = static_cast<int> (bits (7)) + 11;
+
+				if(numLit + numDist - n < c)
+					return fail ("bad code lengths");
+				memset (sizes + n, fill, c);
+				n += c;
+			}
+
+			return build_huffman (m_lit, sizes, numLit)
+				&& build_huffman (m_dist, sizes + numLit, numDist);
+		}
+
+		// makes sure that n more bytes fit into the output
+		char* reserve (size_t n)
+		{
+			std::vector<char>& out = *m_out;
+			if(m_pos + n > out.size())
+				out.resize (std::max (std::max (out.size() * 2, m_pos + n), size_t(1) << 16));
+			return &out[0];
+		}
+
+		bool stored_block ()
+		{
+		//	skip to the next byte boundary
+			bits (m_numBits & 7);
+			const unsigned int len = bits (16);
+			const unsigned int nlen = bits (16);
+			if((len ^ 0xFFFF) != nlen)
+				return fail ("corrupt stored block");
+
+		//	bytes behind the limit are not needed. Bytes which were already
+		//	loaded into the bit buffer come first.
+			size_t left = std::min<size_t> (len, m_limit - m_pos);
+			m_blockEnded = (left == len);
+			char* dst = reserve (left);
+			while(left > 0 && m_numBits >= 8){
+				dst[m_pos++] = static_cast<char> (bits (8));
+				--left;
+			}
+
+			if(static_cast<size_t> (m_inEnd - m_in) < left)
+				return fail ("unexpected end of compressed data");
+			memcpy (dst + m_pos, m_in, left);
+			m_in += left;
+			m_pos += left;
+			return true;
+		}
+
+		template <class TFlush>
+		bool huffman_block (size_t& nextFlush, size_t flushSize, TFlush& flush)
+		{
+			static const unsigned short lengthBase[29] = {
+				3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+				35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+			static const unsigned char lengthExtra[29] = {
+				0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+				3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+			static const unsigned short distBase[30] = {
+				1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+				257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+				8193, 12289, 16385, 24577};
+			static const unsigned char distExtra[30] = {
+				0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+				7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+			char* dst = reserve (MAX_OVERSHOOT);
+			m_blockEnded = false;
+			for(;;){
+				if(m_pos >= nextFlush){
+				//	the flush may resize the output. Once the limit is reached
+				//	it must not move anymore: binary records are decoded from
+				//	it on another thread.
+					m_limit = flush (m_pos);
+					nextFlush = m_pos + flushSize;
+					if(m_pos >= m_limit)
+						return true;
+					dst = reserve (MAX_OVERSHOOT);
+				}
+				if(m_pos >= m_limit)
+					return true;
+			//	zeros behind the end of the input could decode forever
+				if(m_numPadBytes > 8)
+					return fail ("unexpected end of compressed data");
+
+				int sym = decode (m_lit);
+				if(sym < 256){
+					if(sym < 0)
+						return fail ("bad huffman code");
+					if(m_pos >= m_out->size())
+						dst = reserve (MAX_OVERSHOOT);
+					dst[m_pos++] = static_cast<char> (sym);
+					continue;
+				}
+				if(sym == 256){
+					m_blockEnded = true;
+					return true;
+				}
+
+				sym -= 257;
+				if(sym >= 29)
+					return fail ("bad huffman code");
+				const size_t len = lengthBase[sym] + bits (lengthExtra[sym]);
+
+				const int distSym = decode (m_dist);
+				if(distSym < 0 || distSym >= 30)
+					return fail ("bad huffman code");
+				const size_t dist = distBase[distSym] + bits (distExtra[distSym]);
+				if(dist > m_pos)
+					return fail ("bad distance");
+
+				if(m_pos + len > m_out->size())
+					dst = reserve (len);
+				char* p = dst + m_pos;
+				const char* src = p - dist;
+				if(dist >= len)
+					memcpy (p, src, len);
+				else{
+					for(size_t i = 0; i < len; ++i)
+						p[i] = src[i];
+				}
+				m_pos += len;
+			}
+		}
+
+		const unsigned char*	m_in;
+		const unsigned char*	m_inEnd;
+		uint64_t				m_bits;
+		int						m_numBits;
+		size_t					m_numPadBytes;
+		const char*				m_error;
+		bool					m_blockEnded;
+		bool					m_finished;
+
+		std::vector<char>*		m_out;
+		size_t					m_pos;
+		size_t					m_limit;
+
+		Huffman					m_lit;
+		Huffman					m_dist;
+	};
+
+	// locates the deflate stream of gzip (RFC 1952) or zlib (RFC 1950) data.
+	// sizeHintOut receives the uncompressed size stored in a gzip trailer
+	// (modulo 2^32) or 0 if the size is not known in advance.
+	inline bool CompressedStreamRange (const unsigned char* data, size_t size,
+	                                   size_t& beginOut, size_t& sizeHintOut)
+	{
+		sizeHintOut = 0;
+		if(size >= 18 && data[0] == 0x1F && data[1] == 0x8B && data[2] == 8){
+			const unsigned char flags = data[3];
+			size_t p = 10;
+			if(flags & 4)	// FEXTRA
+				p += 2 + (data[p] | (data[p + 1] << 8));
+			for(int field = 8; field <= 16; field <<= 1){	// FNAME, FCOMMENT
+				if(flags & field){
+					while(p < size && data[p])
+						++p;
+					++p;
+				}
+			}
+			if(flags & 2)	// FHCRC
+				p += 2;
+			if(p + 8 > size)
+				return false;
+
+			beginOut = p;
+			for(size_t i = 0; i < 4; ++i)
+				sizeHintOut |= static_cast<size_t> (data[size - 4 + i]) << (8 * i);
+			return true;
+		}
+
+	//	compression method deflate, no preset dictionary, valid check bits
+		if(size >= 6 && (data[0] & 0x0F) == 8 && (data[0] >> 4) <= 7
+		   && !(data[1] & 0x20) && ((data[0] << 8) | data[1]) % 31 == 0)
+		{
+			beginOut = 2;
+			return true;
+		}
+		return false;
+	}
+
+	// CRC-32 as stored in gzip trailers, processes 8 bytes per step
+	inline uint32_t Crc32 (const unsigned char* data, size_t size)
+	{
+		struct Table {
+			uint32_t v[8][256];
+			Table ()
+			{
+				for(uint32_t i = 0; i < 256; ++i){
+					uint32_t c = i;
+					for(int k = 0; k < 8; ++k)
+						c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+					v[0][i] = c;
+				}
+				for(int t = 1; t < 8; ++t)
+					for(int i = 0; i < 256; ++i)
+						v[t][i] = (v[t - 1][i] >> 8) ^ v[0][v[t - 1][i] & 0xFF];
+			}
+		};
+		static const Table table;
+		const uint32_t (&v)[8][256] = table.v;
+
+		uint32_t crc = 0xFFFFFFFFu;
+		for(; size >= 8; size -= 8, data += 8){
+			const uint32_t lo = crc ^ (data[0] | (data[1] << 8) | (data[2] << 16)
+			                           | (static_cast<uint32_t> (data[3]) << 24));
+			crc = v[7][lo & 0xFF] ^ v[6][(lo >> 8) & 0xFF] ^ v[5][(lo >> 16) & 0xFF] ^ v[4][lo >> 24]
+			    ^ v[3][data[4]] ^ v[2][data[5]] ^ v[1][data[6]] ^ v[0][data[7]];
+		}
+		for(; size > 0; --size, ++data)
+			crc = (crc >> 8) ^ v[0][(crc ^ *data) & 0xFF];
+		return crc ^ 0xFFFFFFFFu;
+	}
+
+	// Adler-32 as stored in zlib trailers
+	inline uint32_t Adler32 (const unsigned char* data, size_t size)
+	{
+		uint32_t a = 1, b = 0;
+		while(size > 0){
+		//	largest block for which b cannot overflow before the modulo
+			const size_t n = std::min<size_t> (size, 5552);
+			for(size_t i = 0; i < n; ++i){
+				a += data[i];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+			data += n;
+			size -= n;
+		}
+		return (b << 16) | a;
+	}
+
+	// compares the gzip CRC-32 and size or the zlib Adler-32 behind the
+	// deflate stream, which ends at streamEnd, with the inflated data
+	inline bool CompressedChecksumMatches (const unsigned char* buffer, size_t bufferSize,
+	                                       const unsigned char* streamEnd,
+	                                       const char* data, size_t size)
+	{
+		const unsigned char* u = reinterpret_cast<const unsigned char*> (data);
+		const size_t trailerBegin = static_cast<size_t> (streamEnd - buffer);
+		if(buffer[0] == 0x1F && buffer[1] == 0x8B){
+			if(trailerBegin + 8 > bufferSize)
+				return false;
+			const unsigned char* t = streamEnd;
+			const uint32_t crc = t[0] | (t[1] << 8) | (t[2] << 16) | (static_cast<uint32_t> (t[3]) << 24);
+			const uint32_t isize = t[4] | (t[5] << 8) | (t[6] << 16) | (static_cast<uint32_t> (t[7]) << 24);
+			return isize == static_cast<uint32_t> (size) && crc == Crc32 (u, size);
+		}
+
+		if(trailerBegin + 4 > bufferSize)
+			return false;
+		const unsigned char* t = streamEnd;
+		const uint32_t adler = (static_cast<uint32_t> (t[0]) << 24) | (t[1] << 16) | (t[2] << 8) | t[3];
+		return adler == Adler32 (u, size);
+	}
+
+	// reads gzip or zlib compressed stl data. Decompression runs on its own
+	// thread. Binary triangle records are decoded as soon as they have been
+	// inflated, ascii data is parsed once it is complete.
+	template <class TNumberContainer1, class TNumberContainer2,
+			  class TIndexContainer1, class TIndexContainer2>
+	bool ReadCompressedBuffer (const char* name,
+	                           const char* buffer,
+	                           size_t bufferSize,
+	                           TNumberContainer1& coordsOut,
+	                           TNumberContainer2& normalsOut,
+	                           TIndexContainer1& trisOut,
+	                           TIndexContainer2& solidRangesOut,
+	                           const ReadOptions& options)
+	{
+		using namespace std;
+
+		typedef typename TNumberContainer1::value_type	number_t;
+		typedef typename TIndexContainer1::value_type	index_t;
+
+		const unsigned char* in = reinterpret_cast<const unsigned char*> (buffer);
+		size_t begin = 0, sizeHint = 0;
+		STL_READER_COND_THROW(!CompressedStreamRange(in, bufferSize, begin, sizeHint),
+			"ERROR while reading from " << name << ": unsupported compressed data");
+
+		vector<char> data (sizeHint > 0 ? sizeHint + Inflater::MAX_OVERSHOOT
+		                                : max<size_t> (bufferSize * 4, 1 << 16));
+
+	//	state shared with the decompression thread. Once 'binary' is set, data
+	//	has its final size and bytes below 'available' may be read.
+		mutex m;
+		condition_variable cond;
+		size_t available = 0;
+		size_t numTris = 0;
+		bool formatKnown = false;
+		bool binary = false;
+		bool done = false;
+		bool inflated = false;
+
+		Inflater inflater (in + begin, bufferSize - begin);
+		size_t numInflated = 0;
+		const char* inflateError = NULL;
+
+		thread decompressor ([&] {
+			const auto flush = [&] (size_t numProduced) -> size_t {
+				size_t limit = numeric_limits<size_t>::max();
+				if(!formatKnown && !options.lowMemory && numProduced >= BINARY_HEADER_SIZE){
+				//	the header decides whether the triangles can be decoded
+				//	right away. Without a size hint, data starting with
+				//	'solid' waits for the complete file.
+					size_t n = 0;
+					BinaryTriangleCount (&data[0], numProduced, n);
+					const size_t binarySize = BINARY_HEADER_SIZE + n * BINARY_TRI_SIZE;
+					const bool isBinary = (sizeHint > 0 && (binarySize & 0xFFFFFFFF) == sizeHint)
+					                   || !StlBufferHasASCIIFormat (&data[0], numProduced);
+					if(isBinary){
+						if(data.size() < binarySize + Inflater::MAX_OVERSHOOT)
+							data.resize (binarySize + Inflater::MAX_OVERSHOOT);
+						limit = binarySize;
+					}
+
+					lock_guard<mutex> lock (m);
+					formatKnown = true;
+					binary = isBinary;
+					numTris = n;
+				}
+				if(formatKnown && binary){
+					limit = BINARY_HEADER_SIZE + numTris * BINARY_TRI_SIZE;
+					lock_guard<mutex> lock (m);
+					available = numProduced;
+					cond.notify_one ();
+				}
+				return limit;
+			};
+
+			bool ok = false;
+			try {
+				ok = inflater.inflate (data, numeric_limits<size_t>::max(), 1 << 18,
+				                       flush, numInflated);
+				if(ok)
+					flush (numInflated);
+			}
+			catch (std::bad_alloc&) {
+				ok = false;
+			}
+
+			lock_guard<mutex> lock (m);
+			inflateError = ok ? NULL : inflater.error () ? inflater.error () : "out of memory";
+			inflated = ok;
+			available = numInflated;
+			done = true;
+			cond.notify_one ();
+		});
+
+	//	decode binary triangle records while the decompressor proceeds
+		vector<CoordWithIndex <number_t, index_t> > coordsWithIndex;
+		size_t numDecoded = 0;
+		{
+			unique_lock<mutex> lock (m);
+			bool allocated = false;
+			for(;;){
+				cond.wait (lock, [&] {return done || (binary && available >= BINARY_HEADER_SIZE
+				                   + (numDecoded + 1) * BINARY_TRI_SIZE);});
+				if(!binary)
+					break;
+
+				const size_t numAvailable = min (numTris, (available - min (available, BINARY_HEADER_SIZE))
+				                                          / BINARY_TRI_SIZE);
+				const bool finished = done;
+				lock.unlock ();
+
+				if(!allocated){
+					coordsWithIndex.resize (numTris * 3);
+					normalsOut.resize (numTris * 3);
+					trisOut.resize (numTris * 3);
+					allocated = true;
+				}
+				DecodeBinaryTriangles (&data[0], numDecoded, numAvailable, normalsOut,
+				                       coordsWithIndex, trisOut);
+				numDecoded = numAvailable;
+
+				lock.lock ();
+				if(finished)
+					break;
+			}
+		}
+		decompressor.join ();
+
+		STL_READER_COND_THROW(!inflated, "ERROR while decompressing " << name << ": " << inflateError);
+
+	//	the trailer checksum covers the whole stream. Binary data stops
+	//	inflating behind the last triangle, so bytes following it are only
+	//	known after inflating once more. data is not shared anymore.
+		const unsigned char* streamEnd = inflater.stream_end ();
+		if(!inflater.finished ()){
+			Inflater whole (in + begin, bufferSize - begin);
+			const auto keep = [] (size_t) {return numeric_limits<size_t>::max();};
+			STL_READER_COND_THROW(!whole.inflate (data, numeric_limits<size_t>::max(),
+			                                      numeric_limits<size_t>::max(), keep, numInflated),
+				"ERROR while decompressing " << name << ": " << whole.error ());
+			streamEnd = whole.stream_end ();
+		}
+		STL_READER_COND_THROW(!CompressedChecksumMatches (in, bufferSize, streamEnd,
+		                                                  &data[0], numInflated),
+			"ERROR while decompressing " << name << ": checksum mismatch");
+
+		if(!binary){
+			RecordPeakRss (options, &ReadStats::inflatePeakRss);
+			if(StlBufferHasASCIIFormat (&data[0], numInflated))
+				return ReadAsciiBuffer (name, &data[0], numInflated, coordsOut, normalsOut,
+				                        trisOut, solidRangesOut, options);
+			return ReadStlBuffer_BINARY (&data[0], numInflated, coordsOut, normalsOut,
+			                             trisOut, solidRangesOut, options);
+		}
+
+		STL_READER_COND_THROW(numDecoded < numTris,
+			"Error while parsing binary stl data in " << name << ": decompressed data ends after "
+			<< numDecoded << " of " << numTris << " triangles");
+
+		vector<char> ().swap (data);
+		coordsOut.clear();
+		solidRangesOut.clear();
+		solidRangesOut.push_back(0);
+		solidRangesOut.push_back(static_cast<index_t> (numTris));
+		RecordPeakRss (options, &ReadStats::parsePeakRss);
+
+		WeldCorners (coordsOut, normalsOut, trisOut, solidRangesOut, coordsWithIndex, options);
+		RecordPeakRss (options, &ReadStats::weldPeakRss);
+
+		return true;
+	}
+}// end of namespace stl_reader_impl
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+		  class TIndexContainer1, class TIndexContainer2>
+bool ReadStlFile(const char* filename,
+                TNumberContainer1& coordsOut,
+                TNumberContainer2& normalsOut,
+                TIndexContainer1& trisOut,
+				TIndexContainer2& solidRangesOut,
+                const ReadOptions& options)
+{
+	using namespace stl_reader_impl;
+
+	ResetPeakRss(options);
+	{
+		MappedFile file;
+		STL_READER_COND_THROW(!file.open(filename), "Couldn't open file " << filename);
+		if(StlBufferIsCompressed(file.data(), file.size()))
+			return ReadCompressedBuffer(filename, file.data(), file.size(), coordsOut,
+			                            normalsOut, trisOut, solidRangesOut, options);
+	}
+
+	if(StlFileHasASCIIFormat(filename))
+		return ReadStlFile_ASCII(filename, coordsOut, normalsOut, trisOut, solidRangesOut, options);
+	else
+		return ReadStlFile_BINARY(filename, coordsOut, normalsOut, trisOut, solidRangesOut, options);
+}
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+		  class TIndexContainer1, class TIndexContainer2>
+bool ReadStlFile_ASCII(const char* filename,
+                       TNumberContainer1& coordsOut,
+                       TNumberContainer2& normalsOut,
+                       TIndexContainer1& trisOut,
+					   TIndexContainer2& solidRangesOut,
+                       const ReadOptions& options)
+{
+	using namespace stl_reader_impl;
+
+	ResetPeakRss(options);
+
+	MappedFile file;
+	STL_READER_COND_THROW(!file.open(filename), "Couldn't open file " << filename);
+
+	return ReadAsciiBuffer(filename, file.data(), file.size(), coordsOut,
+	                       normalsOut, trisOut, solidRangesOut, options, &file);
+}
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+		  class TIndexContainer1, class TIndexContainer2>
+bool ReadStlBuffer(const char* buffer,
+                   size_t bufferSize,
+                   TNumberContainer1& coordsOut,
+                   TNumberContainer2& normalsOut,
+                   TIndexContainer1& trisOut,
+                   TIndexContainer2& solidRangesOut,
+                   const ReadOptions& options)
+{
+	stl_reader_impl::ResetPeakRss(options);
+
+	if(StlBufferIsCompressed(buffer, bufferSize))
+		return stl_reader_impl::ReadCompressedBuffer("buffer", buffer, bufferSize, coordsOut,
+		                                             normalsOut, trisOut, solidRangesOut, options);
+	if(StlBufferHasASCIIFormat(buffer, bufferSize))
+		return ReadStlBuffer_ASCII(buffer, bufferSize, coordsOut, normalsOut, trisOut, solidRangesOut, options);
+	else
+		return ReadStlBuffer_BINARY(buffer, bufferSize, coordsOut, normalsOut, trisOut, solidRangesOut, options);
+}
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+		  class TIndexContainer1, class TIndexContainer2>
+bool ReadStlBuffer_ASCII(const char* buffer,
+                         size_t bufferSize,
+                         TNumberContainer1& coordsOut,
+                         TNumberContainer2& normalsOut,
+                         TIndexContainer1& trisOut,
+                         TIndexContainer2& solidRangesOut,
+                         const ReadOptions& options)
+{
+	stl_reader_impl::ResetPeakRss(options);
+
+	return stl_reader_impl::ReadAsciiBuffer("buffer", buffer, bufferSize, coordsOut,
+	                                        normalsOut, trisOut, solidRangesOut, options);
+}
 
 
 template <class TNumberContainer1, class TNumberContainer2,
@@ -640,7 +2930,42 @@ bool ReadStlFile_BINARY(const char* filename,
                         TNumberContainer1& coordsOut,
                         TNumberContainer2& normalsOut,
                         TIndexContainer1& trisOut,
-					    TIndexContainer2& solidRangesOut)
+					    TIndexContainer2& solidRangesOut,
+                        const ReadOptions& options)
+{
+	using namespace stl_reader_impl;
+
+	ResetPeakRss(options);
+
+	MappedFile file;
+	STL_READER_COND_THROW(!file.open(filename), "Couldnt open file " << filename);
+
+	size_t numTris = 0;
+	STL_READER_COND_THROW(!BinaryTriangleCount(file.data(), file.size(), numTris),
+		"Couldnt determine number of triangles in binary stl file " << filename);
+
+	STL_READER_COND_THROW((file.size() - BINARY_HEADER_SIZE) / BINARY_TRI_SIZE < numTris,
+		"Error while parsing binary stl file " << filename << ": file size "
+		<< file.size() << " does not match the " << numTris << " triangles of its header");
+
+	if(options.lowMemory)
+		return ReadLowMemoryBinary(filename, file.data(), file.size(), coordsOut, normalsOut,
+		                           trisOut, solidRangesOut, options, &file);
+
+	return ReadStlBuffer_BINARY(file.data(), file.size(), coordsOut, normalsOut,
+	                            trisOut, solidRangesOut, options);
+}
+
+
+template <class TNumberContainer1, class TNumberContainer2,
+		  class TIndexContainer1, class TIndexContainer2>
+bool ReadStlBuffer_BINARY(const char* buffer,
+                          size_t bufferSize,
+                          TNumberContainer1& coordsOut,
+                          TNumberContainer2& normalsOut,
+                          TIndexContainer1& trisOut,
+                          TIndexContainer2& solidRangesOut,
+                          const ReadOptions& options)
 {
 	using namespace std;
 	using namespace stl_reader_impl;
@@ -648,53 +2973,343 @@ bool ReadStlFile_BINARY(const char* filename,
 	typedef typename TNumberContainer1::value_type	number_t;
 	typedef typename TIndexContainer1::value_type	index_t;
 
+	ResetPeakRss(options);
+	if(options.lowMemory)
+		return ReadLowMemoryBinary("buffer", buffer, bufferSize, coordsOut, normalsOut,
+		                           trisOut, solidRangesOut, options, NULL);
+
 	coordsOut.clear();
 	normalsOut.clear();
 	trisOut.clear();
 	solidRangesOut.clear();
 
-	ifstream in(filename, ios::binary);
-	STL_READER_COND_THROW(!in, "Couldnt open file " << filename);
+	size_t numTris = 0;
+	STL_READER_COND_THROW(!BinaryTriangleCount(buffer, bufferSize, numTris),
+		"Error while parsing binary stl header: buffer too small");
+	STL_READER_COND_THROW((bufferSize - BINARY_HEADER_SIZE) / BINARY_TRI_SIZE < numTris,
+		"Error while parsing binary stl data: " << numTris
+		<< " triangles don't fit into " << bufferSize << " bytes");
+
+	vector<CoordWithIndex <number_t, index_t> > coordsWithIndex (numTris * 3);
+	normalsOut.resize (numTris * 3);
+	trisOut.resize (numTris * 3);
+
+//	triangle records have a fixed size, so each thread can decode its own
+//	range of triangles directly into the pre-sized arrays.
+	ParallelFor (numTris, options.numThreads,
+		[&] (size_t triBegin, size_t triEnd) {
+			DecodeBinaryTriangles (buffer, triBegin, triEnd, normalsOut,
+			                       coordsWithIndex, trisOut);
+		});
+
+	solidRangesOut.push_back(0);
+	solidRangesOut.push_back(static_cast<index_t> (numTris));
+	RecordPeakRss(options, &ReadStats::parsePeakRss);
+
+	WeldCorners (coordsOut, normalsOut, trisOut, solidRangesOut, coordsWithIndex, options);
+	RecordPeakRss(options, &ReadStats::weldPeakRss);
+
+	return true;
+}
+
+
+template <class TNumber>
+StlStreamReader<TNumber>::
+StlStreamReader (size_t batchSize) :
+	m_in (NULL),
+	m_batchSize (std::max<size_t> (batchSize, 1)),
+	m_ascii (false),
+	m_solid (0),
+	m_nextSolid (0),
+	m_numTrisRead (0),
+	m_bufPos (0),
+	m_bufEnd (0),
+	m_eof (true),
+	m_numBinaryTrisLeft (0),
+	m_lineCount (1),
+	m_numFaceVrts (0),
+	m_solidSeen (false)
+{
+}
+
+template <class TNumber>
+StlStreamReader<TNumber>::
+StlStreamReader (const char* filename, size_t batchSize) :
+	StlStreamReader (batchSize)
+{
+	open (filename);
+}
+
+template <class TNumber>
+StlStreamReader<TNumber>::
+StlStreamReader (std::istream& in, size_t batchSize) :
+	StlStreamReader (batchSize)
+{
+	open (in);
+}
+
+
+template <class TNumber>
+bool StlStreamReader<TNumber>::
+open (const char* filename)
+{
+	if(m_file.is_open())
+		m_file.close();
+
+	if(std::string (filename) == "-")
+		return open (std::cin);
+
+	m_file.open (filename, std::ios::binary);
+	m_in = NULL;
+	STL_READER_COND_THROW(!m_file, "Couldnt open file " << filename);
+	return open (m_file);
+}
+
+
+template <class TNumber>
+bool StlStreamReader<TNumber>::
+open (std::istream& in)
+{
+	using namespace stl_reader_impl;
+
+	m_in = &in;
+	m_coords.clear();
+	m_normals.clear();
+	m_solid = m_nextSolid = 0;
+	m_numTrisRead = 0;
+	m_buf.resize (1 << 20);
+	m_bufPos = m_bufEnd = 0;
+	m_eof = false;
+	m_lineCount = 1;
+	m_numFaceVrts = 0;
+	m_solidSeen = false;
+
+//	determine the stream size if possible. Pipes don't support seeking.
+	long long streamSize = -1;
+	const std::streampos start = in.tellg ();
+	if(start != std::streampos (-1) && in.seekg (0, std::ios::end)){
+		streamSize = static_cast<long long> (in.tellg () - start);
+		in.seekg (start);
+	}
+	in.clear ();
+
+	fill_buffer ();
+	const char* data = &m_buf[0];
+	const size_t size = m_bufEnd;
+
+//	same rules as StlFileHasASCIIFormat. If the size is unknown, a header
+//	starting with 'solid' which is followed by binary data indicates a binary file.
+	const char* tok = data;
+	while(tok < data + size && isspace (static_cast<unsigned char> (*tok)))
+		++tok;
+	const char* tokEnd = tok;
+	while(tokEnd < data + size && !isspace (static_cast<unsigned char> (*tokEnd)))
+		++tokEnd;
+
+	m_ascii = (tokEnd - tok == 5);
+	for(size_t i = 0; m_ascii && i < 5; ++i)
+		m_ascii = (tolower (static_cast<unsigned char> (tok[i])) == "solid"[i]);
+
+	if(m_ascii){
+		size_t numTris;
+		if(streamSize >= 0)
+			m_ascii = !(BinaryTriangleCount (data, size, numTris)
+			            && streamSize >= static_cast<long long> (BINARY_HEADER_SIZE)
+			            && static_cast<size_t> (streamSize) - BINARY_HEADER_SIZE == numTris * BINARY_TRI_SIZE);
+		else
+			m_ascii = (memchr (data, 0, size) == NULL);
+	}
+
+	if(!m_ascii){
+		STL_READER_COND_THROW(!BinaryTriangleCount (data, size, m_numBinaryTrisLeft),
+			"Couldnt determine number of triangles in binary stl stream");
+		m_bufPos = BINARY_HEADER_SIZE;
+	}
+
+	return true;
+}
+
+
+template <class TNumber>
+bool StlStreamReader<TNumber>::
+fill_buffer ()
+{
+//	move unprocessed data to the front and fill the rest of the buffer
+	if(m_bufPos > 0){
+		memmove (&m_buf[0], &m_buf[m_bufPos], m_bufEnd - m_bufPos);
+		m_bufEnd -= m_bufPos;
+		m_bufPos = 0;
+	}
+
+	if(m_bufEnd == m_buf.size())
+		m_buf.resize (m_buf.size() * 2);
+
+	if(!m_eof && m_in){
+		m_in->read (&m_buf[m_bufEnd], m_buf.size() - m_bufEnd);
+		const size_t numRead = static_cast<size_t> (m_in->gcount ());
+		m_bufEnd += numRead;
+		if(numRead == 0 || !(*m_in))
+			m_eof = true;
+		return numRead > 0;
+	}
+	return false;
+}
+
+
+template <class TNumber>
+bool StlStreamReader<TNumber>::
+read_batch ()
+{
+	m_coords.clear();
+	m_normals.clear();
+	m_solid = m_nextSolid;
+
+	if(!m_in)
+		return false;
 
-	char stl_header[80];
-	in.read(stl_header, 80);
-	STL_READER_COND_THROW(!in, "Error while parsing binary stl header in file " << filename);
+	if(m_ascii)
+		return read_ascii_batch ();
+	return read_binary_batch ();
+}
 
-	unsigned int numTris = 0;
-	in.read((char*)&numTris, 4);
-	STL_READER_COND_THROW(!in, "Couldnt determine number of triangles in binary stl file " << filename);
 
-	vector<CoordWithIndex <number_t, index_t> > coordsWithIndex;
+template <class TNumber>
+bool StlStreamReader<TNumber>::
+read_binary_batch ()
+{
+	using namespace stl_reader_impl;
+
+	const size_t numTris = std::min (m_batchSize, m_numBinaryTrisLeft);
+	m_coords.resize (numTris * 9);
+	m_normals.resize (numTris * 3);
+
+	for(size_t tri = 0; tri < numTris; ++tri){
+		if(m_bufEnd - m_bufPos < BINARY_TRI_SIZE){
+			fill_buffer ();
+			STL_READER_COND_THROW(m_bufEnd - m_bufPos < BINARY_TRI_SIZE,
+				"Error while parsing binary stl stream: stream ends after "
+				<< m_numTrisRead + tri << " of " << m_numTrisRead + m_numBinaryTrisLeft
+				<< " triangles");
+		}
 
-	for(unsigned int tri = 0; tri < numTris; ++tri){
 		float d[12];
-		in.read((char*)d, 12 * 4);
-		STL_READER_COND_THROW(!in, "Error while parsing trianlge in binary stl file " << filename);
+		memcpy (d, &m_buf[m_bufPos], 12 * sizeof(float));
+		m_bufPos += BINARY_TRI_SIZE;
 
-		for(int i = 0; i < 3; ++i)
-			normalsOut.push_back (d[i]);
+		for(size_t i = 0; i < 3; ++i)
+			m_normals[tri * 3 + i] = static_cast<TNumber> (d[i]);
+		for(size_t i = 0; i < 9; ++i)
+			m_coords[tri * 9 + i] = static_cast<TNumber> (d[i + 3]);
+	}
 
-		for(size_t ivrt = 1; ivrt < 4; ++ivrt){
-			CoordWithIndex <number_t, index_t> c;
-			for(size_t i = 0; i < 3; ++i)
-				c[i] = d[ivrt * 3 + i];
-			c.index = static_cast<index_t>(coordsWithIndex.size());
-			coordsWithIndex.push_back(c);
+	m_numBinaryTrisLeft -= numTris;
+	m_numTrisRead += numTris;
+	return numTris > 0;
+}
+
+
+template <class TNumber>
+bool StlStreamReader<TNumber>::
+read_ascii_batch ()
+{
+	using namespace stl_reader_impl;
+
+	while(num_tris() < m_batchSize){
+		const char* bufBegin = &m_buf[0];
+		const char* line = bufBegin + m_bufPos;
+		const char* end = bufBegin + m_bufEnd;
+		const char* lineEnd = static_cast<const char*> (memchr (line, '\n', end - line));
+		if(!lineEnd){
+			if(!m_eof){
+				fill_buffer ();
+				continue;
+			}
+			if(line == end)
+				break;
+		//	the last line isn't terminated by a newline
+			lineEnd = end;
 		}
 
-		trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 3));
-		trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 2));
-		trisOut.push_back(static_cast<index_t> (coordsWithIndex.size() - 1));
+		m_bufPos = std::min<size_t> (lineEnd + 1 - bufBegin, m_bufEnd);
+
+		const char* tok = SkipBlanks (line, lineEnd);
+		const char* tokEnd = TokenEnd (tok, lineEnd);
+
+		if(TokenIs (tok, tokEnd, "vertex")){
+			const char* p = tokEnd;
+			for(size_t i = 0; i < 3; ++i){
+				double v;
+				STL_READER_COND_THROW(!ParseAsciiNumber (p, lineEnd, v),
+					"ERROR while reading ascii stl stream: vertex not specified correctly in line "
+					<< m_lineCount);
+				if(m_numFaceVrts < 3)
+					m_facet[3 + m_numFaceVrts * 3 + i] = static_cast<TNumber> (v);
+			}
+			++m_numFaceVrts;
+		}
+		else if(TokenIs (tok, tokEnd, "facet")){
+			const char* normal = SkipBlanks (tokEnd, lineEnd);
+			const char* normalEnd = TokenEnd (normal, lineEnd);
+			STL_READER_COND_THROW(normal == normalEnd,
+				"ERROR while reading ascii stl stream: triangle not specified correctly in line "
+				<< m_lineCount);
+			STL_READER_COND_THROW(!TokenIs (normal, normalEnd, "normal"),
+				"ERROR while reading ascii stl stream: Missing normal specifier in line "
+				<< m_lineCount);
+
+			const char* p = normalEnd;
+			for(size_t i = 0; i < 3; ++i){
+				double v;
+				STL_READER_COND_THROW(!ParseAsciiNumber (p, lineEnd, v),
+					"ERROR while reading ascii stl stream: triangle not specified correctly in line "
+					<< m_lineCount);
+				m_facet[i] = static_cast<TNumber> (v);
+			}
+			m_numFaceVrts = 0;
+		}
+		else if(TokenIs (tok, tokEnd, "outer")){
+			const char* loop = SkipBlanks (tokEnd, lineEnd);
+			STL_READER_COND_THROW(!TokenIs (loop, TokenEnd (loop, lineEnd), "loop"),
+				"ERROR while reading ascii stl stream: expecting outer loop in line "
+				<< m_lineCount);
+		}
+		else if(TokenIs (tok, tokEnd, "endfacet")){
+			STL_READER_COND_THROW(m_numFaceVrts != 3,
+				"ERROR while reading ascii stl stream: bad number of vertices specified for face in line "
+				<< m_lineCount);
+			m_normals.insert (m_normals.end(), m_facet, m_facet + 3);
+			m_coords.insert (m_coords.end(), m_facet + 3, m_facet + 12);
+			++m_numTrisRead;
+		}
+		else if(TokenIs (tok, tokEnd, "solid")){
+		//	a batch never spans several solids
+			if(m_solidSeen){
+				++m_nextSolid;
+				if(num_tris() > 0){
+					++m_lineCount;
+					return true;
+				}
+				m_solid = m_nextSolid;
+			}
+			m_solidSeen = true;
+		}
 
-		char addData[2];
-		in.read(addData, 2);
-		STL_READER_COND_THROW(!in, "Error while parsing additional triangle data in binary stl file " << filename);
+		++m_lineCount;
 	}
 
-	solidRangesOut.push_back(0);
-	solidRangesOut.push_back(static_cast<index_t> (trisOut.size() / 3));
+	return num_tris() > 0;
+}
+
+
+template <class TNumber, class TCallback>
+bool ReadStlFileBatches (const char* filename, TCallback callback, size_t batchSize)
+{
+	StlStreamReader<TNumber> reader (batchSize);
+	if(!reader.open (filename))
+		return false;
 
-	RemoveDoubles (coordsOut, trisOut, coordsWithIndex);
+	while(reader.read_batch ())
+		callback (reader.raw_coords(), reader.raw_normals(), reader.num_tris(), reader.solid_index());
 
 	return true;
 }
@@ -702,15 +3317,45 @@ bool ReadStlFile_BINARY(const char* filename,
 
 inline bool StlFileHasASCIIFormat(const char* filename)
 {
-	using namespace std;
-	ifstream in(filename);
-	STL_READER_COND_THROW(!in, "Couldnt open file " << filename);
+	using namespace stl_reader_impl;
+
+	MappedFile file;
+	STL_READER_COND_THROW(!file.open(filename), "Couldnt open file " << filename);
+
+	return StlBufferHasASCIIFormat(file.data(), file.size());
+}
+
 
-	string firstWord;
-	in >> firstWord;
-	transform(firstWord.begin(), firstWord.end(), firstWord.begin(), ::tolower);
+inline bool StlBufferHasASCIIFormat(const char* data, size_t size)
+{
+	using namespace stl_reader_impl;
+
+	if(HasBinaryLayout(data, size))
+		return false;
+
+//	compare the first word of the file with 'solid', ignoring case
+	size_t i = 0;
+	while(i < size && isspace(static_cast<unsigned char>(data[i])))
+		++i;
+
+	const char* solid = "solid";
+	for(size_t j = 0; j < 5; ++j, ++i){
+		if(i >= size || tolower(static_cast<unsigned char>(data[i])) != solid[j])
+			return false;
+	}
+
+	return i == size || isspace(static_cast<unsigned char>(data[i]));
+}
+
+
+inline bool StlBufferIsCompressed(const char* data, size_t size)
+{
+	using namespace stl_reader_impl;
 
-	return firstWord.compare("solid") == 0;
+	size_t begin, sizeHint;
+	if(!CompressedStreamRange(reinterpret_cast<const unsigned char*>(data), size, begin, sizeHint))
+		return false;
+	return sizeHint > 0 || !HasBinaryLayout(data, size);
 }
 
 } // end of namespace stl_reader
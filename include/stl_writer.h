@@ -0,0 +1,350 @@
+/** \file
+ * \brief	Provides functions to write **stl files** from user provided arrays
+ *
+ * This is the counterpart to `stl_reader.h`. The central function of this file
+ * is `WriteStlFile(...)`. It takes coordinate, normal and triangle-corner-index
+ * arrays as they are filled by `stl_reader::ReadStlFile(...)` and writes them
+ * to a *Binary* stl file or, if requested through `WriteOptions`, to an *ASCII*
+ * stl file.
+ *
+ * Triangle records are encoded on several threads into one pre-sized buffer,
+ * which is then written to the file with a single call.
+ *
+ * The functions operate on the same template container types as the reader.
+ *
+ *
+ * ### Usage example
+ *
+ * \code
+ *	try {
+ *		std::vector<float> coords, normals;
+ *		std::vector<unsigned int> tris, solids;
+ *		stl_reader::ReadStlFile ("geometry.stl", coords, normals, tris, solids);
+ *
+ *		stl_writer::WriteOptions options;
+ *		options.numThreads = 0;
+ *		stl_writer::WriteStlFile ("copy.stl", coords, normals, tris, options);
+ *	}
+ *	catch (std::exception& e) {
+ *		std::cout << e.what() << std::endl;
+ *	}
+ * \endcode
+ *
+ * If `STL_READER_NO_EXCEPTIONS` is defined before including 'stl_writer.h',
+ * functions will return `false` if an error occurred.
+ */
+
+#ifndef __H__STL_WRITER
+#define __H__STL_WRITER
+
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "stl_reader.h"
+
+
+namespace stl_writer {
+
+/// File formats which can be written
+enum Format {
+	FORMAT_BINARY,
+	FORMAT_ASCII
+};
+
+/// Options which control how a stl file is written
+struct WriteOptions {
+	WriteOptions () :
+		format (FORMAT_BINARY),
+		numThreads (1)
+	{}
+
+	/// whether a binary or an ASCII file is written.
+	Format			format;
+
+	/// number of threads used to encode triangles. 0 uses all hardware threads.
+	/** The written file does not depend on the number of threads.*/
+	unsigned int	numThreads;
+
+	/// name of the solid in ASCII files. Also stored in the header of binary files.
+	std::string		solidName;
+};
+
+/// Writes triangles to a binary or ASCII stl file
+/**
+ * \param filename	[in] The name of the file which shall be written
+ *
+ * \param coords	[in] 3d coordinates, one triple of entries per vertex.
+ *
+ * \param normals	[in] Face normals, one triple of entries per triangle.
+ *					If it holds fewer entries than tris, normals are computed
+ *					from the triangle corners instead.
+ *
+ * \param tris		[in] Triangle corner indices, one triple of entries per triangle.
+ *					Entries index vertices, i.e. triples in coords.
+ *
+ * \param options	[in] Selects the file format and the number of threads
+ *					used for encoding. See WriteOptions.
+ *
+ * \returns	true if the file was successfully written. If an error occurs,
+ *			an std::runtime_error is thrown or false is returned if
+ *			STL_READER_NO_EXCEPTIONS is defined.
+ */
+template <class TNumberContainer, class TIndexContainer>
+bool WriteStlFile (const char* filename,
+                   const TNumberContainer& coords,
+                   const TNumberContainer& normals,
+                   const TIndexContainer& tris,
+                   const WriteOptions& options = WriteOptions());
+
+
+/// Encodes triangles as a binary stl file into the given buffer
+/** Parameters are the same as for WriteStlFile. The buffer is resized to
+ * 84 + 50 * numTris bytes. Records are encoded on options.numThreads threads.
+ * The triangle count of the file has 32 bits, more triangles throw an
+ * std::runtime_error, or leave the buffer empty if STL_READER_NO_EXCEPTIONS
+ * is defined.*/
+template <class TNumberContainer, class TIndexContainer>
+void WriteStlBuffer_BINARY (std::vector<char>& bufferOut,
+                            const TNumberContainer& coords,
+                            const TNumberContainer& normals,
+                            const TIndexContainer& tris,
+                            const WriteOptions& options = WriteOptions());
+
+
+/// Encodes triangles as an ASCII stl file into the given buffer
+/** Parameters are the same as for WriteStlFile. Ranges of triangles are
+ * formatted on options.numThreads threads and concatenated afterwards.*/
+template <class TNumberContainer, class TIndexContainer>
+void WriteStlBuffer_ASCII (std::string& bufferOut,
+                           const TNumberContainer& coords,
+                           const TNumberContainer& normals,
+                           const TIndexContainer& tris,
+                           const WriteOptions& options = WriteOptions());
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//	IMPLEMENTATION
+////////////////////////////////////////////////////////////////////////////////
+
+
+namespace stl_writer_impl {
+
+	// Triangles a binary file can count, the count is 32 bits wide
+	const size_t BINARY_MAX_TRIS = 0xFFFFFFFF;
+
+	// Face normal of triangle tri. The given normal is used if present,
+	// otherwise it is computed from the triangle corners.
+	template <class TNumberContainer, class TIndexContainer>
+	void TriangleNormal (const TNumberContainer& coords,
+	                     const TNumberContainer& normals,
+	                     const TIndexContainer& tris,
+	                     size_t tri,
+	                     float* nOut)
+	{
+		if(normals.size() >= tris.size()){
+			for(size_t i = 0; i < 3; ++i)
+				nOut[i] = static_cast<float> (normals[tri * 3 + i]);
+			return;
+		}
+
+		double c[3][3];
+		for(size_t icorner = 0; icorner < 3; ++icorner){
+			for(size_t i = 0; i < 3; ++i)
+				c[icorner][i] = coords[tris[tri * 3 + icorner] * 3 + i];
+		}
+
+		const double e1[3] = {c[1][0] - c[0][0], c[1][1] - c[0][1], c[1][2] - c[0][2]};
+		const double e2[3] = {c[2][0] - c[0][0], c[2][1] - c[0][1], c[2][2] - c[0][2]};
+		double n[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+		               e1[2] * e2[0] - e1[0] * e2[2],
+		               e1[0] * e2[1] - e1[1] * e2[0]};
+
+		const double len = std::sqrt (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		for(size_t i = 0; i < 3; ++i)
+			nOut[i] = static_cast<float> (len > 0 ? n[i] / len : 0);
+	}
+
+	// Binary records are written in little endian byte order, just like
+	// stl_reader assumes when decoding them.
+	template <class TNumberContainer, class TIndexContainer>
+	void EncodeBinaryTriangles (char* data,
+	                            size_t triBegin,
+	                            size_t triEnd,
+	                            const TNumberContainer& coords,
+	                            const TNumberContainer& normals,
+	                            const TIndexContainer& tris)
+	{
+		using namespace stl_reader::stl_reader_impl;
+
+		char* rec = data + BINARY_HEADER_SIZE + triBegin * BINARY_TRI_SIZE;
+		for(size_t tri = triBegin; tri < triEnd; ++tri, rec += BINARY_TRI_SIZE){
+			float d[12];
+			TriangleNormal (coords, normals, tris, tri, d);
+
+			for(size_t icorner = 0; icorner < 3; ++icorner){
+				const size_t vi = static_cast<size_t> (tris[tri * 3 + icorner]);
+				for(size_t i = 0; i < 3; ++i)
+					d[(icorner + 1) * 3 + i] = static_cast<float> (coords[vi * 3 + i]);
+			}
+
+			memcpy (rec, d, 12 * sizeof(float));
+			rec[48] = rec[49] = 0;
+		}
+	}
+
+	template <class TNumberContainer, class TIndexContainer>
+	void FormatAsciiTriangles (std::string& out,
+	                           size_t triBegin,
+	                           size_t triEnd,
+	                           const TNumberContainer& coords,
+	                           const TNumberContainer& normals,
+	                           const TIndexContainer& tris)
+	{
+		typedef typename TNumberContainer::value_type	number_t;
+
+		//	enough digits so that reading the file yields the same numbers again
+		const int digits = std::numeric_limits<number_t>::max_digits10;
+
+		char line[128];
+		for(size_t tri = triBegin; tri < triEnd; ++tri){
+			float n[3];
+			TriangleNormal (coords, normals, tris, tri, n);
+
+			snprintf (line, sizeof(line), "  facet normal %.9g %.9g %.9g\n    outer loop\n",
+			          n[0], n[1], n[2]);
+			out += line;
+
+			for(size_t icorner = 0; icorner < 3; ++icorner){
+				const size_t vi = static_cast<size_t> (tris[tri * 3 + icorner]);
+				snprintf (line, sizeof(line), "      vertex %.*g %.*g %.*g\n",
+				          digits, static_cast<double> (coords[vi * 3]),
+				          digits, static_cast<double> (coords[vi * 3 + 1]),
+				          digits, static_cast<double> (coords[vi * 3 + 2]));
+				out += line;
+			}
+
+			out += "    endloop\n  endfacet\n";
+		}
+	}
+
+	inline bool WriteBufferToFile (const char* filename, const char* data, size_t size)
+	{
+		std::ofstream out (filename, std::ios::out | std::ios::binary | std::ios::trunc);
+		if(!out)
+			return false;
+		out.write (data, static_cast<std::streamsize> (size));
+		out.close ();
+		return !out.fail ();
+	}
+
+}// end of namespace stl_writer_impl
+
+
+template <class TNumberContainer, class TIndexContainer>
+bool WriteStlFile (const char* filename,
+                   const TNumberContainer& coords,
+                   const TNumberContainer& normals,
+                   const TIndexContainer& tris,
+                   const WriteOptions& options)
+{
+	using namespace stl_writer_impl;
+
+	bool written;
+	if(options.format == FORMAT_ASCII){
+		std::string buffer;
+		WriteStlBuffer_ASCII (buffer, coords, normals, tris, options);
+		written = WriteBufferToFile (filename, buffer.data(), buffer.size());
+	}
+	else{
+		STL_READER_COND_THROW (tris.size() / 3 > BINARY_MAX_TRIS,
+		                       "Too many triangles for a binary stl file: " << tris.size() / 3);
+		std::vector<char> buffer;
+		WriteStlBuffer_BINARY (buffer, coords, normals, tris, options);
+		written = WriteBufferToFile (filename, buffer.data(), buffer.size());
+	}
+
+	STL_READER_COND_THROW (!written, "Couldn't write file " << filename);
+	return true;
+}
+
+
+template <class TNumberContainer, class TIndexContainer>
+void WriteStlBuffer_BINARY (std::vector<char>& bufferOut,
+                            const TNumberContainer& coords,
+                            const TNumberContainer& normals,
+                            const TIndexContainer& tris,
+                            const WriteOptions& options)
+{
+	using namespace stl_reader::stl_reader_impl;
+	using namespace stl_writer_impl;
+
+	const size_t numTris = tris.size() / 3;
+	if(numTris > BINARY_MAX_TRIS){
+	//	the count would wrap. Without exceptions the empty buffer tells
+		bufferOut.clear ();
+		#ifndef STL_READER_NO_EXCEPTIONS
+			STL_READER_THROW ("Too many triangles for a binary stl file: " << numTris);
+		#endif
+		return;
+	}
+	bufferOut.resize (BINARY_HEADER_SIZE + numTris * BINARY_TRI_SIZE);
+
+	//	the header must not start with 'solid', or the file could be taken
+	//	for an ASCII file by other readers
+	std::string header = "binary stl " + options.solidName;
+	header.resize (80, '\0');
+	memcpy (&bufferOut[0], header.data(), 80);
+
+	for(size_t i = 0; i < 4; ++i)
+		bufferOut[80 + i] = static_cast<char> ((numTris >> (8 * i)) & 0xFF);
+
+	char* data = &bufferOut[0];
+	ParallelFor (numTris, options.numThreads,
+		[&] (size_t triBegin, size_t triEnd) {
+			EncodeBinaryTriangles (data, triBegin, triEnd, coords, normals, tris);
+		});
+}
+
+
+template <class TNumberContainer, class TIndexContainer>
+void WriteStlBuffer_ASCII (std::string& bufferOut,
+                           const TNumberContainer& coords,
+                           const TNumberContainer& normals,
+                           const TIndexContainer& tris,
+                           const WriteOptions& options)
+{
+	using namespace stl_reader::stl_reader_impl;
+	using namespace stl_writer_impl;
+
+	const size_t numTris = tris.size() / 3;
+	const unsigned int numChunks = NumWorkerThreads (options.numThreads, numTris, 4096);
+
+	std::vector<std::string> chunks (numChunks);
+	ParallelForChunks (numTris, numChunks,
+		[&] (size_t chunk, size_t triBegin, size_t triEnd) {
+			//	about 250 characters per facet
+			chunks[chunk].reserve ((triEnd - triBegin) * 256);
+			FormatAsciiTriangles (chunks[chunk], triBegin, triEnd, coords, normals, tris);
+		});
+
+	size_t size = 0;
+	for(size_t i = 0; i < chunks.size(); ++i)
+		size += chunks[i].size();
+
+	bufferOut.clear ();
+	bufferOut.reserve (size + 2 * options.solidName.size() + 16);
+	bufferOut += "solid " + options.solidName + "\n";
+	for(size_t i = 0; i < chunks.size(); ++i){
+		bufferOut += chunks[i];
+		std::string ().swap (chunks[i]);
+	}
+	bufferOut += "endsolid " + options.solidName + "\n";
+}
+
+}// end of namespace stl_writer
+
+#endif	//__H__STL_WRITER
@@ -22,6 +22,9 @@
 #define GUI_FILE_DIALOG_IMPLEMENTATION
 #include "gui_file_dialog.h"
 
+#define MESH_IMPORT_IMPLEMENTATION
+#include "mesh_import.h"
+
 constexpr auto MARGIN {10};
 constexpr auto TIMELINE_HEIGHT {48};
 constexpr auto STATUS_BAR_HEIGHT {20};
@@ -71,11 +74,27 @@ struct ModelGuiState {
 
     int current_keyframe {0};
     std::vector<KeyFrame> keyframes{};
+
+    std::vector<BoundingBox> mesh_bounds{}; // Local space box of every mesh, filled on first draw
+    std::vector<int> mesh_parts{};          // Part (stl solid) of every mesh, empty if the model is one part
+
+    ModelLODs lods{};                       // Simplified levels of every mesh, empty until lods_job is done
+    ModelLODsJob* lods_job {nullptr};
+    std::vector<int> mesh_lods{};           // Level every mesh was drawn with last frame
+    float density {1.0f};                   // Part of the triangles the inspector keeps, below 1 progressive meshes are drawn
+
+    ModelImport* import {nullptr};          // Still importing, the model is a coarse preview meanwhile
 };
 
 struct State {
     Shader shader {{}};
 
+    // Stl meshes are uploaded quantized, phong_vs.glsl decodes them per mesh
+    bool compact_vertices {true};
+    int compact_vertices_loc {-1};
+    int quant_offset_loc {-1};
+    int quant_scale_loc {-1};
+
     Camera camera {{}};
     Font font {{}};
 
@@ -84,12 +103,14 @@ struct State {
     ToggleDropdownState toggle_drop_down_states[100];
 
     std::vector<std::tuple<Model, ModelGuiState>> models;
+    std::vector<ModelImport*> imports; // Still running on worker threads
 
     std::vector<MenuButtonState> menu_buttons {
         {"File",
          {"Load scene",
           "Save scene",
           "Import model",
+          "Export model",
           "Exit"}},
         {"Edit",
          {"Why are you trying to edit something?"}},
@@ -205,8 +226,18 @@ bool GuiDropDown(State& state, int id, Rectangle rect, const char* text, int fla
     return dstate->open;
 }
 
+bool is_model_file(const char* path) {
+    // Compressed stl files are decompressed by the reader itself
+    const auto length = std::string{path}.size();
+    const auto compressed_stl = length > 7 && TextIsEqual(TextToLower(path + length - 7), ".stl.gz");
+    return IsFileExtension(path, ".obj") || IsFileExtension(path, ".stl") || compressed_stl;
+}
+
 Model load_model(const State& state, const std::string& path) {
-    auto model = LoadModel(path.c_str());
+    // Models are loaded welded and uploaded indexed, LoadModel would de-index them
+    auto model = IsFileExtension(path.c_str(), ".obj")
+        ? LoadModelOBJ(path.c_str(), state.compact_vertices)
+        : LoadModelSTL(path.c_str(), state.compact_vertices);
     model.materials[0].shader = state.shader;
     return model;
 }
@@ -215,6 +246,176 @@ void unload_model(Model& model) {
     UnloadModel(model);
 }
 
+// Model shown for an import, nullptr if there is no preview of it yet
+std::tuple<Model, ModelGuiState>* find_import_model(State& state, const ModelImport* import) {
+    for (auto& model_tuple : state.models)
+        if (std::get<1>(model_tuple).import == import) return &model_tuple;
+    return nullptr;
+}
+
+// Levels of detail of the old meshes go along with them
+void unload_model_lods(ModelGuiState& model_state) {
+    if (model_state.lods_job) UnloadModelLODsJob(model_state.lods_job);
+    UnloadModelLODs(model_state.lods);
+
+    model_state.lods_job = nullptr;
+    model_state.lods = ModelLODs{};
+    model_state.mesh_lods.clear();
+}
+
+// Swaps the meshes of a model, what the user set up on it stays
+void replace_model(std::tuple<Model, ModelGuiState>& model_tuple, Model model, const State& state) {
+    auto& [old_model, model_state] = model_tuple;
+
+    model.materials[0].shader = state.shader;
+    model.materials[0].maps[0].color = old_model.materials[0].maps[0].color;
+    unload_model_lods(model_state);
+    unload_model(old_model);
+
+    old_model = model;
+    model_state.mesh_bounds.clear();
+}
+
+// Uploads the models the import workers finished, gl calls have to stay on this thread
+void update_imports(State& state) {
+    // Previews show up as models right away, so they can be placed and animated during the import
+    for (auto* import : state.imports) {
+        auto model = Model{};
+        if (!LoadImportPreview(import, &model, state.compact_vertices)) continue;
+
+        if (auto* model_tuple = find_import_model(state, import)) {
+            replace_model(*model_tuple, model, state);
+        } else {
+            model.materials[0].shader = state.shader;
+            state.models.push_back({model, ModelGuiState{GetFileName(import->fileName.c_str())}});
+            std::get<1>(state.models.back()).import = import;
+        }
+    }
+
+    for (auto* import = PollModelImports(); import != nullptr;) {
+        auto* next = import->next;
+
+        state.imports.erase(std::find(state.imports.begin(), state.imports.end(), import));
+
+        auto* model_tuple = find_import_model(state, import);
+        auto mesh_parts = std::vector<int>{};
+        if (!import->failed)
+            mesh_parts.assign(import->meshParts, import->meshParts + import->meshCount);
+
+        const auto failed = import->failed;
+        auto model = LoadModelFromImport(import, state.compact_vertices);
+
+        if (model_tuple) {
+            replace_model(*model_tuple, model, state);
+        } else {
+            model.materials[0].shader = state.shader;
+            state.models.push_back({model, ModelGuiState{GetFileName(import->fileName.c_str())}});
+            model_tuple = &state.models.back();
+        }
+
+        auto& model_state = std::get<1>(*model_tuple);
+        model_state.mesh_parts = mesh_parts;
+        model_state.import = nullptr;
+
+        // The meshes keep their CPU copy after the upload, decimation reads it meanwhile
+        if (!failed)
+            model_state.lods_job = GenModelLODsAsync(model.meshes, model.meshCount, nullptr, 0, true);
+
+        import = next;
+    }
+
+    for (auto& [model, model_state] : state.models) {
+        if (model_state.lods_job && LoadModelLODsFromJob(model_state.lods_job, &model_state.lods, state.compact_vertices)) {
+            model_state.lods_job = nullptr;
+            model_state.mesh_lods.clear();
+        }
+    }
+}
+
+// Same projection BeginMode3D() sets up for the camera
+Matrix camera_projection(const Camera& camera) {
+    const double aspect = (double)GetScreenWidth()/(double)GetScreenHeight();
+
+    if (camera.type == CAMERA_ORTHOGRAPHIC) {
+        const double top = camera.fovy/2.0;
+        return MatrixOrtho(-top*aspect, top*aspect, -top, top, 0.01, 1000.0);
+    }
+
+    return MatrixPerspective(camera.fovy*DEG2RAD, aspect, 0.01, 1000.0);
+}
+
+// True when all corners of the box are on the outer side of the same clip plane
+bool box_outside_frustum(const BoundingBox& box, const Matrix& mvp) {
+    int outside[6] {0};
+
+    for (int i = 0; i < 8; i++) {
+        const float x = (i & 1) ? box.max.x : box.min.x;
+        const float y = (i & 2) ? box.max.y : box.min.y;
+        const float z = (i & 4) ? box.max.z : box.min.z;
+
+        const float cx = mvp.m0*x + mvp.m4*y + mvp.m8*z + mvp.m12;
+        const float cy = mvp.m1*x + mvp.m5*y + mvp.m9*z + mvp.m13;
+        const float cz = mvp.m2*x + mvp.m6*y + mvp.m10*z + mvp.m14;
+        const float cw = mvp.m3*x + mvp.m7*y + mvp.m11*z + mvp.m15;
+
+        outside[0] += cx < -cw;
+        outside[1] += cx > cw;
+        outside[2] += cy < -cw;
+        outside[3] += cy > cw;
+        outside[4] += cz < -cw;
+        outside[5] += cz > cw;
+    }
+
+    for (const auto n : outside)
+        if (n == 8) return true;
+
+    return false;
+}
+
+// Pixels an object space unit covers at the point of a box nearest to the camera
+float pixels_per_unit(const Camera& camera, const Matrix& transform, const BoundingBox& box) {
+    // The largest axis scale of the transform, errors are measured along any direction
+    const float scale = sqrtf(std::max({transform.m0*transform.m0 + transform.m1*transform.m1 + transform.m2*transform.m2,
+                                        transform.m4*transform.m4 + transform.m5*transform.m5 + transform.m6*transform.m6,
+                                        transform.m8*transform.m8 + transform.m9*transform.m9 + transform.m10*transform.m10}));
+
+    if (camera.type == CAMERA_ORTHOGRAPHIC)
+        return scale*GetScreenHeight()/camera.fovy;
+
+    const auto center = Vector3Transform(Vector3Scale(Vector3Add(box.min, box.max), 0.5f), transform);
+    const auto radius = scale*Vector3Length(Vector3Subtract(box.max, box.min))/2.0f;
+    const auto distance = std::max(Vector3Distance(camera.position, center) - radius, 0.01f);
+
+    return scale*GetScreenHeight()/(2.0f*distance*tanf(camera.fovy*DEG2RAD/2.0f));
+}
+
+// The shader is shared by all models, so the format is set before every mesh
+void set_vertex_format(const State& state, Shader shader, const Mesh& mesh, const BoundingBox& box) {
+    if (shader.id != state.shader.id) return;
+
+    const int compact = IsMeshCompact(mesh);
+    SetShaderValue(shader, state.compact_vertices_loc, &compact, UNIFORM_INT);
+    if (!compact) return;
+
+    Vector3 offset, scale;
+    GetMeshQuantization(box, &offset, &scale);
+    SetShaderValue(shader, state.quant_offset_loc, &offset, UNIFORM_VEC3);
+    SetShaderValue(shader, state.quant_scale_loc, &scale, UNIFORM_VEC3);
+}
+
+// Transform draw_model() draws a model with
+Matrix model_world_transform(const ModelGuiState& model_state) {
+    const auto scale_ = model_state.transform.scale;
+    const auto trans_ = model_state.transform.translation;
+
+    const auto translation = MatrixTranslate(trans_.x, trans_.y, trans_.z);
+    const auto rotation = QuaternionToMatrix(model_state.transform.rotation);
+    const auto scale = MatrixScale(scale_.x, scale_.y, scale_.z);
+
+    // DrawModel() used to apply the translation on top of model.transform, keep doing so
+    return MatrixMultiply(MatrixMultiply(scale, MatrixMultiply(rotation, translation)), translation);
+}
+
 void draw_model(const State& state, std::tuple<Model, ModelGuiState>& model_tuple) {
     auto& [model, model_state] = model_tuple;
 
@@ -237,7 +438,73 @@ void draw_model(const State& state, std::tuple<Model, ModelGuiState>& model_tupl
         model_state.blend_timer += GetFrameTime()*10.0f;
     }
 
-    DrawModel(model, trans_, 1.0, blend);
+    const auto transform = model_world_transform(model_state);
+    const auto mvp = MatrixMultiply(MatrixMultiply(transform, GetMatrixModelview()), camera_projection(state.camera));
+
+    if (model_state.mesh_bounds.size() != (size_t)model.meshCount) {
+        model_state.mesh_bounds.clear();
+        for (int i = 0; i < model.meshCount; i++)
+            model_state.mesh_bounds.push_back(MeshBoundingBox(model.meshes[i]));
+    }
+
+    if (model_state.mesh_lods.size() != (size_t)model.meshCount)
+        model_state.mesh_lods.assign(model.meshCount, 0);
+
+    // Big models are split into chunks, skip the ones out of view
+    for (int i = 0; i < model.meshCount; i++) {
+        if (box_outside_frustum(model_state.mesh_bounds[i], mvp)) continue;
+
+        auto mesh = model.meshes[i];
+        auto box = model_state.mesh_bounds[i];
+
+        auto* progressive = model_state.lods.progressive ? &model_state.lods.progressive[i] : nullptr;
+        if (model_state.density < 1.0f && progressive && progressive->splitCount > 0) {
+            // Only the collapses between the last density and this one are walked
+            SetProgressiveMeshTriangles(progressive, (int)(model_state.density*progressive->maxTriangleCount));
+            UpdateProgressiveMesh(progressive);
+            mesh = progressive->mesh;
+        } else {
+            // Far chunks are drawn with a simplified level, as long as the difference stays below a pixel or two
+            const auto ppu = pixels_per_unit(state.camera, transform, model_state.mesh_bounds[i]);
+            const auto level = GetMeshLOD(model_state.lods, i, ppu, model_state.mesh_lods[i]);
+            model_state.mesh_lods[i] = level;
+
+            if (level > 0) {
+                mesh = model_state.lods.meshes[model_state.lods.levelStarts[i] + level - 1];
+                box = model_state.lods.bounds[model_state.lods.levelStarts[i] + level - 1];
+            }
+        }
+
+        auto& material = model.materials[model.meshMaterial[i]];
+        material.maps[MAP_DIFFUSE].color = blend;
+        set_vertex_format(state, material.shader, mesh, box);
+        rlDrawMesh(mesh, material, transform);
+    }
+}
+
+// Writes the selected model next to the imported ones, as binary stl
+void export_selected_model(State& state) {
+    if (state.model_selected < 0 || state.model_selected >= (int)state.models.size()) return;
+
+    const auto& [model, model_state] = state.models[state.model_selected];
+
+    // Earlier exports are kept, the new one gets the first free number
+    const auto base = "models/" + std::string{GetFileNameWithoutExt(model_state.name.c_str())} + "_export";
+    auto path = base + ".stl";
+    for (int n = 1; FileExists(path.c_str()); n++) path = base + "_" + std::to_string(n) + ".stl";
+
+    // Written in world space, placed as the model is drawn
+    auto exported = model;
+    exported.transform = model_world_transform(model_state);
+    ExportModelSTL(exported, path.c_str(), false);
+}
+
+void do_menu_option(State& state, const std::string& option) {
+    if (option == "Export model") {
+        export_selected_model(state);
+    } else {
+        //TODO
+    }
 }
 
 void do_menu_bar(State& state) {
@@ -302,7 +569,7 @@ void do_menu_bar(State& state) {
 
                 const auto reg = Rectangle{cursor_x, cursor_y+MARGIN, w, MARGIN*2};
                 if (GuiLabelButton(reg, option.c_str())) {
-                    //TODO
+                    do_menu_option(state, option);
                 }
 
                 cursor_y += MARGIN*2;
@@ -322,15 +589,15 @@ void do_file_dialog_update(State& state) {
     if (state.file_dialog_state.SelectFilePressed) {
         // Load file
 
-        if (!IsFileExtension(state.file_dialog_state.fileNameText, ".obj")) {
+        if (!is_model_file(state.file_dialog_state.fileNameText)) {
             // DO WARN
         } else {
             // Load the model
 
             const auto path = "models/" + std::string{state.file_dialog_state.fileNameText};
 
-            state.models.push_back(
-                {load_model(state, path), {std::string{state.file_dialog_state.fileNameText}}});
+            // Big parts take a while, keep the ui running meanwhile
+            state.imports.push_back(ImportModelAsync(path.c_str(), true));
         }
 
         state.file_dialog_state.SelectFilePressed = false;
@@ -339,6 +606,14 @@ void do_file_dialog_update(State& state) {
     GuiFileDialog(&state.file_dialog_state);
 }
 
+// Meshes of one part are stored next to each other
+int part_count(const ModelGuiState& model_state) {
+    int count = 0;
+    for (size_t i = 0; i < model_state.mesh_parts.size(); i++)
+        if (i == 0 || model_state.mesh_parts[i] != model_state.mesh_parts[i-1]) count++;
+    return count;
+}
+
 void do_objects_window(State& state) {
     auto win_reg = Rectangle{GetScreenWidth()-256, 32, 256, GetScreenHeight() - TOTAL_BOTTOM_PANEL_HEIGHT};
     GuiWindowBox(win_reg, "Inspector");
@@ -381,6 +656,8 @@ void do_objects_window(State& state) {
         cursor_y += MARGIN;
 
         std::string s = "Model [" + std::to_string(i) + "]";
+        if (part_count(model_state) > 1)
+            s += " (" + std::to_string(part_count(model_state)) + " parts)";
 
         model_state.selected = false;
         if (GuiDropDown(state, i, Rectangle{cursor_x, cursor_y, sub_w, bh+10}, s.c_str(), 0)) {
@@ -432,6 +709,18 @@ void do_objects_window(State& state) {
             DrawRectangle(cursor_x + MARGIN / 2, cursor_y, sub_w - MARGIN / 2, 1, Color{200, 200, 200, 255});
             cursor_y += MARGIN;
 
+            // DENSITY, live once the levels of detail are generated
+            GuiLabel(Rectangle{cursor_x, cursor_y, 100, 32}, "::[ DENSITY ]::");
+            cursor_y += 32;
+            r.y = cursor_y;
+
+            model_state.density = GuiSlider(r, "%", TextFormat("%i", (int)(model_state.density*100.0f)), model_state.density, 0.0f, 1.0f);
+
+            cursor_y = r.y + r.height + MARGIN*2;
+            height += 32 + r.height + MARGIN*2;
+            DrawRectangle(cursor_x + MARGIN / 2, cursor_y, sub_w - MARGIN / 2, 1, Color{200, 200, 200, 255});
+            cursor_y += MARGIN;
+
             GuiLabel(Rectangle{cursor_x, cursor_y, 100, 32}, "::[ COLOR ]::");
 
             cursor_y += 32;
@@ -454,6 +743,20 @@ void do_objects_window(State& state) {
         i++;
     }
 
+    // Placeholders for the models still being imported
+    for (const auto* import : state.imports) {
+        cursor_y += MARGIN;
+
+        const std::string s = "Importing " + std::string{GetFileName(import->fileName.c_str())};
+        GuiLabel(Rectangle{cursor_x, cursor_y, sub_w, bh+10}, s.c_str());
+        cursor_y += bh+10;
+
+        GuiProgressBar(Rectangle{cursor_x+MARGIN, cursor_y, sub_w-MARGIN*3, bh}, nullptr, nullptr, import->progress, 0.0f, 1.0f);
+        cursor_y += bh+MARGIN;
+
+        DrawRectangle(cursor_x + MARGIN/2, cursor_y, sub_w-MARGIN/2, 3, Color{200, 200, 200, 255});
+    }
+
     EndScissorMode();
 
     cursor_x = p_cursor_x;
@@ -585,6 +888,10 @@ int main () {
     state.shader.locs[LOC_MATRIX_MODEL] = GetShaderLocation(state.shader, "matModel");
     state.shader.locs[LOC_VECTOR_VIEW] = GetShaderLocation(state.shader, "viewPos");
 
+    state.compact_vertices_loc = GetShaderLocation(state.shader, "compactVertices");
+    state.quant_offset_loc = GetShaderLocation(state.shader, "quantOffset");
+    state.quant_scale_loc = GetShaderLocation(state.shader, "quantScale");
+
     int ambientLoc = GetShaderLocation(state.shader, "ambient");
     float val[] = {0.2f, 0.2f, 0.2f, 1.0f};
     SetShaderValue(state.shader, ambientLoc, val, UNIFORM_VEC4);
@@ -610,6 +917,8 @@ int main () {
             UpdateCamera(&state.camera);          // Update camera
         }
 
+        update_imports(state);
+
         if (Playing(state)) {
             state.current_frame++;
 
@@ -647,5 +956,9 @@ int main () {
         state.last_playback_state = state.playback_state;
     }
 
+    for (auto* import : state.imports) UnloadModelImport(import);
+    for (auto& [_, model_state] : state.models)
+        if (model_state.lods_job) UnloadModelLODsJob(model_state.lods_job);
+
     return 0;
 }
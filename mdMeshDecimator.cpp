@@ -4,9 +4,106 @@
 #include <stdlib.h>
 #include <algorithm>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
 #include "mdMeshDecimator.h"
 namespace MeshDecimation
 {
+    // Partitions smaller than this are not worth a thread
+    const size_t MD_MIN_PARTITION_TRIANGLES = 16384;
+    // Edges scored side by side in ComputeEdgeCosts, enough to fill the vector registers
+    const size_t MD_EDGE_COST_LANES = 8;
+
+    // Initialize() gives every thread at least this many triangles
+    const size_t MD_MIN_THREAD_TRIANGLES = 65536;
+
+    // Calls func(begin, end) on nThreads contiguous chunks of [0, n), the calling thread takes the first one
+    template <class TFunc>
+    static void ParallelFor(size_t n, size_t nThreads, TFunc func)
+    {
+        if (nThreads <= 1)
+        {
+            func(static_cast<size_t>(0), n);
+            return;
+        }
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < nThreads; ++i) threads.push_back(std::thread(func, i * n / nThreads, (i + 1) * n / nThreads));
+        func(static_cast<size_t>(0), n / nThreads);
+        for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+    }
+
+    // Compressed sparse rows of items by key: row k holds the items i with a slot s for which key(i, s) == k,
+    // in increasing order, at items[starts[k]] to items[starts[k + 1] - 1]. Keys of -1 are skipped.
+    template <class TKey>
+    static void BuildRows(size_t nItems, int nSlots, size_t nKeys, size_t nThreads, TKey key,
+                          std::vector<int> & starts, std::vector<int> & items)
+    {
+        int k;
+        if (nThreads <= 1)
+        {
+            // Counting sort, atomics would only slow it down
+            starts.assign(nKeys + 1, 0);
+            for (size_t i = 0; i < nItems; ++i)
+                for (int s = 0; s < nSlots; ++s)
+                    if ((k = key(i, s)) != -1) ++starts[k + 1];
+            for (size_t j = 0; j < nKeys; ++j) starts[j + 1] += starts[j];
+            items.resize(starts[nKeys]);
+            std::vector<int> cursors(starts.begin(), starts.end() - 1);
+            for (size_t i = 0; i < nItems; ++i)
+                for (int s = 0; s < nSlots; ++s)
+                    if ((k = key(i, s)) != -1) items[cursors[k]++] = static_cast<int>(i);
+            return;
+        }
+        std::unique_ptr< std::atomic<int>[] > cursors(new std::atomic<int>[nKeys]);
+        ParallelFor(nKeys, nThreads, [&](size_t begin, size_t end)
+        {
+            for (size_t j = begin; j < end; ++j) cursors[j].store(0, std::memory_order_relaxed);
+        });
+        ParallelFor(nItems, nThreads, [&](size_t begin, size_t end)
+        {
+            int key1;
+            for (size_t i = begin; i < end; ++i)
+                for (int s = 0; s < nSlots; ++s)
+                    if ((key1 = key(i, s)) != -1) cursors[key1].fetch_add(1, std::memory_order_relaxed);
+        });
+        starts.resize(nKeys + 1);
+        starts[0] = 0;
+        for (size_t j = 0; j < nKeys; ++j)
+        {
+            starts[j + 1] = starts[j] + cursors[j].load(std::memory_order_relaxed);
+            cursors[j].store(starts[j], std::memory_order_relaxed);
+        }
+        items.resize(starts[nKeys]);
+        ParallelFor(nItems, nThreads, [&](size_t begin, size_t end)
+        {
+            int key1;
+            for (size_t i = begin; i < end; ++i)
+                for (int s = 0; s < nSlots; ++s)
+                    if ((key1 = key(i, s)) != -1) items[cursors[key1].fetch_add(1, std::memory_order_relaxed)] = static_cast<int>(i);
+        });
+        // Threads fill rows in any order, a single one in increasing order already
+        if (nThreads > 1)
+        {
+            ParallelFor(nKeys, nThreads, [&](size_t begin, size_t end)
+            {
+                for (size_t j = begin; j < end; ++j) std::sort(items.begin() + starts[j], items.begin() + starts[j + 1]);
+            });
+        }
+    }
+
+    // Entries of marks equal to the returned value are marked, all others are not
+    static unsigned int NextMark(std::vector<unsigned int> & marks, unsigned int & mark)
+    {
+        if (++mark == 0)
+        {
+            // Old marks could be taken for new ones once the counter wraps around
+            std::fill(marks.begin(), marks.end(), 0);
+            mark = 1;
+        }
+        return mark;
+    }
+
     MeshDecimator::MeshDecimator(void)
     {
         m_triangles                 = 0;
@@ -18,6 +115,13 @@ namespace MeshDecimation
         m_nEdges                    = 0;
         m_trianglesTags             = 0;
         m_ecolManifoldConstraint    = true;
+        m_ecolBoundaryConstraint    = false;
+        m_nThreads                  = 1;
+        m_stop                      = 0;
+        m_collapses                 = 0;
+        m_recordSplits              = false;
+        m_vertexMark                = 0;
+        m_edgeMark                  = 0;
         m_callBack                  = 0;
     }
 
@@ -28,14 +132,34 @@ namespace MeshDecimation
     void MeshDecimator::ReleaseMemory()
     {
         delete [] m_trianglesTags;
+        // Vertices give their adjacency back to the pool before it is freed below
+        m_vertices.clear();
         std::vector< MDVertex > emptyVertices(0);
         m_vertices.swap(emptyVertices);
         std::vector<MDEdge> emptyEdges(0);
         m_edges.swap(emptyEdges);
-        m_pqueue =         std::priority_queue<
-                 MDEdgePriorityQueue, 
-                 std::vector<MDEdgePriorityQueue>, 
-                 std::less<MDEdgePriorityQueue> >();
+        std::vector<MDQuadric> emptyQuadrics(0);
+        m_quadrics.swap(emptyQuadrics);
+        std::vector< Vec3<Float> > emptyPositions(0);
+        m_edgePositions.swap(emptyPositions);
+        std::vector<int> emptyScoredEdges(0);
+        m_scoredEdges.swap(emptyScoredEdges);
+        std::vector<double> emptyScoredCosts(0);
+        m_scoredCosts.swap(emptyScoredCosts);
+        std::vector<int> emptyIncidentVertices(0);
+        m_incidentVertices.swap(emptyIncidentVertices);
+        std::vector<unsigned int> emptyVertexMarks(0);
+        m_vertexMarks.swap(emptyVertexMarks);
+        std::vector<unsigned int> emptyEdgeMarks(0);
+        m_edgeMarks.swap(emptyEdgeMarks);
+        std::vector<MDVertexSplit> emptySplits(0);
+        m_splits.swap(emptySplits);
+        std::vector<int> emptyRemovedTriangles(0);
+        m_removedTriangles.swap(emptyRemovedTriangles);
+        std::vector<int> emptyMovedCorners(0);
+        m_movedCorners.swap(emptyMovedCorners);
+        m_adjacencyPool.Clear();
+        m_pqueue.Clear();
         m_triangles                 = 0;
         m_points                    = 0;
         m_nPoints                   = 0;
@@ -54,58 +178,141 @@ namespace MeshDecimation
         m_nPoints           = nVertices;
         m_triangles         = triangles;
         m_trianglesTags     = new bool[m_nTriangles];
-        m_edges.reserve(3*m_nTriangles);
         m_vertices.resize(m_nVertices);
-        for(size_t v = 0; v < m_nVertices; ++v)
+        m_quadrics.resize(m_nVertices);
+        m_vertexMarks.assign(m_nVertices, 0);
+        m_splits.clear();
+        m_removedTriangles.clear();
+        m_movedCorners.clear();
+        m_vertexMark = 0;
+
+        size_t nThreads = (m_nThreads == 0)? std::thread::hardware_concurrency() : m_nThreads;
+        nThreads = std::max(std::min(nThreads, m_nTriangles / MD_MIN_THREAD_TRIANGLES), static_cast<size_t>(1));
+        const Vec3<int> * tris = m_triangles;
+        const size_t nTris = m_nTriangles;
+        const size_t nHalfEdges = 3 * nTris;
+        std::fill(m_trianglesTags, m_trianglesTags + nTris, true);
+
+        // Triangles of every vertex, a triangle with a repeated corner is listed once
+        std::vector<int> triangleStarts, triangleRows;
+        BuildRows(nTris, 3, m_nVertices, nThreads, [tris](size_t t, int k)
         {
-            m_vertices[v].m_tag = true;
-        }
-        int tri[3];
-        MDEdge edge;
-        edge.m_tag = true;
-        edge.m_onBoundary = true;
-        int nEdges = 0;
-        int idEdge;
-        int nTris = static_cast<int>(m_nTriangles);
-        for(int t = 0; t < nTris; ++t)
-        {
-            tri[0] = m_triangles[t].X();
-            tri[1] = m_triangles[t].Y();
-            tri[2] = m_triangles[t].Z();
-            m_trianglesTags[t] = true;
-            for(int k = 0; k < 3; ++k)
-            {
-                edge.m_v1 = tri[k];
-                edge.m_v2 = tri[(k+1)%3];
-                m_vertices[edge.m_v1].m_triangles.Insert(t);
-                idEdge = GetEdge(edge.m_v1, edge.m_v2);
-                if (idEdge == -1)
+            const int v = tris[t][k];
+            return (k > 0 && tris[t][0] == v) || (k > 1 && tris[t][1] == v)? -1 : v;
+        }, triangleStarts, triangleRows);
+
+        // Side k of triangle t is half-edge 3 t + k, from corner k to corner k + 1. Half-edges are put in rows by their
+        // lower vertex, then sorted by the other one, so that the half-edges of every edge are next to each other
+        std::vector<int> halfEdgeStarts, halfEdgeRows;
+        BuildRows(nHalfEdges, 1, m_nVertices, nThreads, [tris](size_t h, int)
+        {
+            return std::min(tris[h / 3][h % 3], tris[h / 3][(h % 3 + 1) % 3]);
+        }, halfEdgeStarts, halfEdgeRows);
+
+        // Edges are numbered in the order of their first half-edge, every edge seen once lies on the boundary
+        std::vector<int> halfEdgeCounts(nHalfEdges, 0);
+        ParallelFor(m_nVertices, nThreads, [&](size_t begin, size_t end)
+        {
+            for (size_t v = begin; v < end; ++v)
+            {
+                int * row = halfEdgeRows.data() + halfEdgeStarts[v];
+                int * rowEnd = halfEdgeRows.data() + halfEdgeStarts[v + 1];
+                std::sort(row, rowEnd, [tris](int h1, int h2)
                 {
-                    m_edges.push_back(edge);
-                    m_vertices[edge.m_v1].m_edges.Insert(nEdges);
-                    m_vertices[edge.m_v2].m_edges.Insert(nEdges);
-                    ++nEdges;
-                }
-                else
+                    const int w1 = std::max(tris[h1 / 3][h1 % 3], tris[h1 / 3][(h1 % 3 + 1) % 3]);
+                    const int w2 = std::max(tris[h2 / 3][h2 % 3], tris[h2 / 3][(h2 % 3 + 1) % 3]);
+                    return (w1 < w2) || (w1 == w2 && h1 < h2);
+                });
+                for (int * first = row; first != rowEnd; )
                 {
-                    m_edges[idEdge].m_onBoundary = false;
+                    const int w = std::max(tris[*first / 3][*first % 3], tris[*first / 3][(*first % 3 + 1) % 3]);
+                    int * last = first + 1;
+                    while (last != rowEnd && std::max(tris[*last / 3][*last % 3], tris[*last / 3][(*last % 3 + 1) % 3]) == w) ++last;
+                    halfEdgeCounts[*first] = static_cast<int>(last - first);
+                    first = last;
                 }
             }
-        }
-        m_nEdges = static_cast<size_t>(nEdges);
-        for(size_t v = 0; v < m_nVertices; ++v)
+        });
+        std::vector<int>().swap(halfEdgeRows);
+        std::vector<int>().swap(halfEdgeStarts);
+
+        std::vector<int> chunkEdges(nThreads + 1, 0);
+        ParallelFor(nThreads, nThreads, [&](size_t begin, size_t)
         {
-            m_vertices[v].m_onBoundary = false;
-            for(size_t itE = 0; itE < m_vertices[v].m_edges.Size(); ++itE)
+            for (size_t h = begin * nHalfEdges / nThreads; h < (begin + 1) * nHalfEdges / nThreads; ++h)
+                if (halfEdgeCounts[h] > 0) ++chunkEdges[begin + 1];
+        });
+        for (size_t c = 0; c < nThreads; ++c) chunkEdges[c + 1] += chunkEdges[c];
+        const size_t nEdges = static_cast<size_t>(chunkEdges[nThreads]);
+        m_edges.resize(nEdges);
+        ParallelFor(nThreads, nThreads, [&](size_t begin, size_t)
+        {
+            int idEdge = chunkEdges[begin];
+            for (size_t h = begin * nHalfEdges / nThreads; h < (begin + 1) * nHalfEdges / nThreads; ++h)
             {
-                idEdge = m_vertices[v].m_edges[itE];
-                if (m_edges[idEdge].m_onBoundary)
+                if (halfEdgeCounts[h] == 0) continue;
+                MDEdge & edge = m_edges[idEdge++];
+                edge.m_v1 = tris[h / 3][h % 3];
+                edge.m_v2 = tris[h / 3][(h % 3 + 1) % 3];
+                edge.m_onBoundary = (halfEdgeCounts[h] == 1);
+                edge.m_tag = true;
+            }
+        });
+        std::vector<int>().swap(halfEdgeCounts);
+
+        // Edges of every vertex
+        const MDEdge * edges = m_edges.data();
+        std::vector<int> edgeStarts, edgeRows;
+        BuildRows(nEdges, 2, m_nVertices, nThreads, [edges](size_t e, int k)
+        {
+            return (k == 0)? edges[e].m_v1 : ((edges[e].m_v2 != edges[e].m_v1)? edges[e].m_v2 : -1);
+        }, edgeStarts, edgeRows);
+
+        // Rows are copied to the adjacency arrays, those too long for the inline entries of an SArray take
+        // storage from the pool, which is not shared between threads
+        std::vector<char> overflows(m_nVertices, 0);
+        ParallelFor(m_nVertices, nThreads, [&](size_t begin, size_t end)
+        {
+            for (size_t v = begin; v < end; ++v)
+            {
+                MDVertex & vertex = m_vertices[v];
+                vertex.m_tag = true;
+                vertex.m_collapsedInto = -1;
+                vertex.m_locked = false;
+                vertex.m_edges.SetPool(&m_adjacencyPool);
+                vertex.m_triangles.SetPool(&m_adjacencyPool);
+                vertex.m_onBoundary = false;
+                for (int it = edgeStarts[v]; it < edgeStarts[v + 1]; ++it)
                 {
-                    m_vertices[v].m_onBoundary = true;
-                    break;
+                    if (edges[edgeRows[it]].m_onBoundary)
+                    {
+                        vertex.m_onBoundary = true;
+                        break;
+                    }
+                }
+                if (edgeStarts[v + 1] - edgeStarts[v] > SARRAY_DEFAULT_MIN_SIZE ||
+                    triangleStarts[v + 1] - triangleStarts[v] > SARRAY_DEFAULT_MIN_SIZE)
+                {
+                    overflows[v] = 1;
+                    continue;
                 }
+                for (int it = edgeStarts[v]; it < edgeStarts[v + 1]; ++it) vertex.m_edges.PushBack(edgeRows[it]);
+                for (int it = triangleStarts[v]; it < triangleStarts[v + 1]; ++it) vertex.m_triangles.PushBack(triangleRows[it]);
             }
+        });
+        for (size_t v = 0; v < m_nVertices; ++v)
+        {
+            if (!overflows[v]) continue;
+            m_vertices[v].m_edges.Resize(edgeStarts[v + 1] - edgeStarts[v]);
+            m_vertices[v].m_triangles.Resize(triangleStarts[v + 1] - triangleStarts[v]);
+            for (int it = edgeStarts[v]; it < edgeStarts[v + 1]; ++it) m_vertices[v].m_edges.PushBack(edgeRows[it]);
+            for (int it = triangleStarts[v]; it < triangleStarts[v + 1]; ++it) m_vertices[v].m_triangles.PushBack(triangleRows[it]);
         }
+
+        m_nEdges = nEdges;
+        m_edgePositions.resize(m_nEdges);
+        m_edgeMarks.assign(m_nEdges, 0);
+        m_edgeMark = 0;
     }
     int MeshDecimator::GetTriangle(int v1, int v2, int v3) const
     {
@@ -140,8 +347,10 @@ namespace MeshDecimation
         }
         return -1;
     }
-    void MeshDecimator::EdgeCollapse(int v1, int v2)
+    void MeshDecimator::EdgeCollapse(int v1, int v2, const Vec3<Float> & pos)
     {
+        const size_t firstRemovedTriangle = m_removedTriangles.size();
+        const size_t firstMovedCorner = m_movedCorners.size();
         int u, w;
         int shift;
         int idTriangle;
@@ -173,11 +382,13 @@ namespace MeshDecimation
                 m_vertices[u].m_triangles.Erase(idTriangle);
                 m_vertices[w].m_triangles.Erase(idTriangle);
                 m_nTriangles--;
+                if (m_recordSplits) m_removedTriangles.push_back(idTriangle);
             }
             else if (GetTriangle(v1, u, w) == -1)
             {
                 m_vertices[v1].m_triangles.Insert(idTriangle);
                 m_triangles[idTriangle][shift] = v1;
+                if (m_recordSplits) m_movedCorners.push_back(3 * idTriangle + shift);
             }
             else
             {
@@ -185,9 +396,30 @@ namespace MeshDecimation
                 m_vertices[u].m_triangles.Erase(idTriangle);
                 m_vertices[w].m_triangles.Erase(idTriangle);
                 m_nTriangles--;
+                if (m_recordSplits) m_removedTriangles.push_back(idTriangle);
             }
         }
+        if (m_recordSplits)
+        {
+            MDVertexSplit split;
+            split.m_v1                  = v1;
+            split.m_v2                  = v2;
+            split.m_pos                 = pos;
+            split.m_splitPos            = m_points[v1];
+            split.m_nRemovedTriangles   = static_cast<int>(m_removedTriangles.size() - firstRemovedTriangle);
+            split.m_nMovedCorners       = static_cast<int>(m_movedCorners.size() - firstMovedCorner);
+            m_splits.push_back(split);
+        }
+        m_points[v1] = pos;
+        // Neighbours of v1 are marked, edges of v2 to them are duplicates
         int idEdge;
+        const unsigned int mark = NextMark(m_vertexMarks, m_vertexMark);
+        for(size_t itE = 0; itE < m_vertices[v1].m_edges.Size(); ++itE)
+        {
+            idEdge = m_vertices[v1].m_edges[itE];
+            w = (m_edges[idEdge].m_v1 == v1)? m_edges[idEdge].m_v2 : m_edges[idEdge].m_v1;
+            m_vertexMarks[w] = mark;
+        }
         for(size_t itE = 0; itE < m_vertices[v2].m_edges.Size(); ++itE)
         {
             idEdge = m_vertices[v2].m_edges[itE];
@@ -196,37 +428,41 @@ namespace MeshDecimation
             {
                 m_edges[idEdge].m_tag = false;
                 m_vertices[w].m_edges.Erase(idEdge);
+                m_pqueue.Remove(idEdge);
                 m_nEdges--;
             }
-            else if ( GetEdge(v1, w) == -1)
+            else if (m_vertexMarks[w] != mark)
             {
                 if (m_edges[idEdge].m_v1 == v2)    m_edges[idEdge].m_v1 = v1;
                 else                            m_edges[idEdge].m_v2 = v1;
                 m_vertices[v1].m_edges.Insert(idEdge);
+                m_vertexMarks[w] = mark;
             }
             else
             {
                 m_edges[idEdge].m_tag = false;
                 m_vertices[w].m_edges.Erase(idEdge);
+                m_pqueue.Remove(idEdge);
                 m_nEdges--;
             }
         }
         m_vertices[v2].m_tag = false;
+        m_vertices[v2].m_collapsedInto = v1;
         m_nVertices--;
         // update boundary edges
-        SArray<int, 64> incidentVertices;
-        incidentVertices.PushBack(v1);
+        m_incidentVertices.clear();
+        m_incidentVertices.push_back(v1);
         for(size_t itE = 0; itE < m_vertices[v1].m_edges.Size(); ++itE)
         {
-            incidentVertices.PushBack((m_edges[idEdge].m_v1!= v1)?m_edges[idEdge].m_v1:m_edges[idEdge].m_v2);
             idEdge = m_vertices[v1].m_edges[itE];
+            m_incidentVertices.push_back((m_edges[idEdge].m_v1!= v1)?m_edges[idEdge].m_v1:m_edges[idEdge].m_v2);
             m_edges[idEdge].m_onBoundary = (IsBoundaryEdge(m_edges[idEdge].m_v1, m_edges[idEdge].m_v2) != -1);
         }        
         // update boundary vertices
         int idVertex;
-        for(size_t itV = 0; itV < incidentVertices.Size(); ++itV)
+        for(size_t itV = 0; itV < m_incidentVertices.size(); ++itV)
         {
-            idVertex = incidentVertices[itV];
+            idVertex = m_incidentVertices[itV];
             m_vertices[idVertex].m_onBoundary = false;
             for(size_t itE = 0; itE < m_vertices[idVertex].m_edges.Size(); ++itE)
             {
@@ -301,6 +537,28 @@ namespace MeshDecimation
         delete [] map;
     }
 
+    void MeshDecimator::GetVertexMap(int * map) const
+    {
+        int counter = 0;
+        for (size_t v = 0; v < m_nPoints; ++v)
+        {
+            map[v] = (m_vertices[v].m_tag)? counter++ : -1;
+        }
+        int root;
+        for (size_t v = 0; v < m_nPoints; ++v)
+        {
+            root = static_cast<int>(v);
+            while (!m_vertices[root].m_tag) root = m_vertices[root].m_collapsedInto;
+            map[v] = map[root];
+        }
+    }
+    void MeshDecimator::GetVertexSplits(MDVertexSplit * splits, int * removedTriangles, int * movedCorners) const
+    {
+        std::copy(m_splits.begin(), m_splits.end(), splits);
+        std::copy(m_removedTriangles.begin(), m_removedTriangles.end(), removedTriangles);
+        std::copy(m_movedCorners.begin(), m_movedCorners.end(), movedCorners);
+    }
+
     void MeshDecimator::InitializeQEM()
     {
         Vec3<Float> coordMin = m_points[0];
@@ -325,7 +583,7 @@ namespace MeshDecimation
         Float area = 0;
         for(size_t v = 0; v < m_nPoints; ++v)
         {
-            memset(m_vertices[v].m_Q, 0, 10 * sizeof(Float));
+            memset(m_quadrics[v].m_Q, 0, 10 * sizeof(Float));
             int idTriangle;
             for(size_t itT = 0; itT < m_vertices[v].m_triangles.Size(); ++itT)
             {
@@ -337,16 +595,16 @@ namespace MeshDecimation
                 area = n.GetNorm();
                 n.Normalize();
                 d = - (m_points[v] * n);
-                m_vertices[v].m_Q[0] += area * (n.X() * n.X());
-                m_vertices[v].m_Q[1] += area * (n.X() * n.Y());
-                m_vertices[v].m_Q[2] += area * (n.X() * n.Z());
-                m_vertices[v].m_Q[3] += area * (n.X() * d);
-                m_vertices[v].m_Q[4] += area * (n.Y() * n.Y());
-                m_vertices[v].m_Q[5] += area * (n.Y() * n.Z());
-                m_vertices[v].m_Q[6] += area * (n.Y() * d);
-                m_vertices[v].m_Q[7] += area * (n.Z() * n.Z());
-                m_vertices[v].m_Q[8] += area * (n.Z() * d);
-                m_vertices[v].m_Q[9] += area * (d     * d);
+                m_quadrics[v].m_Q[0] += area * (n.X() * n.X());
+                m_quadrics[v].m_Q[1] += area * (n.X() * n.Y());
+                m_quadrics[v].m_Q[2] += area * (n.X() * n.Z());
+                m_quadrics[v].m_Q[3] += area * (n.X() * d);
+                m_quadrics[v].m_Q[4] += area * (n.Y() * n.Y());
+                m_quadrics[v].m_Q[5] += area * (n.Y() * n.Z());
+                m_quadrics[v].m_Q[6] += area * (n.Y() * d);
+                m_quadrics[v].m_Q[7] += area * (n.Z() * n.Z());
+                m_quadrics[v].m_Q[8] += area * (n.Z() * d);
+                m_quadrics[v].m_Q[9] += area * (d     * d);
             }
         }
         Vec3<Float> u1, u2;
@@ -356,7 +614,17 @@ namespace MeshDecimation
         {
             v1 = m_edges[e].m_v1;
             v2 = m_edges[e].m_v2;
-            t = IsBoundaryEdge(v1, v2);
+            // Initialize() flagged the edges of a single triangle, which is one of those of v1
+            t = -1;
+            for(size_t itT = 0; m_edges[e].m_onBoundary && itT < m_vertices[v1].m_triangles.Size(); ++itT)
+            {
+                const int idTriangle = m_vertices[v1].m_triangles[itT];
+                if (m_triangles[idTriangle].X() == v2 || m_triangles[idTriangle].Y() == v2 || m_triangles[idTriangle].Z() == v2)
+                {
+                    t = idTriangle;
+                    break;
+                }
+            }
             if (t != -1)
             {
                 if      (m_triangles[t].X() != v1 && m_triangles[t].X() != v2) v3 = m_triangles[t].X();
@@ -370,28 +638,28 @@ namespace MeshDecimation
                 n.Normalize();
 
                 d = - (m_points[v1] * n);
-                m_vertices[v1].m_Q[0] += area * (n.X() * n.X());
-                m_vertices[v1].m_Q[1] += area * (n.X() * n.Y());
-                m_vertices[v1].m_Q[2] += area * (n.X() * n.Z());
-                m_vertices[v1].m_Q[3] += area * (n.X() * d);
-                m_vertices[v1].m_Q[4] += area * (n.Y() * n.Y());
-                m_vertices[v1].m_Q[5] += area * (n.Y() * n.Z());
-                m_vertices[v1].m_Q[6] += area * (n.Y() * d);
-                m_vertices[v1].m_Q[7] += area * (n.Z() * n.Z());
-                m_vertices[v1].m_Q[8] += area * (n.Z() * d);
-                m_vertices[v1].m_Q[9] += area * (d * d);
+                m_quadrics[v1].m_Q[0] += area * (n.X() * n.X());
+                m_quadrics[v1].m_Q[1] += area * (n.X() * n.Y());
+                m_quadrics[v1].m_Q[2] += area * (n.X() * n.Z());
+                m_quadrics[v1].m_Q[3] += area * (n.X() * d);
+                m_quadrics[v1].m_Q[4] += area * (n.Y() * n.Y());
+                m_quadrics[v1].m_Q[5] += area * (n.Y() * n.Z());
+                m_quadrics[v1].m_Q[6] += area * (n.Y() * d);
+                m_quadrics[v1].m_Q[7] += area * (n.Z() * n.Z());
+                m_quadrics[v1].m_Q[8] += area * (n.Z() * d);
+                m_quadrics[v1].m_Q[9] += area * (d * d);
 
                 d = - (m_points[v2] * n);
-                m_vertices[v2].m_Q[0] += area * (n.X() * n.X());
-                m_vertices[v2].m_Q[1] += area * (n.X() * n.Y());
-                m_vertices[v2].m_Q[2] += area * (n.X() * n.Z());
-                m_vertices[v2].m_Q[3] += area * (n.X() * d);
-                m_vertices[v2].m_Q[4] += area * (n.Y() * n.Y());
-                m_vertices[v2].m_Q[5] += area * (n.Y() * n.Z());
-                m_vertices[v2].m_Q[6] += area * (n.Y() * d);
-                m_vertices[v2].m_Q[7] += area * (n.Z() * n.Z());
-                m_vertices[v2].m_Q[8] += area * (n.Z() * d);
-                m_vertices[v2].m_Q[9] += area * (d * d);
+                m_quadrics[v2].m_Q[0] += area * (n.X() * n.X());
+                m_quadrics[v2].m_Q[1] += area * (n.X() * n.Y());
+                m_quadrics[v2].m_Q[2] += area * (n.X() * n.Z());
+                m_quadrics[v2].m_Q[3] += area * (n.X() * d);
+                m_quadrics[v2].m_Q[4] += area * (n.Y() * n.Y());
+                m_quadrics[v2].m_Q[5] += area * (n.Y() * n.Z());
+                m_quadrics[v2].m_Q[6] += area * (n.Y() * d);
+                m_quadrics[v2].m_Q[7] += area * (n.Z() * n.Z());
+                m_quadrics[v2].m_Q[8] += area * (n.Z() * d);
+                m_quadrics[v2].m_Q[9] += area * (d * d);
             }
         }
     }
@@ -402,8 +670,9 @@ namespace MeshDecimation
         char msg[1024];
         double ptgStep = 1.0;
         int v1, v2;
-        MDEdgePriorityQueue pqEdge;
         size_t nE = m_edges.size();
+        m_pqueue.Reset(nE);
+        m_scoredEdges.clear();
         for(size_t e = 0; e < nE; ++e)
         {
             progress = e * 100.0 / nE;
@@ -414,149 +683,189 @@ namespace MeshDecimation
                 progressOld = progress;
             }
 
-            if (m_edges[e].m_tag)
+            v1 = m_edges[e].m_v1;
+            v2 = m_edges[e].m_v2;
+            if (m_edges[e].m_tag && !m_vertices[v1].m_locked && !m_vertices[v2].m_locked)
             {
-                v1 = m_edges[e].m_v1;
-                v2 = m_edges[e].m_v2;
                 if ( (!m_ecolManifoldConstraint) || (ManifoldConstraint(v1, v2)))
                 {
-                    pqEdge.m_qem = m_edges[e].m_qem = ComputeEdgeCost(v1, v2, m_edges[e].m_pos);
-                    pqEdge.m_name = static_cast<int>(e);
-                    m_pqueue.push(pqEdge);
+                    m_scoredEdges.push_back(static_cast<int>(e));
                 }
             }
         }
+        m_scoredCosts.resize(m_scoredEdges.size());
+        ComputeEdgeCosts(m_scoredEdges.data(), m_scoredEdges.size(), m_scoredCosts.data());
+        for(size_t itE = 0; itE < m_scoredEdges.size(); ++itE)
+        {
+            m_pqueue.Update(m_scoredEdges[itE], m_scoredCosts[itE]);
+        }
     }
-    double MeshDecimator::ComputeEdgeCost(int v1, int v2, Vec3<Float> & newPos) const
+    void MeshDecimator::ComputeEdgeCosts(const int * edges, size_t nEdges, double * costs)
     {
-        double Q[10];
-        double M[12];
-        Vec3<double> pos;
-        for(int i = 0; i < 10; ++i) Q[i] = m_vertices[v1].m_Q[i] + m_vertices[v2].m_Q[i];
-        M[0] = Q[0]; // (0, 0)
-        M[1] = Q[1]; // (0, 1) 
-        M[2] = Q[2]; // (0, 2)
-        M[3] = Q[3]; // (0, 3)
-        M[4] = Q[1]; // (1, 0)
-        M[5] = Q[4]; // (1, 1)
-        M[6] = Q[5]; // (1, 2)
-        M[7] = Q[6]; // (1, 3)
-        M[8] = Q[2]; // (2, 0)
-        M[9] = Q[5]; // (2, 1)
-        M[10] = Q[7]; // (2, 2);
-        M[11] = Q[8]; // (2, 3);
-        double det =   M[0] * M[5] * M[10] + M[1] * M[6] * M[8] + M[2] * M[4] * M[9]   
-                     - M[0] * M[6] * M[9]  - M[1] * M[4] * M[10]- M[2] * M[5] * M[8]; 
-        if (det != 0.0)
-        {
-            double d = 1.0 / det;
-            pos.X() = d * (M[1]*M[7]*M[10] + M[2]*M[5]*M[11] + M[3]*M[6]*M[9]
-                          -M[1]*M[6]*M[11] - M[2]*M[7]*M[9]  - M[3]*M[5]*M[10]);
-            pos.Y() = d * (M[0]*M[6]*M[11] + M[2]*M[7]*M[8]  + M[3]*M[4]*M[10]
-                          -M[0]*M[7]*M[10] - M[2]*M[4]*M[11] - M[3]*M[6]*M[8]);
-            pos.Z() = d * (M[0]*M[7]*M[9]  + M[1]*M[4]*M[11] + M[3]*M[5]*M[8]
-                          -M[0]*M[5]*M[11] - M[1]*M[7]*M[8]  - M[3]*M[4]*M[9]);
-            newPos.X() = static_cast<Float>(pos.X());
-            newPos.Y() = static_cast<Float>(pos.Y());
-            newPos.Z() = static_cast<Float>(pos.Z());
-        }
-        else
-        {
-            const Float w = static_cast<Float>(0.5f);
-            newPos = w * m_points[v1] + w * m_points[v2];
-            pos.X() = static_cast<double>(newPos.X());
-            pos.Y() = static_cast<double>(newPos.Y());
-            pos.Z() = static_cast<double>(newPos.Z());
-        }
-
-        double qem = pos.X()  * (Q[0] * pos.X() + Q[1] * pos.Y() + Q[2] * pos.Z() + Q[3]) +  
-                     pos.Y()  * (Q[1] * pos.X() + Q[4] * pos.Y() + Q[5] * pos.Z() + Q[6]) +
-                     pos.Z()  * (Q[2] * pos.X() + Q[5] * pos.Y() + Q[7] * pos.Z() + Q[8]) +
-                                (Q[3] * pos.X() + Q[6] * pos.Y() + Q[8] * pos.Z() + Q[9]) ;
+        // Edges are scored MD_EDGE_COST_LANES at a time, every lane array holds one value per edge so that
+        // the solve and the QEM below run as plain loops over the lanes the compiler vectorizes
+        double Q[10][MD_EDGE_COST_LANES];
+        double mid[3][MD_EDGE_COST_LANES];
+        double pos[3][MD_EDGE_COST_LANES];
+        double qem[MD_EDGE_COST_LANES];
+        size_t lanes[MD_EDGE_COST_LANES];
+        size_t nLanes;
+        int v1, v2;
+        const Float w = static_cast<Float>(0.5f);
+        Vec3<Float> newPos;
+        size_t e = 0;
+        while (e < nEdges)
+        {
+            // Edges that may not move get the maximum cost right away
+            nLanes = 0;
+            for (; e < nEdges && nLanes < MD_EDGE_COST_LANES; ++e)
+            {
+                v1 = m_edges[edges[e]].m_v1;
+                v2 = m_edges[edges[e]].m_v2;
+                if (m_vertices[v1].m_locked || m_vertices[v2].m_locked ||
+                    (m_ecolBoundaryConstraint && (m_vertices[v1].m_onBoundary || m_vertices[v2].m_onBoundary)))
+                {
+                    m_edgePositions[edges[e]] = m_points[v1];
+                    costs[e] = std::numeric_limits<double>::max();
+                    continue;
+                }
+                for(int i = 0; i < 10; ++i) Q[i][nLanes] = m_quadrics[v1].m_Q[i] + m_quadrics[v2].m_Q[i];
+                newPos = w * m_points[v1] + w * m_points[v2];
+                for(int k = 0; k < 3; ++k) mid[k][nLanes] = static_cast<double>(newPos[k]);
+                lanes[nLanes++] = e;
+            }
+            if (nLanes == 0) continue;
+            for (size_t l = nLanes; l < MD_EDGE_COST_LANES; ++l)
+            {
+                for(int i = 0; i < 10; ++i) Q[i][l] = 0.0;
+                for(int k = 0; k < 3; ++k)  mid[k][l] = 0.0;
+            }
+
+            // M = | Q0 Q1 Q2 Q3 |
+            //     | Q1 Q4 Q5 Q6 |
+            //     | Q2 Q5 Q7 Q8 |, the optimal position solves the 3x3 system, the middle of the edge if singular.
+            // Both cases are blended with arithmetic instead of branches, which would keep the loop scalar
+            for (size_t l = 0; l < MD_EDGE_COST_LANES; ++l)
+            {
+                const double m0 = Q[0][l], m1 = Q[1][l], m2  = Q[2][l], m3  = Q[3][l];
+                const double m4 = Q[1][l], m5 = Q[4][l], m6  = Q[5][l], m7  = Q[6][l];
+                const double m8 = Q[2][l], m9 = Q[5][l], m10 = Q[7][l], m11 = Q[8][l];
+                const double det =   m0 * m5 * m10 + m1 * m6 * m8 + m2 * m4 * m9
+                                   - m0 * m6 * m9  - m1 * m4 * m10- m2 * m5 * m8;
+                const double solvable = (det != 0.0) ? 1.0 : 0.0;
+                // Parenthesized, det + 1.0 would round tiny determinants away and divide by zero
+                const double d = solvable / (det + (1.0 - solvable));
+                const double x = d * (m1*m7*m10 + m2*m5*m11 + m3*m6*m9
+                                     -m1*m6*m11 - m2*m7*m9  - m3*m5*m10);
+                const double y = d * (m0*m6*m11 + m2*m7*m8  + m3*m4*m10
+                                     -m0*m7*m10 - m2*m4*m11 - m3*m6*m8);
+                const double z = d * (m0*m7*m9  + m1*m4*m11 + m3*m5*m8
+                                     -m0*m5*m11 - m1*m7*m8  - m3*m4*m9);
+                pos[0][l] = x + (1.0 - solvable) * mid[0][l];
+                pos[1][l] = y + (1.0 - solvable) * mid[1][l];
+                pos[2][l] = z + (1.0 - solvable) * mid[2][l];
+            }
+            for (size_t l = 0; l < MD_EDGE_COST_LANES; ++l)
+            {
+                const double x = pos[0][l], y = pos[1][l], z = pos[2][l];
+                qem[l] = x * (Q[0][l] * x + Q[1][l] * y + Q[2][l] * z + Q[3][l]) +
+                         y * (Q[1][l] * x + Q[4][l] * y + Q[5][l] * z + Q[6][l]) +
+                         z * (Q[2][l] * x + Q[5][l] * y + Q[7][l] * z + Q[8][l]) +
+                             (Q[3][l] * x + Q[6][l] * y + Q[8][l] * z + Q[9][l]);
+            }
 
+            for (size_t l = 0; l < nLanes; ++l)
+            {
+                const int idEdge = edges[lanes[l]];
+                Vec3<Float> & edgePos = m_edgePositions[idEdge];
+                edgePos.X() = static_cast<Float>(pos[0][l]);
+                edgePos.Y() = static_cast<Float>(pos[1][l]);
+                edgePos.Z() = static_cast<Float>(pos[2][l]);
+                costs[lanes[l]] = IsValidCollapse(m_edges[idEdge].m_v1, m_edges[idEdge].m_v2, edgePos) ?
+                                  qem[l] : std::numeric_limits<double>::max();
+            }
+        }
+    }
+    bool MeshDecimator::IsValidCollapse(int v1, int v2, const Vec3<Float> & newPos)
+    {
+        // Triangles around v1, then those around v2 without v1, must not flip once both vertices are at newPos
         Vec3<Float> d1;
         Vec3<Float> d2;
         Vec3<Float> n1;
         Vec3<Float> n2;
-        Vec3<Float> oldPosV1 =  m_points[v1];
-        Vec3<Float> oldPosV2 =  m_points[v2];
-
-        SArray<int, SARRAY_DEFAULT_MIN_SIZE> triangles = m_vertices[v1].m_triangles;
-        int idTriangle;
-        for(size_t itT = 0; itT < m_vertices[v2].m_triangles.Size(); ++itT)
-        {
-            idTriangle = m_vertices[v2].m_triangles[itT];
-            triangles.Insert(idTriangle);
-        }
+        Vec3<Float> p[3];
         int a[3];
-        for(size_t itT = 0; itT != triangles.Size(); ++itT)
+        int v;
+        int idTriangle;
+        for(int pass = 0; pass < 2; ++pass)
         {
-            idTriangle = triangles[itT];
-            a[0] = m_triangles[idTriangle].X();
-            a[1] = m_triangles[idTriangle].Y();
-            a[2] = m_triangles[idTriangle].Z();
-
-            d1 = m_points[a[1]] - m_points[a[0]];
-            d2 = m_points[a[2]] - m_points[a[0]];
-            n1 = d1^d2;
-
-            m_points[v1] = newPos;
-            m_points[v2] = newPos;
+            v = (pass == 0)? v1 : v2;
+            for(size_t itT = 0; itT < m_vertices[v].m_triangles.Size(); ++itT)
+            {
+                idTriangle = m_vertices[v].m_triangles[itT];
+                a[0] = m_triangles[idTriangle].X();
+                a[1] = m_triangles[idTriangle].Y();
+                a[2] = m_triangles[idTriangle].Z();
+                if (pass == 1 && (a[0] == v1 || a[1] == v1 || a[2] == v1)) continue;
 
-            d1 = m_points[a[1]] - m_points[a[0]];
-            d2 = m_points[a[2]] - m_points[a[0]];
-            n2 = d1^d2;
+                d1 = m_points[a[1]] - m_points[a[0]];
+                d2 = m_points[a[2]] - m_points[a[0]];
+                n1 = d1^d2;
 
-            m_points[v1] = oldPosV1;
-            m_points[v2] = oldPosV2;
+                for(int k = 0; k < 3; ++k) p[k] = (a[k] == v1 || a[k] == v2)? newPos : m_points[a[k]];
+                d1 = p[1] - p[0];
+                d2 = p[2] - p[0];
+                n2 = d1^d2;
 
-            n1.Normalize();
-            n2.Normalize();
-            if (n1*n2 < 0.0) 
-            {
-                return std::numeric_limits<double>::max();
+                n1.Normalize();
+                n2.Normalize();
+                if (n1*n2 < 0.0) 
+                {
+                    return false;
+                }
             }
         }
         if ( m_ecolManifoldConstraint && !ManifoldConstraint(v1, v2))
         {
-            return std::numeric_limits<double>::max();
+            return false;
         }
-        return qem;
+        return true;
     }
-    bool MeshDecimator::ManifoldConstraint(int v1, int v2) const
+    bool MeshDecimator::ManifoldConstraint(int v1, int v2)
     {
-        std::set<int> vertices;
+        // Neighbours of v2 are marked, so that common neighbours are found in one pass over those of v1
+        const unsigned int mark = NextMark(m_vertexMarks, m_vertexMark);
         int a, b;
-        int idEdge1;
-        int idEdge2;
-        int idEdgeV1V2;
+        int idEdge;
+        int idEdgeV1V2 = -1;
+        for(size_t itE2 = 0; itE2 < m_vertices[v2].m_edges.Size(); ++itE2)
+        {
+            idEdge = m_vertices[v2].m_edges[itE2];
+            b = (m_edges[idEdge].m_v1 == v2) ? m_edges[idEdge].m_v2 : m_edges[idEdge].m_v1;
+            m_vertexMarks[b] = mark;
+        }
+        size_t nCommon = 0;
         for(size_t itE1 = 0; itE1 < m_vertices[v1].m_edges.Size(); ++itE1)
         {
-            idEdge1 = m_vertices[v1].m_edges[itE1];
-            a = (m_edges[idEdge1].m_v1 == v1) ? m_edges[idEdge1].m_v2 : m_edges[idEdge1].m_v1;
-            vertices.insert(a);
-            if (a != v2)
+            idEdge = m_vertices[v1].m_edges[itE1];
+            a = (m_edges[idEdge].m_v1 == v1) ? m_edges[idEdge].m_v2 : m_edges[idEdge].m_v1;
+            if (a == v2)
             {
-                for(size_t itE2 = 0; itE2 < m_vertices[v2].m_edges.Size(); ++itE2)
-                {
-                    idEdge2 = m_vertices[v2].m_edges[itE2];
-                    b = (m_edges[idEdge2].m_v1 == v2) ? m_edges[idEdge2].m_v2 : m_edges[idEdge2].m_v1;
-                    vertices.insert(b);
-                    if ( a==b )
-                    {
-                        if (GetTriangle(v1, v2, a) == -1)
-                        {
-                            return false;
-                        }
-                    }
-                }
+                idEdgeV1V2 = idEdge;
             }
-            else
+            else if (m_vertexMarks[a] == mark)
             {
-                idEdgeV1V2 = idEdge1;
+                ++nCommon;
+                if (GetTriangle(v1, v2, a) == -1)
+                {
+                    return false;
+                }
             }
         }
-        if (vertices.size() <= 4 || ( m_vertices[v1].m_onBoundary && m_vertices[v2].m_onBoundary && !m_edges[idEdgeV1V2].m_onBoundary))
+        // Vertices around the edge, counting v1 and v2, the neighbours of v2 only count if v1 has others than v2
+        const size_t nVertices = (m_vertices[v1].m_edges.Size() == 1)? 1 :
+                                 m_vertices[v1].m_edges.Size() + m_vertices[v2].m_edges.Size() - nCommon;
+        if (nVertices <= 4 || ( m_vertices[v1].m_onBoundary && m_vertices[v2].m_onBoundary && !m_edges[idEdgeV1V2].m_onBoundary))
         {
             return false;
         }
@@ -564,77 +873,69 @@ namespace MeshDecimation
     }
     bool MeshDecimator::EdgeCollapse(double & qem)
     {
-        MDEdgePriorityQueue currentEdge;
+        if (m_pqueue.Size() == 0) return false;
+        // Collapsed edges leave the queue and costs are updated in place, the top is always current
+        MDEdgePriorityQueue currentEdge = m_pqueue.Top();
+        m_pqueue.Pop();
         int v1, v2;
-        bool done = false;
-        do
-        {
-            done = false;
-            if (m_pqueue.size() == 0)
-            {
-                done = true;
-                break;
-            }
-            else
-            {
-                currentEdge = m_pqueue.top();
-                m_pqueue.pop();
-            }
-        }
-        while ( (!m_edges[currentEdge.m_name].m_tag) || (m_edges[currentEdge.m_name].m_qem != currentEdge.m_qem));
-        
-        if (done) return false;
         v1 = m_edges[currentEdge.m_name].m_v1;
         v2 = m_edges[currentEdge.m_name].m_v2;
 
+        // Only edges left would flip triangles or break the manifold
+        if (currentEdge.m_qem == std::numeric_limits<double>::max()) return false;
+
         qem = currentEdge.m_qem;
-        EdgeCollapse(v1, v2);
-        m_points[v1] = m_edges[currentEdge.m_name].m_pos ;
-        for(int k = 0; k < 10; k++) m_vertices[v1].m_Q[k] += m_vertices[v2].m_Q[k];
+        EdgeCollapse(v1, v2, m_edgePositions[currentEdge.m_name]);
+        if (m_collapses)
+        {
+            MDEdgeCollapse collapse;
+            collapse.m_v1 = v1;
+            collapse.m_v2 = v2;
+            collapse.m_pos = m_points[v1];
+            m_collapses->push_back(collapse);
+        }
+        for(int k = 0; k < 10; k++) m_quadrics[v1].m_Q[k] += m_quadrics[v2].m_Q[k];
 
-        // Update priority queue
+        // Update priority queue, edges between two neighbours of v1 are scored once
         int idEdge;
         int a, b;
-        SArray<int, SARRAY_DEFAULT_MIN_SIZE> incidentVertices;
+        const unsigned int mark = NextMark(m_edgeMarks, m_edgeMark);
+        m_incidentVertices.clear();
+        m_scoredEdges.clear();
         for(size_t itE = 0; itE < m_vertices[v1].m_edges.Size(); ++itE)
         {
             idEdge = m_vertices[v1].m_edges[itE];
             a = m_edges[idEdge].m_v1;
             b = m_edges[idEdge].m_v2;
-            incidentVertices.PushBack((a != v1)?a:b);
-            MDEdgePriorityQueue pqEdge;
-            pqEdge.m_qem = m_edges[idEdge].m_qem = ComputeEdgeCost(a, b, m_edges[idEdge].m_pos);
-            pqEdge.m_name = idEdge;
-            m_pqueue.push(pqEdge);
+            m_incidentVertices.push_back((a != v1)?a:b);
+            m_scoredEdges.push_back(idEdge);
         }
         int idVertex;
-        for(size_t itV = 0; itV< incidentVertices.Size(); ++itV)
+        for(size_t itV = 0; itV< m_incidentVertices.size(); ++itV)
         {
-            idVertex = incidentVertices[itV];
+            idVertex = m_incidentVertices[itV];
             for(size_t itE = 0; itE < m_vertices[idVertex].m_edges.Size(); ++itE)
             {
                 idEdge = m_vertices[idVertex].m_edges[itE];
                 a = m_edges[idEdge].m_v1;
                 b = m_edges[idEdge].m_v2;
-                if ( a!=v1 && b!=v1)
+                if ( a!=v1 && b!=v1 && m_edgeMarks[idEdge] != mark)
                 {
-                    MDEdgePriorityQueue pqEdge;
-                    pqEdge.m_qem = m_edges[idEdge].m_qem = ComputeEdgeCost(a, b, m_edges[idEdge].m_pos);
-                    pqEdge.m_name = idEdge;
-                    m_pqueue.push(pqEdge);
+                    m_edgeMarks[idEdge] = mark;
+                    m_scoredEdges.push_back(idEdge);
                 }
             }
         }
+        m_scoredCosts.resize(m_scoredEdges.size());
+        ComputeEdgeCosts(m_scoredEdges.data(), m_scoredEdges.size(), m_scoredCosts.data());
+        for(size_t itE = 0; itE < m_scoredEdges.size(); ++itE)
+        {
+            m_pqueue.Update(m_scoredEdges[itE], m_scoredCosts[itE]);
+        }
         return true;
     }
     bool MeshDecimator::Decimate(size_t targetNVertices, size_t targetNTriangles, double targetError)
     {
-        double qem = 0.0;
-        double progressOld = -1.0;
-        double progress = 0.0;
-        char msg[1024];
-        double ptgStep = 1.0;
-
         if (m_callBack)
         {
             std::ostringstream msg;
@@ -650,15 +951,50 @@ namespace MeshDecimation
         
         if (m_callBack) (*m_callBack)("+ Initialize QEM \n");
         InitializeQEM();
+        if (m_recordSplits)
+        {
+            // Every collapse removes a vertex and usually two triangles, recording does not allocate per collapse
+            m_splits.reserve(m_splits.size() + m_nVertices);
+            m_removedTriangles.reserve(m_removedTriangles.size() + m_nTriangles);
+            m_movedCorners.reserve(m_movedCorners.size() + 3 * m_nTriangles);
+        }
+        size_t nParts = (m_nThreads == 0)? std::thread::hardware_concurrency() : m_nThreads;
+        nParts = std::min(nParts, m_nTriangles / MD_MIN_PARTITION_TRIANGLES);
+        if (nParts > 1)
+        {
+            if (m_callBack) (*m_callBack)("+ Simplification of partitions \n");
+            SimplifyPartitions(nParts, targetNVertices, targetNTriangles, targetError);
+        }
+        double qem = Simplify(targetNVertices, targetNTriangles, targetError);
+        if (m_callBack)
+        {
+            std::ostringstream msg;
+            msg << "+ Simplification output" << std::endl;
+            msg << "\t # vertices                     \t" << m_nVertices << std::endl;
+            msg << "\t # triangles                    \t" << m_nTriangles << std::endl;
+            msg << "\t QEM                            \t" << qem << std::endl;
+            (*m_callBack)(msg.str().c_str());
+        }
+        return true;
+    }
+    double MeshDecimator::Simplify(size_t targetNVertices, size_t targetNTriangles, double targetError)
+    {
+        double qem = 0.0;
+        double progressOld = -1.0;
+        double progress = 0.0;
+        char msg[1024];
+        double ptgStep = 1.0;
+
         if (m_callBack) (*m_callBack)("+ Initialize priority queue \n");
         InitializePriorityQueue();
         if (m_callBack) (*m_callBack)("+ Simplification \n");
         double invDiag = 1.0 / m_diagBB;
-        while((m_pqueue.size() > 0) && 
+        while((m_pqueue.Size() > 0) && 
               (m_nEdges > 0) && 
               (m_nVertices > targetNVertices) &&
               (m_nTriangles > targetNTriangles) &&
-              (qem < targetError))
+              (qem < targetError) &&
+              (!m_stop || !m_stop->load(std::memory_order_relaxed)))
         {
             progress = 100.0 - m_nVertices * 100.0 / m_nPoints;
             if (fabs(progress-progressOld) > ptgStep && m_callBack)
@@ -671,15 +1007,156 @@ namespace MeshDecimation
 			if (qem < 0.0) qem = 0.0;
 			else           qem = sqrt(qem) * invDiag;
 		}
-        if (m_callBack)
+        return qem;
+    }
+    // Splits triangles order[begin, end) at the median centroid along the longest axis, until there are nParts
+    static void PartitionTriangles(const std::vector< Vec3<Float> > & centroids, std::vector<int> & order,
+                                   size_t begin, size_t end, size_t nParts, int firstPart, std::vector<int> & parts)
+    {
+        if (nParts == 1)
         {
-            std::ostringstream msg;
-            msg << "+ Simplification output" << std::endl;
-            msg << "\t # vertices                     \t" << m_nVertices << std::endl;
-            msg << "\t # triangles                    \t" << m_nTriangles << std::endl;
-            msg << "\t QEM                            \t" << qem << std::endl;
-            (*m_callBack)(msg.str().c_str());
+            for (size_t t = begin; t < end; ++t) parts[order[t]] = firstPart;
+            return;
+        }
+        Vec3<Float> coordMin = centroids[order[begin]];
+        Vec3<Float> coordMax = centroids[order[begin]];
+        for (size_t t = begin + 1; t < end; ++t)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                coordMin[k] = std::min(coordMin[k], centroids[order[t]][k]);
+                coordMax[k] = std::max(coordMax[k], centroids[order[t]][k]);
+            }
+        }
+        coordMax -= coordMin;
+        int axis = 0;
+        if (coordMax[1] > coordMax[axis]) axis = 1;
+        if (coordMax[2] > coordMax[axis]) axis = 2;
+
+        // Equal centroids are ordered by triangle, the split does not depend on the standard library
+        const size_t nPartsLeft = nParts / 2;
+        const size_t middle = begin + (end - begin) * nPartsLeft / nParts;
+        std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+                         [&](int a, int b) { return (centroids[a][axis] < centroids[b][axis]) ||
+                                                    (centroids[a][axis] == centroids[b][axis] && a < b); });
+        PartitionTriangles(centroids, order, begin, middle, nPartsLeft, firstPart, parts);
+        PartitionTriangles(centroids, order, middle, end, nParts - nPartsLeft, firstPart + static_cast<int>(nPartsLeft), parts);
+    }
+    void MeshDecimator::SimplifyPartitions(size_t nParts, size_t targetNVertices, size_t targetNTriangles, double targetError)
+    {
+        const int nTris = static_cast<int>(m_nInitialTriangles);
+        std::vector< Vec3<Float> > centroids(nTris);
+        std::vector<int> order(nTris);
+        for (int t = 0; t < nTris; ++t)
+        {
+            centroids[t] = m_points[m_triangles[t].X()] + m_points[m_triangles[t].Y()] + m_points[m_triangles[t].Z()];
+            order[t] = t;
+        }
+        std::vector<int> parts(nTris);
+        PartitionTriangles(centroids, order, 0, nTris, nParts, 0, parts);
+        std::vector< Vec3<Float> >().swap(centroids);
+
+        // Vertices on the seams between partitions are shared, -2, and stay where they are until the seam pass
+        const int shared = -2;
+        std::vector<int> owners(m_nPoints, -1);
+        std::vector< std::vector<int> > partTriangles(nParts);
+        int v;
+        for (int t = 0; t < nTris; ++t)
+        {
+            partTriangles[parts[t]].push_back(t);
+            for (int k = 0; k < 3; ++k)
+            {
+                v = m_triangles[t][k];
+                if (owners[v] == -1)            owners[v] = parts[t];
+                else if (owners[v] != parts[t]) owners[v] = shared;
+            }
+        }
+
+        // Every partition gets its own mesh, numbered locally
+        std::vector< std::vector<int> > partVertices(nParts);
+        std::vector< std::vector< Vec3<Float> > > partPoints(nParts);
+        std::vector< std::vector< Vec3<int> > > partTris(nParts);
+        std::vector<int> local(m_nPoints, -1);
+        for (size_t p = 0; p < nParts; ++p)
+        {
+            partTris[p].resize(partTriangles[p].size());
+            for (size_t t = 0; t < partTriangles[p].size(); ++t)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    v = m_triangles[partTriangles[p][t]][k];
+                    if (local[v] == -1)
+                    {
+                        local[v] = static_cast<int>(partVertices[p].size());
+                        partVertices[p].push_back(v);
+                        partPoints[p].push_back(m_points[v]);
+                    }
+                    partTris[p][t][k] = local[v];
+                }
+            }
+            for (size_t i = 0; i < partVertices[p].size(); ++i) local[partVertices[p][i]] = -1;
+        }
+
+        std::vector< std::vector<MDEdgeCollapse> > partCollapses(nParts);
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < nParts; ++p)
+        {
+            threads.push_back(std::thread([&, p]()
+            {
+                MeshDecimator decimator;
+                decimator.SetEColManifoldConstraint(m_ecolManifoldConstraint);
+                decimator.SetEColBoundaryConstraint(m_ecolBoundaryConstraint);
+                decimator.SetStopFlag(m_stop);
+                decimator.Initialize(partPoints[p].size(), partTris[p].size(), partPoints[p].data(), partTris[p].data());
+
+                // Quadrics and errors are those of the whole mesh
+                decimator.m_diagBB = m_diagBB;
+                int g;
+                for (size_t i = 0; i < partVertices[p].size(); ++i)
+                {
+                    g = partVertices[p][i];
+                    decimator.m_quadrics[i] = m_quadrics[g];
+                    decimator.m_vertices[i].m_locked = (owners[g] == shared);
+                }
+                decimator.m_collapses = &partCollapses[p];
+                const size_t partNTriangles = partTris[p].size();
+                decimator.Simplify(targetNVertices * partNTriangles / nTris, targetNTriangles * partNTriangles / nTris, targetError);
+            }));
+        }
+        for (size_t p = 0; p < nParts; ++p) threads[p].join();
+
+        // Collapses of different partitions touch different vertices, replaying them gives what every partition got
+        m_pqueue.Reset(m_edges.size());
+        int v1, v2;
+        for (size_t p = 0; p < nParts; ++p)
+        {
+            for (size_t c = 0; c < partCollapses[p].size(); ++c)
+            {
+                v1 = partVertices[p][partCollapses[p][c].m_v1];
+                v2 = partVertices[p][partCollapses[p][c].m_v2];
+                EdgeCollapse(v1, v2, partCollapses[p][c].m_pos);
+                for(int k = 0; k < 10; k++) m_quadrics[v1].m_Q[k] += m_quadrics[v2].m_Q[k];
+                if (m_collapses)
+                {
+                    m_collapses->push_back(partCollapses[p][c]);
+                    m_collapses->back().m_v1 = v1;
+                    m_collapses->back().m_v2 = v2;
+                }
+            }
+        }
+
+        // The seam pass only collapses edges between seam vertices and their neighbours
+        for (size_t w = 0; w < m_nPoints; ++w) m_vertices[w].m_locked = (owners[w] != shared);
+        int idEdge;
+        for (size_t w = 0; w < m_nPoints; ++w)
+        {
+            if (owners[w] != shared) continue;
+            for (size_t itE = 0; itE < m_vertices[w].m_edges.Size(); ++itE)
+            {
+                idEdge = m_vertices[w].m_edges[itE];
+                v = (m_edges[idEdge].m_v1 == static_cast<int>(w))? m_edges[idEdge].m_v2 : m_edges[idEdge].m_v1;
+                m_vertices[v].m_locked = false;
+            }
         }
-        return true;
     }
 }
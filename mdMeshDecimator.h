@@ -15,10 +15,10 @@ All rights reserved.
 #pragma once
 #ifndef MD_MESH_DECEMATOR_H
 #define MD_MESH_DECEMATOR_H
-#include <queue>
-#include <set>
+#include <utility>
 #include <vector>
 #include <limits>
+#include <atomic>
 #include "mdVector.h"
 #include "mdSArray.h"
 
@@ -30,24 +30,45 @@ namespace MeshDecimation
     {
         SArray<int, SARRAY_DEFAULT_MIN_SIZE>    m_edges;    
         SArray<int, SARRAY_DEFAULT_MIN_SIZE>    m_triangles;    
+        int                                     m_collapsedInto; // -1 while the vertex is not collapsed
+        bool                                    m_tag;
+        bool                                    m_onBoundary;
+        bool                                    m_locked;        // no edge of the vertex is collapsed
+    };
+    
+    //! Quadric of a vertex, kept apart from the vertex so that edge costs read 40 bytes per vertex
+    struct MDQuadric
+    {
         Float                                   m_Q[10];
                                                 // 0 1 2 3
                                                 //   4 5 6
                                                 //     7 8
                                                 //       9
-        bool                                    m_tag;
-        bool                                    m_onBoundary;
     };
-    
     struct MDEdge
     {
         int                                     m_v1;
         int                                     m_v2;
-        double                                  m_qem;
-        Vec3<Float>                             m_pos;
         bool                                    m_onBoundary;
         bool                                    m_tag;
     };
+    struct MDEdgeCollapse
+    {
+        int                                     m_v1;
+        int                                     m_v2;            // collapsed into m_v1
+        Vec3<Float>                             m_pos;           // new position of m_v1
+    };
+    //! Undoes one edge collapse. The collapses of a decimation recorded in order make a progressive mesh:
+    //! any triangle count in between is reached by collapsing forwards or splitting backwards from the current one
+    struct MDVertexSplit
+    {
+        int                                     m_v1;
+        int                                     m_v2;                   // split off m_v1 again
+        Vec3<Float>                             m_pos;                  // position of m_v1 after the collapse
+        Vec3<Float>                             m_splitPos;             // position of m_v1 before the collapse
+        int                                     m_nRemovedTriangles;    // triangles the collapse removed
+        int                                     m_nMovedCorners;        // corners the collapse moved from m_v2 to m_v1
+    };
     struct MDEdgePriorityQueue
     {
         int                                     m_name;
@@ -55,6 +76,106 @@ namespace MeshDecimation
         inline    friend bool                   operator<(const MDEdgePriorityQueue & lhs, const MDEdgePriorityQueue & rhs) { return (lhs.m_qem > rhs.m_qem);}
         inline    friend bool                   operator>(const MDEdgePriorityQueue & lhs, const MDEdgePriorityQueue & rhs) { return (lhs.m_qem < rhs.m_qem);}
     };
+    //! Binary min-heap of edge costs, indexed by edge so that the cost of a queued edge can be changed or removed.
+    //! Every edge is queued at most once, memory stays bounded by the number of edges.
+    class MDEdgeHeap
+    {
+    public:
+        //! Empties the heap and makes room for edges 0 to nEdges-1
+        void                                    Reset(size_t nEdges)
+                                                {
+                                                    m_heap.clear();
+                                                    m_heap.reserve(nEdges);
+                                                    m_positions.assign(nEdges, -1);
+                                                }
+        void                                    Clear()
+                                                {
+                                                    std::vector<MDEdgePriorityQueue> emptyHeap(0);
+                                                    m_heap.swap(emptyHeap);
+                                                    std::vector<int> emptyPositions(0);
+                                                    m_positions.swap(emptyPositions);
+                                                }
+        inline size_t                           Size() const { return m_heap.size();}
+        inline const MDEdgePriorityQueue &      Top() const { return m_heap[0];}
+        inline bool                             Contains(int name) const { return m_positions[name] != -1;}
+        //! Queues an edge, or moves it if it is queued already
+        void                                    Update(int name, double qem)
+                                                {
+                                                    int pos = m_positions[name];
+                                                    if (pos == -1)
+                                                    {
+                                                        pos = static_cast<int>(m_heap.size());
+                                                        m_heap.push_back(MDEdgePriorityQueue());
+                                                        m_heap[pos].m_name = name;
+                                                        m_heap[pos].m_qem = qem;
+                                                        m_positions[name] = pos;
+                                                        SiftUp(pos);
+                                                    }
+                                                    else
+                                                    {
+                                                        const double oldQem = m_heap[pos].m_qem;
+                                                        m_heap[pos].m_qem = qem;
+                                                        if (qem < oldQem) SiftUp(pos);
+                                                        else              SiftDown(pos);
+                                                    }
+                                                }
+        void                                    Remove(int name)
+                                                {
+                                                    const int pos = m_positions[name];
+                                                    if (pos == -1) return;
+                                                    m_positions[name] = -1;
+                                                    const int last = static_cast<int>(m_heap.size()) - 1;
+                                                    if (pos != last)
+                                                    {
+                                                        m_heap[pos] = m_heap[last];
+                                                        m_positions[m_heap[pos].m_name] = pos;
+                                                        m_heap.pop_back();
+                                                        SiftUp(pos);
+                                                        SiftDown(pos);
+                                                    }
+                                                    else
+                                                    {
+                                                        m_heap.pop_back();
+                                                    }
+                                                }
+        inline void                             Pop() { Remove(m_heap[0].m_name);}
+    private:
+        // Ties are broken by edge so that the collapse order does not depend on the order of updates
+        inline bool                             Less(int i, int j) const
+                                                {
+                                                    return (m_heap[i].m_qem < m_heap[j].m_qem) ||
+                                                           (m_heap[i].m_qem == m_heap[j].m_qem && m_heap[i].m_name < m_heap[j].m_name);
+                                                }
+        inline void                             Swap(int i, int j)
+                                                {
+                                                    std::swap(m_heap[i], m_heap[j]);
+                                                    m_positions[m_heap[i].m_name] = i;
+                                                    m_positions[m_heap[j].m_name] = j;
+                                                }
+        void                                    SiftUp(int pos)
+                                                {
+                                                    while (pos > 0 && Less(pos, (pos - 1) / 2))
+                                                    {
+                                                        Swap(pos, (pos - 1) / 2);
+                                                        pos = (pos - 1) / 2;
+                                                    }
+                                                }
+        void                                    SiftDown(int pos)
+                                                {
+                                                    const int size = static_cast<int>(m_heap.size());
+                                                    int child;
+                                                    while ((child = 2 * pos + 1) < size)
+                                                    {
+                                                        if (child + 1 < size && Less(child + 1, child)) ++child;
+                                                        if (!Less(child, pos)) break;
+                                                        Swap(pos, child);
+                                                        pos = child;
+                                                    }
+                                                }
+    private:
+        std::vector<MDEdgePriorityQueue>        m_heap;
+        std::vector<int>                        m_positions;            //>! index of every edge in m_heap, -1 if not queued
+    };
     typedef void (*CallBackFunction)(const char * msg);
 
     class MeshDecimator
@@ -68,10 +189,30 @@ namespace MeshDecimation
         const CallBackFunction                  GetCallBack() const { return m_callBack;}
 
         inline void                             SetEColManifoldConstraint(bool ecolManifoldConstraint) { m_ecolManifoldConstraint = ecolManifoldConstraint; }
+        //! Keeps boundary vertices where they are, so that meshes sharing a boundary still match after decimation
+        inline void                             SetEColBoundaryConstraint(bool ecolBoundaryConstraint) { m_ecolBoundaryConstraint = ecolBoundaryConstraint; }
+        //! Decimates large meshes on spatial partitions in parallel, then the seams between them serially
+        //! @param nThreads number of partitions and threads, 0 uses all hardware threads. The result depends on it
+        inline void                             SetNThreads(unsigned int nThreads) { m_nThreads = nThreads; }
+        //! Records the collapses of Decimate() as vertex splits, see GetVertexSplits()
+        inline void                             SetVertexSplitRecording(bool recordSplits) { m_recordSplits = recordSplits; }
+        //! Makes Decimate() return early once the flag is set, from any thread. The mesh is valid but not simplified to the target
+        inline void                             SetStopFlag(const std::atomic<bool> * stop) { m_stop = stop; }
+        inline size_t                           GetNVertexSplits() const { return m_splits.size();}
+        inline size_t                           GetNMovedCorners() const { return m_movedCorners.size();}
         inline size_t                           GetNVertices()const {return m_nVertices;};
         inline size_t                           GetNTriangles() const {return m_nTriangles;};
         inline size_t                           GetNEdges() const {return m_nEdges;};
         void                                    GetMeshData(Vec3<Float> * points, Vec3<int> * triangles) const;
+        //! Gives the vertex of GetMeshData() every input vertex was merged into
+        //! @param map array of one entry per input vertex
+        void                                    GetVertexMap(int * map) const;
+        //! Gives the recorded vertex splits in collapse order, the removed triangles and moved corners of every
+        //! collapse follow the ones of the collapse before. Corner k of triangle t is 3 t + k
+        //! @param splits array of GetNVertexSplits() entries
+        //! @param removedTriangles array of one entry per triangle removed since Initialize()
+        //! @param movedCorners array of GetNMovedCorners() entries
+        void                                    GetVertexSplits(MDVertexSplit * splits, int * removedTriangles, int * movedCorners) const;
         void                                    ReleaseMemory();
         void                                    Initialize(size_t nVertices, size_t nTriangles, 
                                                            Vec3<Float> *  points, 
@@ -83,16 +224,19 @@ namespace MeshDecimation
                                                 MeshDecimator(void);
                                                 ~MeshDecimator(void);
     private : 
-        void                                    EdgeCollapse(int v1, int v2);
+        void                                    EdgeCollapse(int v1, int v2, const Vec3<Float> & pos);
         int                                     GetTriangle(int v1, int v2, int v3) const;
         int                                     GetEdge(int v1, int v2) const;
         int                                     IsBoundaryEdge(int v1, int v2) const;
         bool                                    IsBoundaryVertex(int v) const;
         void                                    InitializePriorityQueue();
         void                                    InitializeQEM();
-        bool                                    ManifoldConstraint(int v1, int v2) const;
-        double                                  ComputeEdgeCost(int v1, int v2, Vec3<Float> & pos) const;
+        bool                                    ManifoldConstraint(int v1, int v2);
+        void                                    ComputeEdgeCosts(const int * edges, size_t nEdges, double * costs);
+        bool                                    IsValidCollapse(int v1, int v2, const Vec3<Float> & pos);
         bool                                    EdgeCollapse(double & error);
+        double                                  Simplify(size_t targetNVertices, size_t targetNTriangles, double targetError);
+        void                                    SimplifyPartitions(size_t nParts, size_t targetNVertices, size_t targetNTriangles, double targetError);
     private:
         Vec3<int> *                             m_triangles;
         Vec3<Float> *                           m_points;
@@ -102,15 +246,30 @@ namespace MeshDecimation
         size_t                                  m_nTriangles;
         size_t                                  m_nEdges;
         double                                  m_diagBB;
+        SArrayPool<int>                         m_adjacencyPool;               //>! heap storage of m_vertices adjacency, declared first to outlive it
         std::vector<MDVertex>                   m_vertices;
         std::vector<MDEdge>                     m_edges;
-        std::priority_queue<
-             MDEdgePriorityQueue, 
-             std::vector<MDEdgePriorityQueue>, 
-             std::less<MDEdgePriorityQueue> >   m_pqueue;
+        std::vector<MDQuadric>                  m_quadrics;
+        std::vector< Vec3<Float> >              m_edgePositions;               //>! position of the vertex an edge collapses to
+        std::vector<int>                        m_scoredEdges;                 //>! edges to score with ComputeEdgeCosts
+        std::vector<double>                     m_scoredCosts;
+        std::vector<int>                        m_incidentVertices;            //>! scratch of the collapse, reused to not allocate
+        std::vector<unsigned int>               m_vertexMarks;                 //>! vertices equal to m_vertexMark are marked
+        std::vector<unsigned int>               m_edgeMarks;
+        unsigned int                            m_vertexMark;
+        unsigned int                            m_edgeMark;
+        MDEdgeHeap                              m_pqueue;
         CallBackFunction                        m_callBack;                    //>! call-back function
         bool *                                  m_trianglesTags;
         bool                                    m_ecolManifoldConstraint;
+        bool                                    m_ecolBoundaryConstraint;
+        unsigned int                            m_nThreads;
+        const std::atomic<bool> *               m_stop;                        //>! decimation stops once set, if not null
+        std::vector<MDEdgeCollapse> *           m_collapses;                   //>! collapses are recorded here if set
+        bool                                    m_recordSplits;
+        std::vector<MDVertexSplit>              m_splits;
+        std::vector<int>                        m_removedTriangles;            //>! triangles of m_splits, in collapse order
+        std::vector<int>                        m_movedCorners;                //>! corners of m_splits, in collapse order
     };
 }
 #endif
\ No newline at end of file
@@ -18,10 +18,90 @@
 #include<stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <vector>
 #define SARRAY_DEFAULT_MIN_SIZE 16
+#define SARRAY_POOL_SLAB_SIZE   65536
 
 namespace MeshDecimation
 {
+    //! Recycles the heap storage of SArrays that outgrew their inline entries.
+    //! Blocks are carved from slabs and kept in one free list per power of two size,
+    //! so that arrays growing and shrinking over and over stop allocating once the pool is warm.
+    template < typename T > class SArrayPool
+    {
+        public:
+            //! @param size number of entries, rounded up to the size of the block given
+            T *                     Allocate(size_t & size)
+                                    {
+                                        size_t k = 0;
+                                        while ((static_cast<size_t>(1) << k) < size) ++k;
+                                        size = static_cast<size_t>(1) << k;
+                                        if (m_free[k])
+                                        {
+                                            Block * block = m_free[k];
+                                            m_free[k] = block->m_next;
+                                            return reinterpret_cast<T *>(block);
+                                        }
+                                        size_t bytes = size * sizeof(T);
+                                        if (bytes < sizeof(Block)) bytes = sizeof(Block);
+                                        bytes = (bytes + 15) & ~static_cast<size_t>(15);
+                                        if (bytes > SARRAY_POOL_SLAB_SIZE)
+                                        {
+                                            m_slabs.push_back(new char[bytes]);
+                                            return reinterpret_cast<T *>(m_slabs.back());
+                                        }
+                                        if (m_slabs.size() == 0 || m_slabUsed + bytes > SARRAY_POOL_SLAB_SIZE)
+                                        {
+                                            m_slabs.push_back(new char[SARRAY_POOL_SLAB_SIZE]);
+                                            m_slab = m_slabs.back();
+                                            m_slabUsed = 0;
+                                        }
+                                        T * data = reinterpret_cast<T *>(m_slab + m_slabUsed);
+                                        m_slabUsed += bytes;
+                                        return data;
+                                    }
+            //! @param size size of the block, as given by Allocate()
+            void                    Release(T * data, size_t size)
+                                    {
+                                        size_t k = 0;
+                                        while ((static_cast<size_t>(1) << k) < size) ++k;
+                                        Block * block = reinterpret_cast<Block *>(data);
+                                        block->m_next = m_free[k];
+                                        m_free[k] = block;
+                                    }
+            //! Frees all blocks, arrays still using them must not be used any more
+            void                    Clear()
+                                    {
+                                        for(size_t i = 0; i < m_slabs.size(); ++i) delete [] m_slabs[i];
+                                        std::vector<char *> emptySlabs(0);
+                                        m_slabs.swap(emptySlabs);
+                                        memset(m_free, 0, sizeof(m_free));
+                                        m_slab     = 0;
+                                        m_slabUsed = 0;
+                                    }
+                                    SArrayPool()
+                                    {
+                                        memset(m_free, 0, sizeof(m_free));
+                                        m_slab     = 0;
+                                        m_slabUsed = 0;
+                                    }
+                                    ~SArrayPool()
+                                    {
+                                        Clear();
+                                    }
+        private:
+                                    SArrayPool(const SArrayPool & rhs);
+            void                    operator=(const SArrayPool & rhs);
+            struct Block
+            {
+                Block *             m_next;
+            };
+            Block *                 m_free[64];
+            std::vector<char *>     m_slabs;
+            char *                  m_slab;
+            size_t                  m_slabUsed;
+    };
+
 	//!	SArray.
     template < typename T, size_t N > class SArray
     {
@@ -51,10 +131,15 @@ namespace MeshDecimation
             void                    Clear()
                                     {
                                         m_size = 0;
-                                        delete [] m_data;
+                                        ReleaseData();
                                         m_data    = 0;
                                         m_maxSize = N;
                                     }
+            //! Takes heap storage from pool instead of new[], must be set while the array is in its inline entries
+            void                    SetPool(SArrayPool<T> * pool)
+                                    {
+                                        m_pool = pool;
+                                    }
             void                    PopBack()
                                     {
                                         --m_size;
@@ -63,9 +148,9 @@ namespace MeshDecimation
 									{
 										if (size > m_maxSize)
 										{
-                                            T * temp = new T[size];
+                                            T * temp = AllocateData(size);
 											memcpy(temp, Data(), m_size*sizeof(T));
-                                            delete [] m_data;
+                                            ReleaseData();
                                             m_data = temp;
                                             m_maxSize = size;
 										}
@@ -75,9 +160,9 @@ namespace MeshDecimation
                                         if (m_size==m_maxSize)
                                         {
                                             size_t maxSize = (m_maxSize << 1);                                            
-                                            T * temp = new T[maxSize];
-                                            memcpy(temp, Data(), m_maxSize*sizeof(T));
-                                            delete [] m_data;
+                                            T * temp = AllocateData(maxSize);
+                                            memcpy(temp, Data(), m_size*sizeof(T));
+                                            ReleaseData();
                                             m_data = temp;
                                             m_maxSize = maxSize;
                                         }
@@ -115,9 +200,9 @@ namespace MeshDecimation
                                     {
                                         if (m_maxSize < rhs.m_size)
                                         {
-                                            delete [] m_data;
+                                            ReleaseData();
                                             m_maxSize = rhs.m_maxSize;
-                                            m_data = new T[m_maxSize];
+                                            m_data = AllocateData(m_maxSize);
                                         }
                                         m_size = rhs.m_size;
                                         memcpy(Data(), rhs.Data(), m_size*sizeof(T));
@@ -127,12 +212,14 @@ namespace MeshDecimation
                                         m_data    = 0;
                                         m_size    = 0;
                                         m_maxSize = N;
+                                        m_pool    = 0;
                                     }
                                     SArray(const SArray & rhs)
                                     {
                                         m_data    = 0;
                                         m_size    = 0;
                                         m_maxSize = N;
+                                        m_pool    = rhs.m_pool;
                                         *this    = rhs;
                                     }
                                     SArray()
@@ -141,11 +228,22 @@ namespace MeshDecimation
                                     }
                                     ~SArray()
                                     {
-                                        delete [] m_data;
+                                        ReleaseData();
                                     }
         private:
+            T *                     AllocateData(size_t & size)
+                                    {
+                                        return (m_pool)? m_pool->Allocate(size) : new T[size];
+                                    }
+            void                    ReleaseData()
+                                    {
+                                        if (m_data == 0) return;
+                                        if (m_pool) m_pool->Release(m_data, m_maxSize);
+                                        else        delete [] m_data;
+                                    }
             T                       m_data0[N];
             T *                     m_data;
+            SArrayPool<T> *         m_pool;
             size_t                  m_size;
             size_t                  m_maxSize;
        };    
@@ -0,0 +1,3457 @@
+/**********************************************************************************************
+*
+*   mesh_import - Indexed mesh import for the animator
+*
+*   Builds raylib meshes straight from welded, indexed geometry instead of going through
+*   LoadModel(), which de-indexes every face. Stl files are read with stl_reader.
+*
+*   Mesh.indices is unsigned short, so geometry referencing more than 65535 vertices is
+*   split into spatially coherent chunks, each one becomes a mesh of the model.
+*
+*   Stl normals are per facet. Vertex normals are area weighted averages of the facets around a vertex,
+*   vertices are only split where the angle between neighbouring facets exceeds MESH_CREASE_ANGLE,
+*   so meshes stay indexed while hard edges keep looking hard.
+*
+*   Imports can run on worker threads: ImportModelAsync() reads, welds and builds the meshes
+*   in the background, PollModelImports() hands finished imports back through a lock-free
+*   queue and LoadModelFromImport() uploads them, which must happen on the main thread.
+*   Stl imports can publish coarse previews meanwhile: triangles sampled evenly over the file are
+*   clustered on a grid and neighbouring occupied cells are connected into a surface, refined with
+*   four times the samples until the import is done.
+*   LoadImportPreview() uploads the latest one.
+*
+*   Obj files are memory mapped and parsed on all threads. Faces keep their v/vt/vn indexing, every distinct
+*   combination becomes one vertex, and every object or group becomes its own part. LoadOBJ() instead
+*   de-indexes all faces into a single mesh.
+*
+*   Meshes can get a chain of simplified levels of detail, decimated with MeshDecimator one level from
+*   the next. Every level knows how far its vertices may be off the full mesh, GetMeshLOD() picks the
+*   coarsest one whose error stays below MESH_LOD_PIXEL_ERROR on screen. Decimating takes much longer than
+*   importing, GenModelLODsAsync() runs it on a worker thread for meshes already shown. Levels are cached on
+*   disk next to the meshes, keyed by a hash of the meshes and targets they are generated from.
+*   Decimation can also record its collapses as vertex splits, making a progressive mesh of every mesh:
+*   SetProgressiveMeshTriangles() collapses forwards or splits backwards to any triangle count in between,
+*   in time proportional to the collapses it walks, and UpdateProgressiveMesh() uploads only what changed.
+*
+*   Meshes and models are written back to binary or ascii stl files with stl_writer.
+*
+*   Welded and chunked meshes are cached on disk, keyed by a hash of the source file content.
+*   Entries written with another MESH_CREASE_ANGLE or other weld settings are not used.
+*   Cache files are memory mapped and copied into the meshes without any parsing, several
+*   instances of the animator share them through the page cache.
+*
+*   Imported meshes are optimized for the GPU before they are cached: triangles are reordered for the
+*   post-transform vertex cache and to draw outward facing clusters first, vertices are renumbered
+*   in the order they are first used. The ACMR before and after is logged.
+*
+*   Meshes can be uploaded in a compact vertex format: positions quantized to 16 bit against the
+*   mesh box and octahedral encoded 16 bit normals, interleaved in one buffer of 12 bytes per vertex
+*   instead of 32 bytes spread over three buffers. resources/phong_vs.glsl decodes them when
+*   compactVertices is set, GetMeshQuantization() gives the box uniforms it needs.
+*
+*   CONFIGURATION:
+*
+*   #define MESH_IMPORT_IMPLEMENTATION
+*       Generates the implementation of the library into the included file.
+*       If not defined, the library is in header only mode and can be included in other headers
+*       or source files without problems. But only ONE file should hold the implementation.
+*
+*   #define MESH_CACHE_DIRECTORY "cache"
+*       Directory the mesh cache files are written to.
+*
+*   #define MESH_IMPORT_NO_CACHE
+*       Always parse stl files, the mesh cache is neither read nor written.
+*
+*   #define MESH_IMPORT_MEMORY_BUDGET 512*1024*1024
+*       Read stl files in the low memory mode of stl_reader: corners are welded while the file is
+*       decoded, and triangles beyond the budget (in bytes, 0 for none) are spilled to temporary
+*       files. The peak memory of each stage is logged.
+*
+**********************************************************************************************/
+
+#ifndef MESH_IMPORT_H
+#define MESH_IMPORT_H
+
+#include "raylib.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+//----------------------------------------------------------------------------------
+// Defines and Macros
+//----------------------------------------------------------------------------------
+#define MAX_MESH_INDEXED_VERTICES   65535       // Mesh.indices is unsigned short
+
+#if !defined(MAX_MESH_VBO)
+    #define MAX_MESH_VBO            7           // Maximum number of vbo per mesh (same as models.c)
+#endif
+
+#if !defined(MESH_VERTEX_CACHE_SIZE)
+    #define MESH_VERTEX_CACHE_SIZE  16          // Post-transform cache entries ACMR is measured with
+#endif
+
+#if !defined(MESH_CREASE_ANGLE)
+    #define MESH_CREASE_ANGLE       45.0f       // Edges sharper than this (degrees) split vertex normals
+#endif
+
+#define MESH_OPTIMIZE_CACHE_SIZE    32          // LRU cache modelled by the Forsyth triangle order
+
+#if !defined(MESH_CACHE_DIRECTORY)
+    #define MESH_CACHE_DIRECTORY    "cache"     // Where welded meshes are cached, keyed by source content
+#endif
+
+#define MESH_CACHE_VERSION          5           // Bump whenever the cache layout or the generated meshes change
+
+#if !defined(MESH_PREVIEW_GRID)
+    #define MESH_PREVIEW_GRID       40          // Preview cells along the longest side, cubed it must stay below 65536 vertices
+#endif
+
+#define MESH_PREVIEW_SAMPLES        4096        // Triangles sampled for the first preview, every refinement samples four times more
+#define MESH_PREVIEW_MAX_SAMPLES    (1 << 20)   // Last refinement, the grid is saturated long before
+
+#if !defined(MESH_LOD_LEVELS)
+    #define MESH_LOD_LEVELS         3           // Simplified levels imports generate below every mesh
+#endif
+
+#if !defined(MESH_LOD_TRIANGLE_RATIO)
+    #define MESH_LOD_TRIANGLE_RATIO 0.25f       // Triangles every imported level keeps of the level above
+#endif
+
+#if !defined(MESH_LOD_MAX_ERROR)
+    #define MESH_LOD_MAX_ERROR      0.05f       // Decimation error imported levels stop at, relative to the mesh box diagonal
+#endif
+
+#if !defined(MESH_LOD_PIXEL_ERROR)
+    #define MESH_LOD_PIXEL_ERROR    2.0f        // Pixels a drawn level may be off the full mesh
+#endif
+
+#define MESH_LOD_MIN_TRIANGLES      128         // Meshes this small are not simplified any further
+#define MESH_LOD_HYSTERESIS         0.5f        // Coarser levels are only taken below this part of MESH_LOD_PIXEL_ERROR
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+
+// Decimation target of a level of detail, the level ends at whichever is reached first
+typedef struct MeshLODTarget {
+    float triangleRatio;                    // Triangles the level keeps, relative to the full mesh
+    float maxError;                         // Decimation error the level may reach, relative to the mesh box diagonal
+} MeshLODTarget;
+
+// Vertex split of a progressive mesh, undoes one edge collapse
+typedef struct ProgressiveSplit {
+    Vector3 position;                       // Position of v1 after the collapse
+    Vector3 splitPosition;                  // Position of v1 before the collapse
+    unsigned short v1;                      // Vertex the collapse kept
+    unsigned short v2;                      // Vertex the collapse removed, split off v1 again
+    unsigned short triangleCount;           // Triangles the collapse removed
+    unsigned short cornerCount;             // Indices the collapse moved from v2 to v1
+} ProgressiveSplit;
+
+// Progressive mesh: a mesh and the collapses that simplify it, in order
+// NOTE: Triangles are ordered by when a collapse removes them, last removed first, so the triangles left
+// are always the first mesh.triangleCount ones. Vertices are welded and keep the smooth normals of the full mesh
+typedef struct ProgressiveMesh {
+    Mesh mesh;                              // Current level, uploaded dynamic
+    int maxTriangleCount;                   // Triangles of the full mesh
+    int minTriangleCount;                   // Triangles left after all collapses
+    int splitCount;                         // Collapses recorded, 0 if the mesh was too small to simplify
+    int splitsApplied;                      // Collapses applied to mesh, 0 is the full mesh
+    int cornersApplied;                     // Indices moved by them
+    ProgressiveSplit *splits;
+    unsigned int *corners;                  // Index of mesh.indices every collapse moves, in collapse order
+    int dirtyVertices[2];                   // First and last vertex changed since the last upload
+    int dirtyIndices[2];                    // First and last index changed since the last upload
+} ProgressiveMesh;
+
+// Levels of detail of all meshes of a model
+// NOTE: Levels of mesh i are meshes[levelStarts[i]] .. meshes[levelStarts[i+1]-1], finest first
+typedef struct ModelLODs {
+    int meshCount;
+    int *levelStarts;                       // meshCount + 1 entries
+    Mesh *meshes;
+    float *errors;                          // Object space distance a level may be off the full mesh
+    BoundingBox *bounds;                    // Box of every level, compact levels are quantized against it
+    ProgressiveMesh *progressive;           // One per mesh, NULL unless requested
+} ModelLODs;
+
+// Levels of detail generated on a worker thread
+// NOTE: lods is only valid once done is set
+struct ModelLODsJob {
+    ModelLODs lods {};                      // CPU only, not uploaded yet
+    std::atomic<bool> done {false};
+    std::atomic<bool> stop {false};         // Set by UnloadModelLODsJob(), ends decimation early
+    std::thread worker;
+};
+
+// Model import running on a worker thread
+// NOTE: meshes and failed are only valid once PollModelImports() returned the import
+struct ModelImport {
+    std::string fileName;
+    std::atomic<float> progress {0.0f};     // Written by the worker, 0.0f .. 1.0f
+    bool failed {false};
+
+    Mesh *meshes {nullptr};                 // CPU only, not uploaded yet
+    int *meshParts {nullptr};               // Solid of the stl file each mesh belongs to
+    int meshCount {0};
+
+    std::atomic<Mesh *> preview {nullptr};  // Latest coarse preview (CPU only), taken by LoadImportPreview()
+    std::atomic<bool> previewStop {false};  // Set once the meshes are done, ends the preview worker
+
+    ModelImport *next {nullptr};            // Link in the queue of finished imports
+    std::thread worker;
+    std::thread previewWorker;              // Joined by worker
+};
+
+//----------------------------------------------------------------------------------
+// Module Functions Declaration
+//----------------------------------------------------------------------------------
+Model LoadModelSTL(const char *fileName, bool compact = false);             // Load indexed model from stl file (welded vertices)
+Mesh *LoadMeshesSTL(const char *fileName, int *meshCount, int **meshParts,
+                    std::atomic<float> *progress = nullptr);                // Load indexed meshes (CPU only) from stl file, one or more per solid
+Model LoadModelOBJ(const char *fileName, bool compact = false);             // Load indexed model from obj file, one mesh per object or group
+Mesh *LoadMeshesOBJ(const char *fileName, int *meshCount, int **meshParts,
+                    std::atomic<float> *progress = nullptr);                // Load indexed meshes (CPU only) from obj file, one or more per group
+Model LoadModelFromMeshes(Mesh *meshes, int meshCount);                     // Load model from generated meshes (default material)
+Mesh *GenMeshesIndexed(const float *vertices, int vertexCount,
+                       const unsigned int *indices, int triangleCount,
+                       int *meshCount);                                     // Generate 16 bit indexed meshes (CPU only), split into chunks
+Mesh *GenMeshesIndexedParts(const float *vertices, int vertexCount,
+                            const unsigned int *indices, const unsigned int *partRanges, int partCount,
+                            int *meshCount, int **meshParts);               // Generate 16 bit indexed meshes (CPU only), one or more per part
+void GenMeshSmoothNormals(const float *vertices, int vertexCount,
+                          const unsigned int *indices, int triangleCount,
+                          float *normals);                                  // Compute area weighted vertex normals
+
+ModelImport *ImportModelAsync(const char *fileName, bool preview = false);  // Start importing a stl or obj model on a worker thread
+ModelImport *PollModelImports(void);                                        // Take finished imports, oldest first, linked through next
+bool LoadImportPreview(ModelImport *import, Model *model, bool compact = false); // Upload the latest preview of a running import (main thread only)
+Model LoadModelFromImport(ModelImport *import, bool compact = false);       // Upload a finished import and free it (main thread only)
+void UnloadModelImport(ModelImport *import);                                // Wait for an import and free it without uploading
+
+ModelLODs GenModelLODs(const Mesh *meshes, int meshCount,
+                       const MeshLODTarget *targets, int targetCount,
+                       bool progressive = false,
+                       const std::atomic<bool> *stop = nullptr);            // Generate simplified levels of all meshes (CPU only), in parallel
+void UploadModelLODs(ModelLODs *lods, bool compact);                        // Upload all levels to GPU, like the meshes of the model
+void UnloadModelLODs(ModelLODs lods);                                       // Unload all levels from memory (RAM and/or VRAM)
+int GetMeshLOD(ModelLODs lods, int mesh, float pixelsPerUnit, int current); // Get level to draw a mesh with, 0 is the full mesh, 1 the first of lods
+
+ModelLODsJob *GenModelLODsAsync(const Mesh *meshes, int meshCount,
+                                const MeshLODTarget *targets = nullptr,
+                                int targetCount = 0,
+                                bool progressive = false);                  // Start generating levels of all meshes on a worker thread
+bool LoadModelLODsFromJob(ModelLODsJob *job, ModelLODs *lods, bool compact = false); // Upload the levels of a finished job and free it (main thread only)
+void UnloadModelLODsJob(ModelLODsJob *job);                                 // Stop a job, wait for it and free it without uploading
+
+void SetProgressiveMeshTriangles(ProgressiveMesh *pmesh, int triangleCount); // Collapse or split until the mesh has the most triangles that fit triangleCount
+void UpdateProgressiveMesh(ProgressiveMesh *pmesh);                         // Upload the vertices and indices changed since the last upload (main thread only)
+
+void OptimizeMesh(Mesh *mesh);                                              // Reorder triangles and vertices for vertex cache, overdraw and fetch (CPU only)
+float GetMeshACMR(Mesh mesh, int cacheSize);                                // Get average cache miss ratio: transformed vertices per triangle
+
+void UploadMeshCompact(Mesh *mesh);                                         // Upload mesh data to GPU in the compact vertex format
+bool IsMeshCompact(Mesh mesh);                                              // Check if mesh was uploaded in the compact vertex format
+void GetMeshQuantization(BoundingBox box, Vector3 *offset, Vector3 *scale); // Get decoding of compact positions: offset + scale*position
+
+bool ExportMeshSTL(Mesh mesh, const char *fileName, bool ascii);            // Export mesh data to stl file
+bool ExportModelSTL(Model model, const char *fileName, bool ascii);         // Export all meshes of a model into one stl file, transformed
+
+#endif // MESH_IMPORT_H
+
+
+/***********************************************************************************
+*
+*   MESH_IMPORT IMPLEMENTATION
+*
+************************************************************************************/
+
+#if defined(MESH_IMPORT_IMPLEMENTATION)
+
+#include "rlgl.h"
+#include "stl_reader.h"
+#include "stl_writer.h"
+#include "mdMeshDecimator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <utility>
+#include <vector>
+
+#if defined(GRAPHICS_API_OPENGL_33)
+    #if defined(__APPLE__)
+        #include <OpenGL/gl3.h>                 // OpenGL 3 library for OSX
+    #else
+        #include "external/glad.h"              // Required for: Vertex array and buffer functions, loaded by rlgl
+    #endif
+    #define SUPPORT_MESH_COMPACT                // Compact vertices need vertex arrays with custom attribute formats
+#endif
+
+#if defined(_WIN32)
+    #include <direct.h>                         // Required for: _mkdir()
+    #define MAKE_DIRECTORY(dir) _mkdir(dir)
+#else
+    #include <sys/stat.h>                       // Required for: mkdir()
+    #define MAKE_DIRECTORY(dir) mkdir(dir, 0755)
+#endif
+
+//----------------------------------------------------------------------------------
+// Types and Structures Definition
+//----------------------------------------------------------------------------------
+
+// Mesh cache file header, followed by one MeshCacheEntry per mesh
+// NOTE: All offsets count from the start of the file and are 16 byte aligned, data is little endian
+typedef struct MeshCacheHeader {
+    char magic[8];                  // "MESHCACH"
+    uint32_t version;               // MESH_CACHE_VERSION
+    uint32_t meshCount;
+    uint64_t sourceHash;            // Content hash of the stl file
+    uint64_t sourceSize;            // Size of the stl file in bytes
+    float bounds[6];                // Box of the whole model, min xyz then max xyz
+    uint32_t vertexCount;           // Welded vertices of the whole model
+    uint32_t triangleCount;
+    float creaseAngle;              // MESH_CREASE_ANGLE the normals were split with
+    uint32_t weldMode;              // stl_reader::WeldMode the corners were welded with
+    double weldEpsilon;             // Distance corners were welded within
+} MeshCacheHeader;
+
+typedef struct MeshCacheEntry {
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+    uint64_t verticesOffset;        // 3 floats per vertex
+    uint64_t normalsOffset;         // 3 floats per vertex
+    uint64_t indicesOffset;         // 3 unsigned shorts per triangle
+    float bounds[6];                // Box of the mesh, min xyz then max xyz
+    uint32_t part;                  // Solid of the stl file the mesh belongs to
+    uint32_t reserved;
+} MeshCacheEntry;
+
+// Levels of detail cache file header, followed by the levels of every mesh in order
+// NOTE: A mesh is its level count (uint32_t), then one ModelLODsCacheLevel with its vertices, normals and
+// indices per level. With progressive set, a ModelLODsCacheProgressive with its vertices, normals, indices,
+// splits and corners follows. Arrays are 4 byte aligned, data is little endian
+typedef struct ModelLODsCacheHeader {
+    char magic[8];                  // "LODCACHE"
+    uint32_t version;               // MESH_CACHE_VERSION
+    uint32_t meshCount;
+    uint64_t inputHash;             // Hash of the meshes and targets the levels were generated from
+    uint32_t progressive;           // 1 if every mesh has its progressive mesh
+    uint32_t reserved;
+} ModelLODsCacheHeader;
+
+typedef struct ModelLODsCacheLevel {
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+    float error;
+    uint32_t reserved;
+} ModelLODsCacheLevel;
+
+typedef struct ModelLODsCacheProgressive {
+    uint32_t vertexCount;
+    uint32_t maxTriangleCount;      // Triangles of the indices
+    uint32_t minTriangleCount;
+    uint32_t splitCount;            // 0 if the mesh was too small to simplify, no arrays follow then
+    uint32_t cornerCount;
+    uint32_t reserved;
+} ModelLODsCacheProgressive;
+
+// Corner of an obj face, indices are 0 based and -1 when absent
+typedef struct ObjCorner {
+    int v;
+    int vt;
+    int vn;
+} ObjCorner;
+
+// Object or group statement, its part starts at the triangle following it
+typedef struct ObjGroupStart {
+    int triangle;
+    std::string name;
+} ObjGroupStart;
+
+// Whole lines of an obj file parsed by one thread
+typedef struct ObjChunk {
+    const char *begin;
+    const char *end;
+    int positionCount;                  // Statements in the chunk, counted by the first pass
+    int texcoordCount;
+    int normalCount;
+    int triangleCount;
+    std::vector<ObjGroupStart> groups;
+    bool failed;
+} ObjChunk;
+
+// Vertex of the compact format, interleaved in a single buffer
+// NOTE: Read as normalized shorts, phong_vs.glsl maps them back with the mesh box
+typedef struct CompactVertex {
+    short position[4];              // Mesh box mapped to -1..1 per axis, 4th component pads to 4 byte alignment
+    short normal[2];                // Octahedral encoded unit normal
+} CompactVertex;
+
+// Vertex clustering grid of an import preview, every occupied cell becomes one vertex
+typedef struct PreviewGrid {
+    float origin[3];
+    float invCellSize;
+    int size[3];                            // Cells per axis, at most MESH_PREVIEW_GRID
+    std::vector<int> cellVertex;            // Vertex of every cell, -1 while empty
+    std::vector<int> cells;                 // Cell of every vertex
+    std::vector<float> positions;           // Sum of the corners per vertex
+    std::vector<float> normals;             // Sum of the area weighted face normals per vertex
+    std::vector<int> counts;                // Corners per vertex
+} PreviewGrid;
+
+//----------------------------------------------------------------------------------
+// Global Variables Definition
+//----------------------------------------------------------------------------------
+static std::atomic<ModelImport *> finishedImports { nullptr };     // Pushed by workers, last finished first
+
+//----------------------------------------------------------------------------------
+// Module specific Functions Definition
+//----------------------------------------------------------------------------------
+
+// Scratch arrays indexed by vertex, shared by all parts of a model
+// NOTE: Entries are reset after every part, so a part costs time proportional to its own size
+typedef struct MeshBuildScratch {
+    std::vector<int> localIndex;        // Index in the current chunk, -1 if not referenced by it
+    std::vector<int> stamps;            // Last triangle range a vertex was counted in
+    int stamp;
+} MeshBuildScratch;
+
+// Add the area weighted face normals of the triangles to their corners
+static void AccumulateFaceNormals(const float *vertices, const unsigned int *indices, int triangleCount, float *normals)
+{
+    for (int t = 0; t < triangleCount; t++)
+    {
+        const unsigned int *tri = &indices[t*3];
+        const float *a = &vertices[tri[0]*3];
+        const float *b = &vertices[tri[1]*3];
+        const float *c = &vertices[tri[2]*3];
+
+        const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+
+        // Unnormalized cross product, its length is twice the triangle area
+        const float n[3] = {
+            e1[1]*e2[2] - e1[2]*e2[1],
+            e1[2]*e2[0] - e1[0]*e2[2],
+            e1[0]*e2[1] - e1[1]*e2[0]
+        };
+
+        for (int i = 0; i < 3; i++)
+        {
+            float *vn = &normals[tri[i]*3];
+            vn[0] += n[0];
+            vn[1] += n[1];
+            vn[2] += n[2];
+        }
+    }
+}
+
+static void NormalizeNormal(const float *n, float *result)
+{
+    const float len = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+
+    if (len > 0.0f)
+    {
+        result[0] = n[0]/len;
+        result[1] = n[1]/len;
+        result[2] = n[2]/len;
+    }
+    else
+    {
+        // Isolated or degenerate vertex, any unit vector will do
+        result[0] = 0.0f;
+        result[1] = 1.0f;
+        result[2] = 0.0f;
+    }
+}
+
+// Vertices split along creases, so that every vertex has a single normal
+typedef struct CreaseSplit {
+    std::vector<float> vertices;
+    std::vector<float> normals;         // Normalized, area weighted over the smoothing group
+    std::vector<unsigned int> indices;  // The input triangles, indexing the split vertices
+} CreaseSplit;
+
+// Split vertices where the surface creases and compute a smooth normal for every piece
+// NOTE: Around every vertex, triangles sharing an edge are grouped if their normals differ by at most
+// creaseAngle degrees and they belong to the same part. Each group becomes one vertex, so smooth regions
+// stay shared. Face normals, grouping and output run in parallel, vertices are processed independently.
+static void SplitCreaseVertices(const float *vertices, int vertexCount,
+                                const unsigned int *indices, int triangleCount,
+                                const unsigned int *partRanges, int partCount,
+                                float creaseAngle, CreaseSplit &split)
+{
+    using stl_reader::stl_reader_impl::ParallelFor;
+
+    const int cornerCount = triangleCount*3;
+
+    // Unnormalized face normals, their length is twice the triangle area
+    std::vector<float> faceNormals(cornerCount);
+
+    ParallelFor(triangleCount, 0, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++)
+        {
+            const float *a = &vertices[indices[t*3]*3];
+            const float *b = &vertices[indices[t*3 + 1]*3];
+            const float *c = &vertices[indices[t*3 + 2]*3];
+
+            const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+
+            faceNormals[t*3] = e1[1]*e2[2] - e1[2]*e2[1];
+            faceNormals[t*3 + 1] = e1[2]*e2[0] - e1[0]*e2[2];
+            faceNormals[t*3 + 2] = e1[0]*e2[1] - e1[1]*e2[0];
+        }
+    });
+
+    std::vector<int> triangleParts(triangleCount, 0);
+    for (int p = 0; p < partCount; p++)
+    {
+        for (unsigned int t = partRanges[p]; t < partRanges[p + 1]; t++) triangleParts[t] = p;
+    }
+
+    // Corners around every vertex
+    std::vector<int> offsets(vertexCount + 1, 0);
+    for (int i = 0; i < cornerCount; i++) offsets[indices[i] + 1]++;
+    for (int v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+
+    std::vector<int> corners(cornerCount);
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (int i = 0; i < cornerCount; i++) corners[fill[indices[i]]++] = i;
+
+    // 180 degrees or more never splits, the comparison below would suffer from rounding
+    const bool smoothAll = (creaseAngle >= 180.0f);
+    const float cosCrease = cosf(creaseAngle*DEG2RAD);
+
+    std::vector<int> cornerGroups(cornerCount);
+    std::vector<int> groupCounts(vertexCount);
+
+    ParallelFor(vertexCount, 0, [&](size_t begin, size_t end) {
+        std::vector<int> parent;
+        std::vector<std::pair<unsigned int, int>> edges;    // Other vertex of an edge through v, fan corner
+
+        for (size_t v = begin; v < end; v++)
+        {
+            const int *fan = &corners[offsets[v]];
+            const int fanSize = offsets[v + 1] - offsets[v];
+
+            parent.resize(fanSize);
+            for (int i = 0; i < fanSize; i++) parent[i] = i;
+
+            auto root = [&](int i) {
+                while (parent[i] != i) i = parent[i] = parent[parent[i]];
+                return i;
+            };
+
+            // Joins the groups of two corners whose triangles share an edge through v, unless it is a crease
+            auto join = [&](int i, int j) {
+                const int ti = fan[i]/3, tj = fan[j]/3;
+                if (triangleParts[ti] != triangleParts[tj]) return;
+
+                if (!smoothAll)
+                {
+                    // Degenerate triangles have no normal and join any group
+                    const float *ni = &faceNormals[ti*3];
+                    const float *nj = &faceNormals[tj*3];
+                    const float li = sqrtf(ni[0]*ni[0] + ni[1]*ni[1] + ni[2]*ni[2]);
+                    const float lj = sqrtf(nj[0]*nj[0] + nj[1]*nj[1] + nj[2]*nj[2]);
+                    const float dot = ni[0]*nj[0] + ni[1]*nj[1] + ni[2]*nj[2];
+
+                    if (dot < cosCrease*li*lj) return;
+                }
+
+                // The smaller root stays, so every group is rooted at its first corner
+                const int ri = root(i), rj = root(j);
+                parent[std::max(ri, rj)] = std::min(ri, rj);
+            };
+
+            // Triangles sharing an edge through v share its other vertex, sorting brings them together.
+            // Comparing every pair of the fan instead is quadratic in the valence
+            edges.clear();
+            for (int i = 0; i < fanSize; i++)
+            {
+                const unsigned int *tri = &indices[(fan[i]/3)*3];
+                for (int k = 0; k < 3; k++)
+                    if (tri[k] != v) edges.push_back({ tri[k], i });
+            }
+
+            std::sort(edges.begin(), edges.end());
+
+            for (size_t e = 0; e < edges.size();)
+            {
+                size_t last = e + 1;
+                while ((last < edges.size()) && (edges[last].first == edges[e].first)) last++;
+
+                // More than two triangles only meet on non-manifold edges
+                for (size_t a = e; a < last; a++)
+                    for (size_t b = a + 1; b < last; b++)
+                        if (edges[a].second != edges[b].second) join(edges[a].second, edges[b].second);
+
+                e = last;
+            }
+
+            // Groups are numbered in the order of their first corner, which is numbered before the others
+            int groups = 0;
+
+            for (int i = 0; i < fanSize; i++)
+            {
+                const int r = root(i);
+                if (r == i) cornerGroups[fan[i]] = groups++;
+                else cornerGroups[fan[i]] = cornerGroups[fan[r]];
+            }
+
+            groupCounts[v] = groups;
+        }
+    }, 1024);
+
+    // First split vertex of every input vertex, unreferenced vertices are dropped
+    std::vector<int> bases(vertexCount + 1, 0);
+    for (int v = 0; v < vertexCount; v++) bases[v + 1] = bases[v] + groupCounts[v];
+
+    const int splitCount = bases[vertexCount];
+    split.vertices.resize(splitCount*3);
+    split.normals.assign(splitCount*3, 0.0f);
+    split.indices.resize(cornerCount);
+
+    ParallelFor(vertexCount, 0, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; v++)
+        {
+            for (int i = offsets[v]; i < offsets[v + 1]; i++)
+            {
+                const int corner = corners[i];
+                float *n = &split.normals[(bases[v] + cornerGroups[corner])*3];
+                const float *fn = &faceNormals[(corner/3)*3];
+
+                n[0] += fn[0];
+                n[1] += fn[1];
+                n[2] += fn[2];
+            }
+
+            for (int s = bases[v]; s < bases[v + 1]; s++)
+            {
+                memcpy(&split.vertices[s*3], &vertices[v*3], 3*sizeof(float));
+                NormalizeNormal(&split.normals[s*3], &split.normals[s*3]);
+            }
+        }
+    }, 1024);
+
+    ParallelFor(cornerCount, 0, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) split.indices[i] = bases[indices[i]] + cornerGroups[i];
+    });
+}
+
+// Number of distinct vertices referenced by the triangles order[begin] .. order[end-1]
+// NOTE: Counting stops as soon as maxVertices is exceeded
+static int CountTriangleVertices(const unsigned int *indices, const int *order, int begin, int end,
+                                 int maxVertices, MeshBuildScratch &scratch)
+{
+    int count = 0;
+
+    for (int i = begin; (i < end) && (count <= maxVertices); i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            const unsigned int v = indices[order[i]*3 + k];
+            if (scratch.stamps[v] != scratch.stamp) { scratch.stamps[v] = scratch.stamp; count++; }
+        }
+    }
+
+    scratch.stamp++;
+
+    return count;
+}
+
+// Order triangles into chunks which each reference at most maxVertices vertices
+// NOTE: Ranges are halved at the centroid median along their longest axis until they fit,
+// chunk i holds the triangles order[chunkStarts[i]] .. order[chunkStarts[i+1]-1]
+static void PartitionTriangles(const float *vertices, const unsigned int *indices, int triangleCount,
+                               int maxVertices, MeshBuildScratch &scratch,
+                               std::vector<int> &order, std::vector<int> &chunkStarts)
+{
+    order.resize(triangleCount);
+    for (int t = 0; t < triangleCount; t++) order[t] = t;
+
+    chunkStarts.clear();
+
+    if (CountTriangleVertices(indices, order.data(), 0, triangleCount, maxVertices, scratch) <= maxVertices)
+    {
+        chunkStarts.push_back(0);
+        chunkStarts.push_back(triangleCount);
+        return;
+    }
+
+    std::vector<float> centroids(triangleCount*3);
+
+    for (int t = 0; t < triangleCount; t++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            centroids[t*3 + k] = (vertices[indices[t*3]*3 + k] +
+                                  vertices[indices[t*3 + 1]*3 + k] +
+                                  vertices[indices[t*3 + 2]*3 + k])/3.0f;
+        }
+    }
+
+    std::vector<std::pair<int, int>> ranges;
+    ranges.push_back({ 0, triangleCount });
+
+    while (!ranges.empty())
+    {
+        const int begin = ranges.back().first;
+        const int end = ranges.back().second;
+        ranges.pop_back();
+
+        if ((end - begin < 2) || (CountTriangleVertices(indices, order.data(), begin, end, maxVertices, scratch) <= maxVertices))
+        {
+            if (begin < end) chunkStarts.push_back(begin);
+            continue;
+        }
+
+        float minC[3] = { centroids[order[begin]*3], centroids[order[begin]*3 + 1], centroids[order[begin]*3 + 2] };
+        float maxC[3] = { minC[0], minC[1], minC[2] };
+
+        for (int i = begin + 1; i < end; i++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                minC[k] = std::min(minC[k], centroids[order[i]*3 + k]);
+                maxC[k] = std::max(maxC[k], centroids[order[i]*3 + k]);
+            }
+        }
+
+        int axis = 0;
+        if (maxC[1] - minC[1] > maxC[axis] - minC[axis]) axis = 1;
+        if (maxC[2] - minC[2] > maxC[axis] - minC[axis]) axis = 2;
+
+        const int mid = begin + (end - begin)/2;
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                         [&](int a, int b) { return centroids[a*3 + axis] < centroids[b*3 + axis]; });
+
+        // Second half is pushed first so chunks come out in order
+        ranges.push_back({ mid, end });
+        ranges.push_back({ begin, mid });
+    }
+
+    chunkStarts.push_back(triangleCount);
+}
+
+// Generate the meshes of one part, split into chunks if needed
+// NOTE: Normals are computed for the whole model first, so there are no seams along chunk borders
+static void GenPartMeshes(const float *vertices, const float *normals, const float *texcoords,
+                          const unsigned int *indices, int triangleCount,
+                          MeshBuildScratch &scratch, std::vector<Mesh> &meshes)
+{
+    std::vector<int> order, chunkStarts;
+    PartitionTriangles(vertices, indices, triangleCount, MAX_MESH_INDEXED_VERTICES, scratch, order, chunkStarts);
+
+    std::vector<unsigned int> chunkVertices;
+
+    for (size_t c = 0; c + 1 < chunkStarts.size(); c++)
+    {
+        const int begin = chunkStarts[c];
+        const int end = chunkStarts[c + 1];
+
+        Mesh mesh = { 0 };
+        mesh.vboId = (unsigned int *)RL_CALLOC(MAX_MESH_VBO, sizeof(unsigned int));
+        mesh.triangleCount = end - begin;
+        mesh.indices = (unsigned short *)RL_MALLOC(mesh.triangleCount*3*sizeof(unsigned short));
+
+        chunkVertices.clear();
+
+        for (int i = begin; i < end; i++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                const unsigned int v = indices[order[i]*3 + k];
+
+                if (scratch.localIndex[v] < 0)
+                {
+                    scratch.localIndex[v] = (int)chunkVertices.size();
+                    chunkVertices.push_back(v);
+                }
+
+                mesh.indices[(i - begin)*3 + k] = (unsigned short)scratch.localIndex[v];
+            }
+        }
+
+        mesh.vertexCount = (int)chunkVertices.size();
+        mesh.vertices = (float *)RL_MALLOC(mesh.vertexCount*3*sizeof(float));
+        mesh.normals = (float *)RL_MALLOC(mesh.vertexCount*3*sizeof(float));
+        if (texcoords != NULL) mesh.texcoords = (float *)RL_MALLOC(mesh.vertexCount*2*sizeof(float));
+
+        for (int i = 0; i < mesh.vertexCount; i++)
+        {
+            const unsigned int v = chunkVertices[i];
+            memcpy(&mesh.vertices[i*3], &vertices[v*3], 3*sizeof(float));
+            memcpy(&mesh.normals[i*3], &normals[v*3], 3*sizeof(float));
+            if (texcoords != NULL) memcpy(&mesh.texcoords[i*2], &texcoords[v*2], 2*sizeof(float));
+            scratch.localIndex[v] = -1;
+        }
+
+        meshes.push_back(mesh);
+    }
+}
+
+// Generate the meshes of all parts from vertices which already have their final normals
+// NOTE: texcoords may be NULL, meshParts works like in GenMeshesIndexedParts()
+static Mesh *GenMeshesFromVertices(const float *vertices, const float *normals, const float *texcoords, int vertexCount,
+                                   const unsigned int *indices, const unsigned int *partRanges, int partCount,
+                                   int *meshCount, int **meshParts)
+{
+    MeshBuildScratch scratch;
+    scratch.localIndex.assign(vertexCount, -1);
+    scratch.stamps.assign(vertexCount, -1);
+    scratch.stamp = 0;
+
+    std::vector<Mesh> meshList;
+    std::vector<int> partList;
+
+    for (int p = 0; p < partCount; p++)
+    {
+        const int begin = (int)partRanges[p];
+        const int end = (int)partRanges[p + 1];
+        if (end <= begin) continue;
+
+        GenPartMeshes(vertices, normals, texcoords, &indices[begin*3], end - begin, scratch, meshList);
+        partList.resize(meshList.size(), p);
+    }
+
+    *meshCount = (int)meshList.size();
+
+    Mesh *meshes = (Mesh *)RL_CALLOC(*meshCount, sizeof(Mesh));
+    if (*meshCount > 0) memcpy(meshes, meshList.data(), *meshCount*sizeof(Mesh));
+
+    if (meshParts != NULL)
+    {
+        *meshParts = (int *)RL_MALLOC(*meshCount*sizeof(int));
+        if (*meshCount > 0) memcpy(*meshParts, partList.data(), *meshCount*sizeof(int));
+    }
+
+    return meshes;
+}
+
+//----------------------------------------------------------------------------------
+// Module Functions Definition
+//----------------------------------------------------------------------------------
+
+// Compute area weighted vertex normals
+// NOTE: normals must hold vertexCount*3 floats
+void GenMeshSmoothNormals(const float *vertices, int vertexCount,
+                          const unsigned int *indices, int triangleCount,
+                          float *normals)
+{
+    memset(normals, 0, vertexCount*3*sizeof(float));
+
+    AccumulateFaceNormals(vertices, indices, triangleCount, normals);
+
+    for (int v = 0; v < vertexCount; v++) NormalizeNormal(&normals[v*3], &normals[v*3]);
+}
+
+// Generate 16 bit indexed meshes (CPU only), split into chunks
+Mesh *GenMeshesIndexed(const float *vertices, int vertexCount,
+                       const unsigned int *indices, int triangleCount,
+                       int *meshCount)
+{
+    const unsigned int partRanges[2] = { 0, (unsigned int)triangleCount };
+
+    return GenMeshesIndexedParts(vertices, vertexCount, indices, partRanges, 1, meshCount, NULL);
+}
+
+// Generate 16 bit indexed meshes (CPU only), one or more per part
+// NOTE: Part i holds the triangles partRanges[i] .. partRanges[i+1]-1, parts which reference more
+// than 65535 vertices are split into chunks. If meshParts is given, it receives an array holding
+// the part of every mesh, to be freed with RL_FREE(). Normals are not smoothed across parts,
+// nor across edges sharper than MESH_CREASE_ANGLE.
+Mesh *GenMeshesIndexedParts(const float *vertices, int vertexCount,
+                            const unsigned int *indices, const unsigned int *partRanges, int partCount,
+                            int *meshCount, int **meshParts)
+{
+    // Vertices are split along creases and between parts, chunks then only copy them
+    CreaseSplit split;
+    SplitCreaseVertices(vertices, vertexCount, indices, (int)partRanges[partCount], partRanges, partCount,
+                        MESH_CREASE_ANGLE, split);
+
+    return GenMeshesFromVertices(split.vertices.data(), split.normals.data(), NULL, (int)(split.vertices.size()/3),
+                                 split.indices.data(), partRanges, partCount, meshCount, meshParts);
+}
+
+// Load model from generated meshes (default material)
+// NOTE: The model takes ownership of the meshes array
+Model LoadModelFromMeshes(Mesh *meshes, int meshCount)
+{
+    Model model = { 0 };
+
+    model.transform = MatrixIdentity();
+
+    model.meshCount = meshCount;
+    model.meshes = meshes;
+
+    model.materialCount = 1;
+    model.materials = (Material *)RL_CALLOC(model.materialCount, sizeof(Material));
+    model.materials[0] = LoadMaterialDefault();
+
+    model.meshMaterial = (int *)RL_CALLOC(model.meshCount, sizeof(int));
+
+    return model;
+}
+
+// Map a value in -1..1 to a normalized short
+static short QuantizeSnorm16(float value)
+{
+    if (value > 1.0f) value = 1.0f;
+    else if (value < -1.0f) value = -1.0f;
+
+    return (short)lrintf(value*32767.0f);
+}
+
+// Encode a unit normal as a point of the octahedron unfolded onto the -1..1 square
+// NOTE: Zero normals encode as +z, decoding is octahedral_decode() in phong_vs.glsl
+static void EncodeOctahedral(const float *n, short *result)
+{
+    const float length = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+
+    float x = 0.0f;
+    float y = 0.0f;
+
+    if (length > 0.0f)
+    {
+        x = n[0]/length;
+        y = n[1]/length;
+
+        // Lower half is folded over the diagonals
+        if (n[2] < 0.0f)
+        {
+            const float fx = (1.0f - fabsf(y))*((x >= 0.0f)? 1.0f : -1.0f);
+            const float fy = (1.0f - fabsf(x))*((y >= 0.0f)? 1.0f : -1.0f);
+            x = fx;
+            y = fy;
+        }
+    }
+
+    result[0] = QuantizeSnorm16(x);
+    result[1] = QuantizeSnorm16(y);
+}
+
+// Get decoding of compact positions: offset + scale*position
+// NOTE: Compact meshes are quantized against MeshBoundingBox(), pass the same box here
+void GetMeshQuantization(BoundingBox box, Vector3 *offset, Vector3 *scale)
+{
+    *offset = Vector3Scale(Vector3Add(box.min, box.max), 0.5f);
+    *scale = Vector3Scale(Vector3Subtract(box.max, box.min), 0.5f);
+}
+
+// Upload mesh data to GPU in the compact vertex format
+// NOTE: Texcoords, colors and tangents are not uploaded, CPU data is kept like rlLoadMesh() does.
+// Meshes without normals, or built without OpenGL 3.3, are uploaded with rlLoadMesh()
+void UploadMeshCompact(Mesh *mesh)
+{
+#if defined(SUPPORT_MESH_COMPACT)
+    if (mesh->vaoId > 0)
+    {
+        TraceLog(LOG_WARNING, "VAO: [ID %i] Trying to re-load an already loaded mesh", mesh->vaoId);
+        return;
+    }
+
+    if ((mesh->vertices == NULL) || (mesh->normals == NULL))
+    {
+        rlLoadMesh(mesh, false);
+        return;
+    }
+
+    if (mesh->vboId == NULL) mesh->vboId = (unsigned int *)RL_CALLOC(MAX_MESH_VBO, sizeof(unsigned int));
+
+    Vector3 offset = { 0 };
+    Vector3 scale = { 0 };
+    GetMeshQuantization(MeshBoundingBox(*mesh), &offset, &scale);
+
+    // Flat axes keep all vertices on the box center
+    const float center[3] = { offset.x, offset.y, offset.z };
+    const float invScale[3] = { (scale.x > 0.0f)? 1.0f/scale.x : 0.0f,
+                                (scale.y > 0.0f)? 1.0f/scale.y : 0.0f,
+                                (scale.z > 0.0f)? 1.0f/scale.z : 0.0f };
+
+    std::vector<CompactVertex> data(mesh->vertexCount);
+
+    for (int i = 0; i < mesh->vertexCount; i++)
+    {
+        for (int k = 0; k < 3; k++) data[i].position[k] = QuantizeSnorm16((mesh->vertices[i*3 + k] - center[k])*invScale[k]);
+        data[i].position[3] = 0;
+
+        EncodeOctahedral(&mesh->normals[i*3], data[i].normal);
+    }
+
+    glGenVertexArrays(1, &mesh->vaoId);
+    glBindVertexArray(mesh->vaoId);
+
+    // Interleaved positions and normals (shader-location = 0 and 2, same as rlLoadMesh())
+    glGenBuffers(1, &mesh->vboId[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vboId[0]);
+    glBufferData(GL_ARRAY_BUFFER, data.size()*sizeof(CompactVertex), data.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void *)offsetof(CompactVertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, sizeof(CompactVertex), (void *)offsetof(CompactVertex, normal));
+    glEnableVertexAttribArray(2);
+
+    if (mesh->indices != NULL)
+    {
+        glGenBuffers(1, &mesh->vboId[6]);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->vboId[6]);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh->triangleCount*3*sizeof(unsigned short), mesh->indices, GL_STATIC_DRAW);
+    }
+
+    glBindVertexArray(0);
+
+    TraceLog(LOG_INFO, "VAO: [ID %i] Mesh uploaded successfully to VRAM (GPU), compact vertex format (%i bytes)",
+             mesh->vaoId, (int)(data.size()*sizeof(CompactVertex)));
+#else
+    rlLoadMesh(mesh, false);
+#endif
+}
+
+// Check if mesh was uploaded in the compact vertex format
+// NOTE: rlLoadMesh() always creates a texcoords buffer, compact meshes never do
+bool IsMeshCompact(Mesh mesh)
+{
+    return (mesh.vboId != NULL) && (mesh.vboId[0] != 0) && (mesh.vboId[1] == 0);
+}
+
+// Vertex score of the Forsyth triangle order
+// NOTE: cachePosition is -1 for vertices outside of the modelled cache
+static float ForsythVertexScore(int cachePosition, int remainingTriangles)
+{
+    if (remainingTriangles == 0) return -1.0f;
+
+    float score = 0.0f;
+
+    if (cachePosition >= 0)
+    {
+        // Vertices of the last triangle get a fixed score, so its neighbours are not always preferred
+        if (cachePosition < 3) score = 0.75f;
+        else score = powf(1.0f - (float)(cachePosition - 3)/(MESH_OPTIMIZE_CACHE_SIZE - 3), 1.5f);
+    }
+
+    // Vertices with few triangles left are finished first, so they do not linger around
+    score += 2.0f/sqrtf((float)remainingTriangles);
+
+    return score;
+}
+
+// Reorder triangles for the post-transform vertex cache (Tom Forsyth, linear-speed vertex cache optimisation)
+// NOTE: Triangles are picked greedily by score from the ones touching the modelled LRU cache,
+// when none is left the next unused triangle in input order restarts the strip
+static void OptimizeVertexCache(unsigned short *indices, int triangleCount, int vertexCount)
+{
+    const int indexCount = triangleCount*3;
+
+    // Triangles of every vertex, emitted ones are swapped out of the first remaining[v] entries
+    std::vector<int> remaining(vertexCount, 0);
+    for (int i = 0; i < indexCount; i++) remaining[indices[i]]++;
+
+    std::vector<int> offsets(vertexCount + 1, 0);
+    for (int v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<int> adjacency(indexCount);
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (int i = 0; i < indexCount; i++) adjacency[fill[indices[i]]++] = i/3;
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (int v = 0; v < vertexCount; v++) vertexScore[v] = ForsythVertexScore(-1, remaining[v]);
+
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<unsigned short> result(indexCount);
+
+    int cache[MESH_OPTIMIZE_CACHE_SIZE + 3] = { 0 };
+    int cacheCount = 0;
+
+    int best = -1;
+    int cursor = 0;
+
+    for (int out = 0; out < triangleCount; out++)
+    {
+        if (best < 0)
+        {
+            while (emitted[cursor]) cursor++;
+            best = cursor;
+        }
+
+        const unsigned short *tri = &indices[best*3];
+        memcpy(&result[out*3], tri, 3*sizeof(unsigned short));
+        emitted[best] = 1;
+
+        for (int k = 0; k < 3; k++)
+        {
+            int *triangles = &adjacency[offsets[tri[k]]];
+            const int count = remaining[tri[k]]--;
+
+            for (int i = 0; i < count; i++)
+            {
+                if (triangles[i] == best) { std::swap(triangles[i], triangles[count - 1]); break; }
+            }
+        }
+
+        // Vertices of the triangle move to the front, the ones pushed past the end drop out
+        int updated[MESH_OPTIMIZE_CACHE_SIZE + 3];
+        int updatedCount = 0;
+
+        for (int k = 0; k < 3; k++) updated[updatedCount++] = tri[k];
+
+        for (int i = 0; i < cacheCount; i++)
+        {
+            const int v = cache[i];
+            if ((v != tri[0]) && (v != tri[1]) && (v != tri[2])) updated[updatedCount++] = v;
+        }
+
+        for (int i = 0; i < updatedCount; i++)
+        {
+            const int v = updated[i];
+            cachePosition[v] = (i < MESH_OPTIMIZE_CACHE_SIZE)? i : -1;
+            vertexScore[v] = ForsythVertexScore(cachePosition[v], remaining[v]);
+        }
+
+        cacheCount = std::min(updatedCount, MESH_OPTIMIZE_CACHE_SIZE);
+        memcpy(cache, updated, cacheCount*sizeof(int));
+
+        // Only triangles around changed vertices change their score, the best one of those is next
+        best = -1;
+        float bestScore = 0.0f;
+
+        for (int i = 0; i < updatedCount; i++)
+        {
+            const int v = updated[i];
+            const int *triangles = &adjacency[offsets[v]];
+
+            for (int j = 0; j < remaining[v]; j++)
+            {
+                const int t = triangles[j];
+                const float score = vertexScore[indices[t*3]] + vertexScore[indices[t*3 + 1]] + vertexScore[indices[t*3 + 2]];
+
+                if ((i < cacheCount) && (score > bestScore)) { best = t; bestScore = score; }
+            }
+        }
+    }
+
+    memcpy(indices, result.data(), indexCount*sizeof(unsigned short));
+}
+
+// Reorder clusters of the cache optimized triangles so outward facing ones are drawn first
+// NOTE: Clusters start where the simulated cache restarts, or where splitting them costs less than
+// 5% of their cache efficiency. Clusters are sorted by how far they face out from the mesh center,
+// like Sander et al. "Fast triangle reordering for vertex locality and reduced overdraw"
+static void OptimizeOverdraw(unsigned short *indices, int triangleCount, const float *vertices, int vertexCount)
+{
+    // FIFO cache simulated through the time every vertex was last loaded
+    std::vector<unsigned int> loadTime(vertexCount, 0);
+    unsigned int time = MESH_VERTEX_CACHE_SIZE + 1;
+
+    auto missCount = [&](int t) {
+        int misses = 0;
+
+        for (int k = 0; k < 3; k++)
+        {
+            const unsigned short v = indices[t*3 + k];
+            if (time - loadTime[v] > MESH_VERTEX_CACHE_SIZE) { loadTime[v] = time++; misses++; }
+        }
+
+        return misses;
+    };
+
+    std::vector<int> hardStarts;
+    for (int t = 0; t < triangleCount; t++)
+    {
+        if ((missCount(t) == 3) || (t == 0)) hardStarts.push_back(t);
+    }
+    hardStarts.push_back(triangleCount);
+
+    std::vector<int> clusterStarts;
+
+    for (size_t c = 0; c + 1 < hardStarts.size(); c++)
+    {
+        const int begin = hardStarts[c];
+        const int end = hardStarts[c + 1];
+
+        time += MESH_VERTEX_CACHE_SIZE + 1;
+
+        int misses = 0;
+        for (int t = begin; t < end; t++) misses += missCount(t);
+
+        const float threshold = 1.05f*(float)misses/(float)(end - begin);
+
+        time += MESH_VERTEX_CACHE_SIZE + 1;
+
+        int start = begin;
+        misses = 0;
+        clusterStarts.push_back(begin);
+
+        for (int t = begin; t < end; t++)
+        {
+            misses += missCount(t);
+
+            if ((t + 1 < end) && ((float)misses/(float)(t + 1 - start) <= threshold))
+            {
+                clusterStarts.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                time += MESH_VERTEX_CACHE_SIZE + 1;
+            }
+        }
+    }
+
+    const int clusterCount = (int)clusterStarts.size();
+    clusterStarts.push_back(triangleCount);
+
+    if (clusterCount < 2) return;
+
+    // Area weighted centroids and normals
+    std::vector<float> clusterData(clusterCount*6, 0.0f);
+    float meshCentroid[3] = { 0 };
+    float meshArea = 0.0f;
+
+    for (int c = 0; c < clusterCount; c++)
+    {
+        float *centroid = &clusterData[c*6];
+        float *normal = &clusterData[c*6 + 3];
+        float area = 0.0f;
+
+        for (int t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+        {
+            const float *a = &vertices[indices[t*3]*3];
+            const float *b = &vertices[indices[t*3 + 1]*3];
+            const float *d = &vertices[indices[t*3 + 2]*3];
+
+            const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            const float e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+            const float n[3] = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+            const float w = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+
+            for (int k = 0; k < 3; k++)
+            {
+                centroid[k] += w*(a[k] + b[k] + d[k])/3.0f;
+                normal[k] += n[k];
+            }
+
+            area += w;
+        }
+
+        for (int k = 0; k < 3; k++) meshCentroid[k] += centroid[k];
+        meshArea += area;
+
+        if (area > 0.0f) for (int k = 0; k < 3; k++) centroid[k] /= area;
+    }
+
+    if (meshArea > 0.0f) for (int k = 0; k < 3; k++) meshCentroid[k] /= meshArea;
+
+    std::vector<float> facing(clusterCount);
+    std::vector<int> clusterOrder(clusterCount);
+
+    for (int c = 0; c < clusterCount; c++)
+    {
+        const float *centroid = &clusterData[c*6];
+        float normal[3];
+        NormalizeNormal(&clusterData[c*6 + 3], normal);
+
+        facing[c] = (centroid[0] - meshCentroid[0])*normal[0] +
+                    (centroid[1] - meshCentroid[1])*normal[1] +
+                    (centroid[2] - meshCentroid[2])*normal[2];
+        clusterOrder[c] = c;
+    }
+
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](int a, int b) { return facing[a] > facing[b]; });
+
+    std::vector<unsigned short> result;
+    result.reserve(triangleCount*3);
+
+    for (int c : clusterOrder)
+    {
+        result.insert(result.end(), &indices[clusterStarts[c]*3], &indices[clusterStarts[c + 1]*3]);
+    }
+
+    memcpy(indices, result.data(), triangleCount*3*sizeof(unsigned short));
+}
+
+// Move the components of every vertex v to remap[v], if the attribute is present
+template <typename T>
+static void RemapVertexAttribute(T *data, int components, const std::vector<int> &remap)
+{
+    if (data == NULL) return;
+
+    const std::vector<T> source(data, data + remap.size()*components);
+
+    for (size_t v = 0; v < remap.size(); v++)
+    {
+        memcpy(&data[remap[v]*components], &source[v*components], components*sizeof(T));
+    }
+}
+
+// Renumber vertices in the order the triangles first use them, unused ones go last
+static void OptimizeVertexFetch(Mesh *mesh)
+{
+    std::vector<int> remap(mesh->vertexCount, -1);
+    int next = 0;
+
+    for (int i = 0; i < mesh->triangleCount*3; i++)
+    {
+        const unsigned short v = mesh->indices[i];
+        if (remap[v] < 0) remap[v] = next++;
+        mesh->indices[i] = (unsigned short)remap[v];
+    }
+
+    for (int v = 0; v < mesh->vertexCount; v++)
+    {
+        if (remap[v] < 0) remap[v] = next++;
+    }
+
+    RemapVertexAttribute(mesh->vertices, 3, remap);
+    RemapVertexAttribute(mesh->texcoords, 2, remap);
+    RemapVertexAttribute(mesh->texcoords2, 2, remap);
+    RemapVertexAttribute(mesh->normals, 3, remap);
+    RemapVertexAttribute(mesh->tangents, 4, remap);
+    RemapVertexAttribute(mesh->colors, 4, remap);
+
+    RemapVertexAttribute(mesh->animVertices, 3, remap);
+    RemapVertexAttribute(mesh->animNormals, 3, remap);
+    RemapVertexAttribute(mesh->boneIds, 4, remap);
+    RemapVertexAttribute(mesh->boneWeights, 4, remap);
+}
+
+// Reorder triangles and vertices of an indexed mesh for the GPU
+// NOTE: Works on CPU data, meshes must be optimized before they are uploaded.
+// Triangles are ordered for the vertex cache, then in clusters for overdraw, then vertices for fetch locality
+void OptimizeMesh(Mesh *mesh)
+{
+    if ((mesh->indices == NULL) || (mesh->triangleCount == 0) || (mesh->vertices == NULL)) return;
+
+    if (mesh->vaoId > 0)
+    {
+        TraceLog(LOG_WARNING, "VAO: [ID %i] Mesh already uploaded, optimizing it has no effect on the GPU", mesh->vaoId);
+        return;
+    }
+
+    OptimizeVertexCache(mesh->indices, mesh->triangleCount, mesh->vertexCount);
+    OptimizeOverdraw(mesh->indices, mesh->triangleCount, mesh->vertices, mesh->vertexCount);
+    OptimizeVertexFetch(mesh);
+}
+
+// Get average cache miss ratio of a mesh: vertices transformed per triangle with a FIFO cache
+// NOTE: 0.5 is the best a closed mesh can get, 3.0 means no reuse at all
+float GetMeshACMR(Mesh mesh, int cacheSize)
+{
+    if (mesh.triangleCount == 0) return 0.0f;
+    if (mesh.indices == NULL) return 3.0f;
+
+    std::vector<unsigned int> loadTime(mesh.vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    int misses = 0;
+
+    for (int i = 0; i < mesh.triangleCount*3; i++)
+    {
+        const unsigned short v = mesh.indices[i];
+        if (time - loadTime[v] > (unsigned int)cacheSize) { loadTime[v] = time++; misses++; }
+    }
+
+    return (float)misses/(float)mesh.triangleCount;
+}
+
+// Append the triangles of a mesh, indexed or not, to stl_writer style arrays
+// NOTE: Vertices are transformed, triangles are flipped if the transform mirrors them
+static void AppendMeshTriangles(const Mesh &mesh, Matrix transform, std::vector<float> &coords, std::vector<unsigned int> &tris)
+{
+    const unsigned int firstVertex = (unsigned int)(coords.size()/3);
+    const size_t firstIndex = tris.size();
+
+    for (int v = 0; v < mesh.vertexCount; v++)
+    {
+        const Vector3 p = Vector3Transform(Vector3{ mesh.vertices[v*3], mesh.vertices[v*3 + 1], mesh.vertices[v*3 + 2] }, transform);
+        coords.push_back(p.x);
+        coords.push_back(p.y);
+        coords.push_back(p.z);
+    }
+
+    if (mesh.indices != NULL)
+    {
+        for (int i = 0; i < mesh.triangleCount*3; i++) tris.push_back(firstVertex + mesh.indices[i]);
+    }
+    else
+    {
+        for (int i = 0; i < mesh.vertexCount; i++) tris.push_back(firstVertex + i);
+    }
+
+    if (MatrixDeterminant(transform) < 0.0f)
+    {
+        for (size_t i = firstIndex; i + 2 < tris.size(); i += 3) std::swap(tris[i + 1], tris[i + 2]);
+    }
+}
+
+// Write stl_writer style arrays, facet normals are computed by the writer
+static bool WriteTrianglesSTL(const char *fileName, const std::vector<float> &coords,
+                              const std::vector<unsigned int> &tris, bool ascii)
+{
+    stl_writer::WriteOptions options;
+    options.numThreads = 0;
+    options.format = ascii? stl_writer::FORMAT_ASCII : stl_writer::FORMAT_BINARY;
+    options.solidName = GetFileNameWithoutExt(fileName);
+
+    try
+    {
+        stl_writer::WriteStlFile(fileName, coords, std::vector<float>(), tris, options);
+    }
+    catch (std::exception &e)
+    {
+        TraceLog(LOG_WARNING, "[%s] STL file could not be written: %s", fileName, e.what());
+        return false;
+    }
+
+    TraceLog(LOG_INFO, "[%s] STL file exported: %i triangles", fileName, (int)(tris.size()/3));
+
+    return true;
+}
+
+// Export mesh data to stl file
+bool ExportMeshSTL(Mesh mesh, const char *fileName, bool ascii)
+{
+    std::vector<float> coords;
+    std::vector<unsigned int> tris;
+
+    AppendMeshTriangles(mesh, MatrixIdentity(), coords, tris);
+
+    return WriteTrianglesSTL(fileName, coords, tris, ascii);
+}
+
+// Export all meshes of a model into one stl file
+// NOTE: Vertices are written in world space, model.transform is applied like DrawModel() does
+bool ExportModelSTL(Model model, const char *fileName, bool ascii)
+{
+    std::vector<float> coords;
+    std::vector<unsigned int> tris;
+
+    for (int i = 0; i < model.meshCount; i++) AppendMeshTriangles(model.meshes[i], model.transform, coords, tris);
+
+    return WriteTrianglesSTL(fileName, coords, tris, ascii);
+}
+
+#if !defined(MESH_IMPORT_NO_CACHE)
+// Hash of a byte range, words are mixed in one multiply-rotate chain
+static uint64_t HashBytes(const char *data, size_t size, uint64_t seed)
+{
+    const uint64_t k1 = 0x9E3779B97F4A7C15ull;
+    const uint64_t k2 = 0xBF58476D1CE4E5B9ull;
+
+    uint64_t h = seed ^ (size*k1);
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, data + i, 8);
+        h ^= w*k1;
+        h = ((h << 31) | (h >> 33))*k2;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, size - i);
+    h ^= tail*k1;
+
+    // Final avalanche (splitmix64)
+    h ^= h >> 30; h *= k2;
+    h ^= h >> 27; h *= 0x94D049BB133111EBull;
+    h ^= h >> 31;
+
+    return h;
+}
+
+// Content hash of a file, blocks are hashed on several threads and combined in order
+static uint64_t HashFileContent(const char *data, size_t size)
+{
+    const size_t blockSize = 1 << 22;
+    const size_t blockCount = (size + blockSize - 1)/blockSize;
+
+    std::vector<uint64_t> blockHashes(blockCount);
+
+    stl_reader::stl_reader_impl::ParallelFor(blockCount, 0, [&](size_t begin, size_t end)
+    {
+        for (size_t b = begin; b < end; b++)
+        {
+            blockHashes[b] = HashBytes(data + b*blockSize, std::min(blockSize, size - b*blockSize), b);
+        }
+    }, 1);
+
+    return HashBytes((const char *)blockHashes.data(), blockCount*sizeof(uint64_t), size);
+}
+
+static std::string MeshCacheFileName(uint64_t sourceHash)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.mesh", (unsigned long long)sourceHash);
+    return std::string(MESH_CACHE_DIRECTORY) + "/" + name;
+}
+
+// Write a cache file under a temporary name and rename it, so readers never see partial files
+static void WriteCacheFile(const char *cacheFile, const std::vector<char> &buffer)
+{
+    MAKE_DIRECTORY(MESH_CACHE_DIRECTORY);
+
+    // Unique per thread and point in time, other instances may write the same cache file
+    const std::string tempFile = std::string(cacheFile) + "." +
+        std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()) ^
+                       (size_t)std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+
+    if (!stl_writer::stl_writer_impl::WriteBufferToFile(tempFile.c_str(), buffer.data(), buffer.size()) ||
+        (rename(tempFile.c_str(), cacheFile) != 0))
+    {
+        remove(tempFile.c_str());
+        TraceLog(LOG_WARNING, "[%s] Mesh cache could not be written", cacheFile);
+    }
+}
+
+// Settings the cached meshes depend on besides the source, entries made with others are not used
+static void SetMeshCacheSettings(MeshCacheHeader &header, const stl_reader::ReadOptions &options)
+{
+    header.creaseAngle = MESH_CREASE_ANGLE;
+    header.weldMode = (uint32_t)options.weldMode;
+    header.weldEpsilon = options.weldEpsilon;
+}
+
+// Every index refers to one of vertexCount vertices
+static bool MeshIndicesInRange(const unsigned short *indices, size_t indexCount, unsigned int vertexCount)
+{
+    unsigned short maxIndex = 0;
+    for (size_t i = 0; i < indexCount; i++) maxIndex = std::max(maxIndex, indices[i]);
+
+    return (indexCount == 0) || (maxIndex < vertexCount);
+}
+
+// Load meshes from a cache file, NULL if there is no valid cache for the source and settings
+// NOTE: Indices are checked, a damaged file must not make the GPU read past the vertex buffers
+static Mesh *LoadMeshCache(const char *cacheFile, uint64_t sourceHash, uint64_t sourceSize,
+                           const stl_reader::ReadOptions &options, int *meshCount, int **meshParts)
+{
+    stl_reader::stl_reader_impl::MappedFile file;
+    if (!file.open(cacheFile) || (file.size() < sizeof(MeshCacheHeader))) return NULL;
+
+    const char *data = file.data();
+    const size_t size = file.size();
+
+    MeshCacheHeader header, settings = { 0 };
+    memcpy(&header, data, sizeof(header));
+    SetMeshCacheSettings(settings, options);
+
+    if ((memcmp(header.magic, "MESHCACH", 8) != 0) || (header.version != MESH_CACHE_VERSION) ||
+        (header.sourceHash != sourceHash) || (header.sourceSize != sourceSize) || (header.meshCount == 0) ||
+        ((size - sizeof(header))/sizeof(MeshCacheEntry) < header.meshCount)) return NULL;
+
+    if ((header.creaseAngle != settings.creaseAngle) || (header.weldMode != settings.weldMode) ||
+        (header.weldEpsilon != settings.weldEpsilon)) return NULL;
+
+    std::vector<MeshCacheEntry> entries(header.meshCount);
+    memcpy(entries.data(), data + sizeof(header), header.meshCount*sizeof(MeshCacheEntry));
+
+    for (const MeshCacheEntry &entry : entries)
+    {
+        const uint64_t vertexBytes = (uint64_t)entry.vertexCount*3*sizeof(float);
+        const uint64_t indexBytes = (uint64_t)entry.triangleCount*3*sizeof(unsigned short);
+
+        if ((entry.vertexCount > MAX_MESH_INDEXED_VERTICES) ||
+            (entry.verticesOffset > size) || (size - entry.verticesOffset < vertexBytes) ||
+            (entry.normalsOffset > size) || (size - entry.normalsOffset < vertexBytes) ||
+            (entry.indicesOffset > size) || (size - entry.indicesOffset < indexBytes) ||
+            (entry.indicesOffset%sizeof(unsigned short) != 0)) return NULL;
+
+        // Cache files are replaced by renaming, never written in place, so the mapping stays as checked
+        if (!MeshIndicesInRange((const unsigned short *)(data + entry.indicesOffset), (size_t)entry.triangleCount*3,
+                                entry.vertexCount)) return NULL;
+    }
+
+    // raylib owns and frees the mesh arrays, so they are copied out of the mapping
+    *meshCount = (int)header.meshCount;
+    Mesh *meshes = (Mesh *)RL_CALLOC(*meshCount, sizeof(Mesh));
+    *meshParts = (int *)RL_MALLOC(*meshCount*sizeof(int));
+
+    for (int i = 0; i < *meshCount; i++)
+    {
+        const MeshCacheEntry &entry = entries[i];
+        Mesh &mesh = meshes[i];
+
+        (*meshParts)[i] = (int)entry.part;
+
+        mesh.vboId = (unsigned int *)RL_CALLOC(MAX_MESH_VBO, sizeof(unsigned int));
+        mesh.vertexCount = (int)entry.vertexCount;
+        mesh.triangleCount = (int)entry.triangleCount;
+
+        mesh.vertices = (float *)RL_MALLOC(mesh.vertexCount*3*sizeof(float));
+        mesh.normals = (float *)RL_MALLOC(mesh.vertexCount*3*sizeof(float));
+        mesh.indices = (unsigned short *)RL_MALLOC(mesh.triangleCount*3*sizeof(unsigned short));
+
+        memcpy(mesh.vertices, data + entry.verticesOffset, mesh.vertexCount*3*sizeof(float));
+        memcpy(mesh.normals, data + entry.normalsOffset, mesh.vertexCount*3*sizeof(float));
+        memcpy(mesh.indices, data + entry.indicesOffset, mesh.triangleCount*3*sizeof(unsigned short));
+    }
+
+    return meshes;
+}
+
+// Write meshes to a cache file
+static void SaveMeshCache(const char *cacheFile, uint64_t sourceHash, uint64_t sourceSize, const stl_reader::ReadOptions &options,
+                          const Mesh *meshes, const int *meshParts, int meshCount, int vertexCount)
+{
+    const auto align = [](uint64_t offset) { return (offset + 15) & ~(uint64_t)15; };
+
+    MeshCacheHeader header = { 0 };
+    memcpy(header.magic, "MESHCACH", 8);
+    header.version = MESH_CACHE_VERSION;
+    header.meshCount = (uint32_t)meshCount;
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.vertexCount = (uint32_t)vertexCount;
+    SetMeshCacheSettings(header, options);
+
+    std::vector<MeshCacheEntry> entries(meshCount);
+    uint64_t offset = align(sizeof(header) + meshCount*sizeof(MeshCacheEntry));
+
+    for (int i = 0; i < meshCount; i++)
+    {
+        const Mesh &mesh = meshes[i];
+        MeshCacheEntry &entry = entries[i];
+        memset(&entry, 0, sizeof(entry));
+
+        entry.vertexCount = (uint32_t)mesh.vertexCount;
+        entry.triangleCount = (uint32_t)mesh.triangleCount;
+        entry.part = (uint32_t)meshParts[i];
+        entry.verticesOffset = offset; offset = align(offset + mesh.vertexCount*3*sizeof(float));
+        entry.normalsOffset = offset; offset = align(offset + mesh.vertexCount*3*sizeof(float));
+        entry.indicesOffset = offset; offset = align(offset + mesh.triangleCount*3*sizeof(unsigned short));
+
+        const BoundingBox box = MeshBoundingBox(mesh);
+        const float bounds[6] = { box.min.x, box.min.y, box.min.z, box.max.x, box.max.y, box.max.z };
+        memcpy(entry.bounds, bounds, sizeof(bounds));
+
+        for (int k = 0; k < 3; k++)
+        {
+            header.bounds[k] = (i == 0)? bounds[k] : std::min(header.bounds[k], bounds[k]);
+            header.bounds[k + 3] = (i == 0)? bounds[k + 3] : std::max(header.bounds[k + 3], bounds[k + 3]);
+        }
+
+        header.triangleCount += entry.triangleCount;
+    }
+
+    std::vector<char> buffer(offset, 0);
+    memcpy(buffer.data(), &header, sizeof(header));
+    memcpy(buffer.data() + sizeof(header), entries.data(), entries.size()*sizeof(MeshCacheEntry));
+
+    for (int i = 0; i < meshCount; i++)
+    {
+        memcpy(buffer.data() + entries[i].verticesOffset, meshes[i].vertices, meshes[i].vertexCount*3*sizeof(float));
+        memcpy(buffer.data() + entries[i].normalsOffset, meshes[i].normals, meshes[i].vertexCount*3*sizeof(float));
+        memcpy(buffer.data() + entries[i].indicesOffset, meshes[i].indices, meshes[i].triangleCount*3*sizeof(unsigned short));
+    }
+
+    WriteCacheFile(cacheFile, buffer);
+}
+#endif // MESH_IMPORT_NO_CACHE
+
+// Optimize meshes in parallel and report the vertex cache efficiency gained
+static void OptimizeMeshes(const char *fileName, Mesh *meshes, int meshCount)
+{
+    std::vector<float> before(meshCount), after(meshCount);
+
+    stl_reader::stl_reader_impl::ParallelFor(meshCount, 0, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            before[i] = GetMeshACMR(meshes[i], MESH_VERTEX_CACHE_SIZE);
+            OptimizeMesh(&meshes[i]);
+            after[i] = GetMeshACMR(meshes[i], MESH_VERTEX_CACHE_SIZE);
+        }
+    }, 1);
+
+    double beforeSum = 0.0, afterSum = 0.0;
+    long long triangleCount = 0;
+
+    for (int i = 0; i < meshCount; i++)
+    {
+        beforeSum += (double)before[i]*meshes[i].triangleCount;
+        afterSum += (double)after[i]*meshes[i].triangleCount;
+        triangleCount += meshes[i].triangleCount;
+    }
+
+    if (triangleCount > 0)
+    {
+        TraceLog(LOG_INFO, "[%s] Meshes optimized, ACMR %.3f -> %.3f (%i entry vertex cache)", fileName,
+                 beforeSum/triangleCount, afterSum/triangleCount, MESH_VERTEX_CACHE_SIZE);
+    }
+}
+
+// Load indexed meshes (CPU only) from stl file, one or more per solid
+// NOTE: Returns NULL on failure. If meshParts is given, it receives the solid of every mesh,
+// to be freed with RL_FREE(). progress, if given, is advanced as the stages finish
+Mesh *LoadMeshesSTL(const char *fileName, int *meshCount, int **meshParts, std::atomic<float> *progress)
+{
+    *meshCount = 0;
+    int *parts = NULL;
+
+    std::vector<float> coords, normals;
+    std::vector<unsigned int> tris, solids;
+
+    stl_reader::ReadOptions options;
+    options.numThreads = 0;
+    options.weldMode = stl_reader::WELD_HASH;
+    options.readNormals = false;        // Normals are generated along creases
+
+#if defined(MESH_IMPORT_MEMORY_BUDGET)
+    stl_reader::ReadStats stats;
+    options.lowMemory = true;
+    options.memoryBudget = MESH_IMPORT_MEMORY_BUDGET;
+    options.stats = &stats;
+#endif
+
+    Mesh *meshes = NULL;
+
+    try
+    {
+        stl_reader::stl_reader_impl::MappedFile file;
+        if (!file.open(fileName))
+        {
+            TraceLog(LOG_WARNING, "[%s] STL file could not be opened", fileName);
+            if (progress != nullptr) *progress = 1.0f;
+            return NULL;
+        }
+
+#if !defined(MESH_IMPORT_NO_CACHE)
+        const uint64_t sourceSize = file.size();
+        const uint64_t sourceHash = HashFileContent(file.data(), file.size());
+        const std::string cacheFile = MeshCacheFileName(sourceHash);
+
+        meshes = LoadMeshCache(cacheFile.c_str(), sourceHash, sourceSize, options, meshCount, &parts);
+
+        if (meshes != NULL)
+        {
+            TraceLog(LOG_INFO, "[%s] STL model loaded from cache %s: %i meshes", fileName, cacheFile.c_str(), *meshCount);
+            if (progress != nullptr) *progress = 1.0f;
+
+            if (meshParts != NULL) *meshParts = parts;
+            else RL_FREE(parts);
+
+            return meshes;
+        }
+
+        if (progress != nullptr) *progress = 0.1f;
+#endif
+
+        if (stl_reader::ReadStlBuffer(file.data(), file.size(), coords, normals, tris, solids, options) && !tris.empty())
+        {
+            file.close();
+
+#if defined(MESH_IMPORT_MEMORY_BUDGET)
+            TraceLog(LOG_INFO, "[%s] STL read with peak memory: parse %.1f MB, output %.1f MB, %.1f MB spilled", fileName,
+                     stats.parsePeakRss/1048576.0, stats.outputPeakRss/1048576.0, stats.spilledBytes/1048576.0);
+#endif
+            if (progress != nullptr) *progress = 0.6f;
+
+            // Every solid of the file becomes its own part
+            meshes = GenMeshesIndexedParts(coords.data(), (int)(coords.size()/3), tris.data(),
+                                           solids.data(), (int)solids.size() - 1, meshCount, &parts);
+
+            if (progress != nullptr) *progress = 0.75f;
+            OptimizeMeshes(fileName, meshes, *meshCount);
+
+#if !defined(MESH_IMPORT_NO_CACHE)
+            if (progress != nullptr) *progress = 0.9f;
+            SaveMeshCache(cacheFile.c_str(), sourceHash, sourceSize, options, meshes, parts, *meshCount, (int)(coords.size()/3));
+#endif
+        }
+    }
+    catch (std::exception &e)
+    {
+        TraceLog(LOG_WARNING, "[%s] STL file could not be read: %s", fileName, e.what());
+    }
+
+    if (meshes != NULL)
+    {
+        TraceLog(LOG_INFO, "[%s] STL model loaded: %i vertices, %i triangles, %i solids, %i meshes", fileName,
+                 (int)(coords.size()/3), (int)(tris.size()/3), (int)solids.size() - 1, *meshCount);
+    }
+
+    if (progress != nullptr) *progress = 1.0f;
+
+    if (meshParts != NULL) *meshParts = parts;
+    else RL_FREE(parts);
+
+    return meshes;
+}
+
+// Count the statements of an obj chunk, so that all chunks can be parsed straight into place
+static void CountObjChunk(ObjChunk &chunk)
+{
+    using namespace stl_reader::stl_reader_impl;
+
+    for (const char *p = chunk.begin; p < chunk.end;)
+    {
+        const char *lineEnd = LineEnd(p, chunk.end);
+        const char *tok = SkipBlanks(p, lineEnd);
+        const char *tokEnd = TokenEnd(tok, lineEnd);
+
+        if (TokenIs(tok, tokEnd, "v")) chunk.positionCount++;
+        else if (TokenIs(tok, tokEnd, "vt")) chunk.texcoordCount++;
+        else if (TokenIs(tok, tokEnd, "vn")) chunk.normalCount++;
+        else if (TokenIs(tok, tokEnd, "f"))
+        {
+            int cornerCount = 0;
+            for (const char *c = SkipBlanks(tokEnd, lineEnd); c < lineEnd; c = SkipBlanks(TokenEnd(c, lineEnd), lineEnd)) cornerCount++;
+
+            // Faces are triangulated as fans
+            if (cornerCount >= 3) chunk.triangleCount += cornerCount - 2;
+        }
+
+        p = lineEnd + 1;
+    }
+}
+
+// Parse one index of a face corner, negative indices count back from the last one defined
+// NOTE: Returns false for malformed or out of range indices
+static bool ParseObjIndex(const char *&p, const char *end, int defined, int total, int &index)
+{
+    bool negative = false;
+
+    if ((p < end) && ((*p == '-') || (*p == '+')))
+    {
+        negative = (*p == '-');
+        p++;
+    }
+
+    if ((p == end) || (*p < '0') || (*p > '9')) return false;
+
+    long long value = 0;
+    while ((p < end) && (*p >= '0') && (*p <= '9'))
+    {
+        value = value*10 + (*p - '0');
+        if (value > total) return false;
+        p++;
+    }
+
+    index = negative? defined - (int)value : (int)value - 1;
+
+    return (index >= 0) && (index < total);
+}
+
+// Parse a face corner: v, v/vt, v//vn or v/vt/vn
+static bool ParseObjCorner(const char *tok, const char *tokEnd, const int *defined, const int *totals, ObjCorner &corner)
+{
+    const char *p = tok;
+
+    corner.vt = -1;
+    corner.vn = -1;
+
+    if (!ParseObjIndex(p, tokEnd, defined[0], totals[0], corner.v)) return false;
+
+    if ((p < tokEnd) && (*p == '/'))
+    {
+        p++;
+        if ((p < tokEnd) && (*p != '/') && !ParseObjIndex(p, tokEnd, defined[1], totals[1], corner.vt)) return false;
+
+        if ((p < tokEnd) && (*p == '/'))
+        {
+            p++;
+            if (!ParseObjIndex(p, tokEnd, defined[2], totals[2], corner.vn)) return false;
+        }
+    }
+
+    return (p == tokEnd);
+}
+
+// Parse the statements of an obj chunk into the arrays of the whole file
+// NOTE: bases holds the positions, texcoords, normals and triangles of all chunks before this one
+static void ParseObjChunk(ObjChunk &chunk, const int *bases, const int *totals,
+                          float *positions, float *texcoords, float *normals, ObjCorner *corners)
+{
+    using namespace stl_reader::stl_reader_impl;
+
+    int defined[3] = { bases[0], bases[1], bases[2] };
+    int triangle = bases[3];
+
+    std::vector<ObjCorner> face;
+
+    for (const char *p = chunk.begin; p < chunk.end;)
+    {
+        const char *lineEnd = LineEnd(p, chunk.end);
+        const char *tok = SkipBlanks(p, lineEnd);
+        const char *tokEnd = TokenEnd(tok, lineEnd);
+        const char *next = lineEnd + 1;
+
+        double values[3] = { 0.0, 0.0, 0.0 };
+        p = tokEnd;
+
+        if (TokenIs(tok, tokEnd, "v"))
+        {
+            // Trailing w or vertex colors are ignored
+            for (int k = 0; k < 3; k++)
+            {
+                if (!ParseAsciiNumber(p, lineEnd, values[k])) { chunk.failed = true; return; }
+                positions[defined[0]*3 + k] = (float)values[k];
+            }
+
+            defined[0]++;
+        }
+        else if (TokenIs(tok, tokEnd, "vt"))
+        {
+            // v is optional, flipped like LoadOBJ() does
+            if (!ParseAsciiNumber(p, lineEnd, values[0])) { chunk.failed = true; return; }
+            ParseAsciiNumber(p, lineEnd, values[1]);
+
+            texcoords[defined[1]*2] = (float)values[0];
+            texcoords[defined[1]*2 + 1] = 1.0f - (float)values[1];
+            defined[1]++;
+        }
+        else if (TokenIs(tok, tokEnd, "vn"))
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                if (!ParseAsciiNumber(p, lineEnd, values[k])) { chunk.failed = true; return; }
+                normals[defined[2]*3 + k] = (float)values[k];
+            }
+
+            defined[2]++;
+        }
+        else if (TokenIs(tok, tokEnd, "f"))
+        {
+            face.clear();
+
+            for (const char *c = SkipBlanks(tokEnd, lineEnd); c < lineEnd;)
+            {
+                const char *cEnd = TokenEnd(c, lineEnd);
+
+                ObjCorner corner;
+                if (!ParseObjCorner(c, cEnd, defined, totals, corner)) { chunk.failed = true; return; }
+                face.push_back(corner);
+
+                c = SkipBlanks(cEnd, lineEnd);
+            }
+
+            for (size_t i = 1; i + 1 < face.size(); i++, triangle++)
+            {
+                corners[triangle*3] = face[0];
+                corners[triangle*3 + 1] = face[i];
+                corners[triangle*3 + 2] = face[i + 1];
+            }
+        }
+        else if (TokenIs(tok, tokEnd, "o") || TokenIs(tok, tokEnd, "g"))
+        {
+            const char *name = SkipBlanks(tokEnd, lineEnd);
+            const char *nameEnd = lineEnd;
+            while ((nameEnd > name) && IsBlank(nameEnd[-1])) nameEnd--;
+
+            ObjGroupStart group;
+            group.triangle = triangle;
+            group.name = (name < nameEnd)? std::string(name, nameEnd) : "default";
+            chunk.groups.push_back(group);
+        }
+
+        p = next;
+    }
+}
+
+// Read obj data into flat arrays, faces are triangulated as fans
+// NOTE: The buffer is split into one chunk of whole lines per thread. A first pass counts the statements
+// of every chunk, so the second pass can parse them straight into place and resolve relative indices
+static bool ReadObjBuffer(const char *data, size_t size,
+                          std::vector<float> &positions, std::vector<float> &texcoords, std::vector<float> &normals,
+                          std::vector<ObjCorner> &corners, std::vector<ObjGroupStart> &groups)
+{
+    using namespace stl_reader::stl_reader_impl;
+
+    const char *end = data + size;
+    const unsigned int chunkCount = NumWorkerThreads(0, size, 1 << 20);
+
+    std::vector<ObjChunk> chunks(chunkCount);
+
+    const char *p = data;
+    for (unsigned int c = 0; c < chunkCount; c++)
+    {
+        chunks[c].begin = p;
+
+        if (c + 1 == chunkCount) p = end;
+        else
+        {
+            const char *lineEnd = LineEnd(std::max(p, data + size*(c + 1)/chunkCount), end);
+            p = (lineEnd < end)? lineEnd + 1 : end;
+        }
+
+        chunks[c].end = p;
+    }
+
+    ParallelForChunks(chunkCount, chunkCount, [&](size_t c, size_t, size_t) { CountObjChunk(chunks[c]); });
+
+    std::vector<int> bases(chunkCount*4);
+    int totals[4] = { 0, 0, 0, 0 };
+
+    for (unsigned int c = 0; c < chunkCount; c++)
+    {
+        const int counts[4] = { chunks[c].positionCount, chunks[c].texcoordCount, chunks[c].normalCount, chunks[c].triangleCount };
+
+        for (int k = 0; k < 4; k++)
+        {
+            bases[c*4 + k] = totals[k];
+            totals[k] += counts[k];
+        }
+    }
+
+    positions.resize(totals[0]*3);
+    texcoords.resize(totals[1]*2);
+    normals.resize(totals[2]*3);
+    corners.resize(totals[3]*3);
+
+    ParallelForChunks(chunkCount, chunkCount, [&](size_t c, size_t, size_t) {
+        ParseObjChunk(chunks[c], &bases[c*4], totals, positions.data(), texcoords.data(), normals.data(), corners.data());
+    });
+
+    groups.clear();
+
+    for (unsigned int c = 0; c < chunkCount; c++)
+    {
+        if (chunks[c].failed) return false;
+        groups.insert(groups.end(), chunks[c].groups.begin(), chunks[c].groups.end());
+    }
+
+    return true;
+}
+
+// Generate indexed meshes from parsed obj data, one or more per object or group
+// NOTE: Statements with the same name share a part. Every distinct v/vt/vn combination becomes one vertex,
+// files without normals for all corners get crease split smooth normals instead
+static Mesh *GenMeshesOBJ(const std::vector<float> &positions, const std::vector<float> &texcoords,
+                          std::vector<float> &normals, const std::vector<ObjCorner> &fileCorners,
+                          const std::vector<ObjGroupStart> &groups, int *meshCount, int **meshParts)
+{
+    using stl_reader::stl_reader_impl::ParallelFor;
+
+    const int positionCount = (int)(positions.size()/3);
+    const int triangleCount = (int)(fileCorners.size()/3);
+    const int cornerCount = triangleCount*3;
+
+    // Runs of triangles between group statements, parts in order of first appearance
+    std::vector<int> runStarts, runParts;
+    std::vector<std::string> partNames;
+
+    for (size_t g = 0; g <= groups.size(); g++)
+    {
+        const int begin = (g == 0)? 0 : groups[g - 1].triangle;
+        const int end = (g < groups.size())? groups[g].triangle : triangleCount;
+        if (end <= begin) continue;
+
+        const std::string &name = (g == 0)? std::string("default") : groups[g - 1].name;
+        const int part = (int)(std::find(partNames.begin(), partNames.end(), name) - partNames.begin());
+        if (part == (int)partNames.size()) partNames.push_back(name);
+
+        runStarts.push_back(begin);
+        runParts.push_back(part);
+    }
+
+    runStarts.push_back(triangleCount);
+
+    const int partCount = (int)partNames.size();
+
+    // Triangles sorted by part, runs keep their order
+    std::vector<unsigned int> partRanges(partCount + 1, 0);
+    for (size_t r = 0; r < runParts.size(); r++) partRanges[runParts[r] + 1] += runStarts[r + 1] - runStarts[r];
+    for (int p = 0; p < partCount; p++) partRanges[p + 1] += partRanges[p];
+
+    std::vector<ObjCorner> corners(cornerCount);
+    std::vector<unsigned int> cursors(partRanges.begin(), partRanges.end() - 1);
+
+    for (size_t r = 0; r < runParts.size(); r++)
+    {
+        const int count = runStarts[r + 1] - runStarts[r];
+        memcpy(&corners[cursors[runParts[r]]*3], &fileCorners[runStarts[r]*3], count*3*sizeof(ObjCorner));
+        cursors[runParts[r]] += count;
+    }
+
+    bool allNormals = !normals.empty();
+    bool anyTexcoords = false;
+
+    for (int i = 0; i < cornerCount; i++)
+    {
+        if (corners[i].vn < 0) allNormals = false;
+        if (corners[i].vt >= 0) anyTexcoords = true;
+    }
+
+    // Normal of every corner, from the file or generated over the welded positions
+    std::vector<int> cornerNormals(cornerCount);
+    const float *normalData = NULL;
+    CreaseSplit split;
+
+    if (allNormals)
+    {
+        for (size_t n = 0; n < normals.size()/3; n++) NormalizeNormal(&normals[n*3], &normals[n*3]);
+        for (int i = 0; i < cornerCount; i++) cornerNormals[i] = corners[i].vn;
+        normalData = normals.data();
+    }
+    else
+    {
+        std::vector<unsigned int> positionIndices(cornerCount);
+        for (int i = 0; i < cornerCount; i++) positionIndices[i] = corners[i].v;
+
+        SplitCreaseVertices(positions.data(), positionCount, positionIndices.data(), triangleCount,
+                            partRanges.data(), partCount, MESH_CREASE_ANGLE, split);
+
+        for (int i = 0; i < cornerCount; i++) cornerNormals[i] = (int)split.indices[i];
+        normalData = split.normals.data();
+    }
+
+    // Corners around every position, distinct texcoord and normal pairs among them become vertices
+    std::vector<int> offsets(positionCount + 1, 0);
+    for (int i = 0; i < cornerCount; i++) offsets[corners[i].v + 1]++;
+    for (int v = 0; v < positionCount; v++) offsets[v + 1] += offsets[v];
+
+    std::vector<int> fan(cornerCount);
+    std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+    for (int i = 0; i < cornerCount; i++) fan[fill[corners[i].v]++] = i;
+
+    std::vector<int> cornerVertices(cornerCount);
+    std::vector<int> vertexCounts(positionCount);
+
+    ParallelFor(positionCount, 0, [&](size_t begin, size_t end) {
+        std::vector<std::pair<int, int>> keys;
+
+        for (size_t v = begin; v < end; v++)
+        {
+            keys.clear();
+
+            for (int i = offsets[v]; i < offsets[v + 1]; i++)
+            {
+                const std::pair<int, int> key(corners[fan[i]].vt, cornerNormals[fan[i]]);
+                const size_t k = std::find(keys.begin(), keys.end(), key) - keys.begin();
+                if (k == keys.size()) keys.push_back(key);
+
+                cornerVertices[fan[i]] = (int)k;
+            }
+
+            vertexCounts[v] = (int)keys.size();
+        }
+    }, 1024);
+
+    std::vector<int> bases(positionCount + 1, 0);
+    for (int v = 0; v < positionCount; v++) bases[v + 1] = bases[v] + vertexCounts[v];
+
+    const int vertexCount = bases[positionCount];
+    std::vector<float> vertices(vertexCount*3), vertexNormals(vertexCount*3), vertexTexcoords(anyTexcoords? vertexCount*2 : 0, 0.0f);
+    std::vector<unsigned int> indices(cornerCount);
+
+    ParallelFor(positionCount, 0, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; v++)
+        {
+            for (int i = offsets[v]; i < offsets[v + 1]; i++)
+            {
+                const ObjCorner &corner = corners[fan[i]];
+                const int vertex = bases[v] + cornerVertices[fan[i]];
+
+                memcpy(&vertices[vertex*3], &positions[v*3], 3*sizeof(float));
+                memcpy(&vertexNormals[vertex*3], &normalData[cornerNormals[fan[i]]*3], 3*sizeof(float));
+                if (anyTexcoords && (corner.vt >= 0)) memcpy(&vertexTexcoords[vertex*2], &texcoords[corner.vt*2], 2*sizeof(float));
+
+                indices[fan[i]] = vertex;
+            }
+        }
+    }, 1024);
+
+    return GenMeshesFromVertices(vertices.data(), vertexNormals.data(), anyTexcoords? vertexTexcoords.data() : NULL, vertexCount,
+                                 indices.data(), partRanges.data(), partCount, meshCount, meshParts);
+}
+
+// Load indexed meshes (CPU only) from obj file, one or more per object or group
+// NOTE: Works like LoadMeshesSTL(), meshParts receives the object or group of every mesh.
+// Materials are not read, the model gets the default one
+Mesh *LoadMeshesOBJ(const char *fileName, int *meshCount, int **meshParts, std::atomic<float> *progress)
+{
+    *meshCount = 0;
+    int *parts = NULL;
+
+    std::vector<float> positions, texcoords, normals;
+    std::vector<ObjCorner> corners;
+    std::vector<ObjGroupStart> groups;
+
+    Mesh *meshes = NULL;
+
+    try
+    {
+        stl_reader::stl_reader_impl::MappedFile file;
+        if (!file.open(fileName))
+        {
+            TraceLog(LOG_WARNING, "[%s] OBJ file could not be opened", fileName);
+            if (progress != nullptr) *progress = 1.0f;
+            return NULL;
+        }
+
+        if (!ReadObjBuffer(file.data(), file.size(), positions, texcoords, normals, corners, groups))
+        {
+            TraceLog(LOG_WARNING, "[%s] OBJ file could not be read: malformed statement or index", fileName);
+        }
+        else if (corners.empty())
+        {
+            TraceLog(LOG_WARNING, "[%s] OBJ file has no faces", fileName);
+        }
+        else
+        {
+            file.close();
+            if (progress != nullptr) *progress = 0.5f;
+
+            meshes = GenMeshesOBJ(positions, texcoords, normals, corners, groups, meshCount, &parts);
+
+            if (progress != nullptr) *progress = 0.75f;
+            OptimizeMeshes(fileName, meshes, *meshCount);
+        }
+    }
+    catch (std::exception &e)
+    {
+        TraceLog(LOG_WARNING, "[%s] OBJ file could not be read: %s", fileName, e.what());
+    }
+
+    if (meshes != NULL)
+    {
+        TraceLog(LOG_INFO, "[%s] OBJ model loaded: %i positions, %i triangles, %i meshes", fileName,
+                 (int)(positions.size()/3), (int)(corners.size()/3), *meshCount);
+    }
+
+    if (progress != nullptr) *progress = 1.0f;
+
+    if (meshParts != NULL) *meshParts = parts;
+    else RL_FREE(parts);
+
+    return meshes;
+}
+
+// Free the CPU side of meshes that were never uploaded
+static void UnloadMeshesCPU(Mesh *meshes, int meshCount)
+{
+    for (int i = 0; i < meshCount; i++)
+    {
+        Mesh &mesh = meshes[i];
+        RL_FREE(mesh.vertices);
+        RL_FREE(mesh.normals);
+        RL_FREE(mesh.texcoords);
+        RL_FREE(mesh.indices);
+        RL_FREE(mesh.vboId);
+    }
+
+    RL_FREE(meshes);
+}
+
+// Distance of point p to triangle abc
+// NOTE: Regions of the closest point as in Ericson, Real-Time Collision Detection 5.1.5
+static float PointTriangleDistance(Vector3 p, Vector3 a, Vector3 b, Vector3 c)
+{
+    const Vector3 ab = Vector3Subtract(b, a);
+    const Vector3 ac = Vector3Subtract(c, a);
+    const Vector3 ap = Vector3Subtract(p, a);
+    const float d1 = Vector3DotProduct(ab, ap);
+    const float d2 = Vector3DotProduct(ac, ap);
+    if ((d1 <= 0.0f) && (d2 <= 0.0f)) return Vector3Distance(p, a);
+
+    const Vector3 bp = Vector3Subtract(p, b);
+    const float d3 = Vector3DotProduct(ab, bp);
+    const float d4 = Vector3DotProduct(ac, bp);
+    if ((d3 >= 0.0f) && (d4 <= d3)) return Vector3Distance(p, b);
+
+    const Vector3 cp = Vector3Subtract(p, c);
+    const float d5 = Vector3DotProduct(ab, cp);
+    const float d6 = Vector3DotProduct(ac, cp);
+    if ((d6 >= 0.0f) && (d5 <= d6)) return Vector3Distance(p, c);
+
+    const float vc = d1*d4 - d3*d2;
+    if ((vc <= 0.0f) && (d1 >= 0.0f) && (d3 <= 0.0f)) return Vector3Distance(p, Vector3Add(a, Vector3Scale(ab, d1/(d1 - d3))));
+
+    const float vb = d5*d2 - d1*d6;
+    if ((vb <= 0.0f) && (d2 >= 0.0f) && (d6 <= 0.0f)) return Vector3Distance(p, Vector3Add(a, Vector3Scale(ac, d2/(d2 - d6))));
+
+    const float va = d3*d6 - d5*d4;
+    if ((va <= 0.0f) && (d4 >= d3) && (d5 >= d6))
+        return Vector3Distance(p, Vector3Add(b, Vector3Scale(Vector3Subtract(c, b), (d4 - d3)/((d4 - d3) + (d5 - d6)))));
+
+    const float denom = va + vb + vc;
+    if (denom <= 0.0f) return Vector3Distance(p, a);     // Degenerate triangle
+
+    return Vector3Distance(p, Vector3Add(a, Vector3Add(Vector3Scale(ab, vb/denom), Vector3Scale(ac, vc/denom))));
+}
+
+// Error of a level: farthest any vertex of the full mesh is from the triangles around the vertex it was merged into
+// NOTE: Only a ring of the level is searched, so this bounds the distance to the level from above
+static float MeasureLODError(const std::vector<float> &fullCoords, const std::vector<int> &fullMap,
+                             const std::vector<float> &coords, const std::vector<unsigned int> &tris)
+{
+    const int vertexCount = (int)(coords.size()/3);
+
+    // Triangles around every vertex of the level
+    std::vector<int> ringStarts(vertexCount + 1, 0), rings(tris.size());
+    for (size_t i = 0; i < tris.size(); i++) ringStarts[tris[i] + 1]++;
+    for (int v = 0; v < vertexCount; v++) ringStarts[v + 1] += ringStarts[v];
+
+    std::vector<int> fill(ringStarts.begin(), ringStarts.end() - 1);
+    for (size_t i = 0; i < tris.size(); i++) rings[fill[tris[i]]++] = (int)(i/3);
+
+    auto position = [](const float *data, unsigned int v) { return Vector3{ data[v*3], data[v*3 + 1], data[v*3 + 2] }; };
+
+    float error = 0.0f;
+
+    for (size_t v = 0; v < fullMap.size(); v++)
+    {
+        const Vector3 p = position(fullCoords.data(), (unsigned int)v);
+        const int root = fullMap[v];
+
+        float distance = Vector3Distance(p, position(coords.data(), root));
+        for (int r = ringStarts[root]; r < ringStarts[root + 1]; r++)
+        {
+            const unsigned int *tri = &tris[rings[r]*3];
+            distance = std::min(distance, PointTriangleDistance(p, position(coords.data(), tri[0]),
+                                                                   position(coords.data(), tri[1]),
+                                                                   position(coords.data(), tri[2])));
+        }
+
+        error = std::max(error, distance);
+    }
+
+    return error;
+}
+
+// Nothing changed since the progressive mesh was uploaded
+static void ClearProgressiveMeshChanges(ProgressiveMesh &pmesh)
+{
+    pmesh.dirtyVertices[0] = pmesh.mesh.vertexCount;
+    pmesh.dirtyVertices[1] = -1;
+    pmesh.dirtyIndices[0] = pmesh.maxTriangleCount*3;
+    pmesh.dirtyIndices[1] = -1;
+}
+
+// Generation of levels was stopped, what is left of it is thrown away
+static bool LODsStopped(const std::atomic<bool> *stop)
+{
+    return (stop != nullptr) && stop->load(std::memory_order_relaxed);
+}
+
+// Generate the progressive mesh of welded points and triangles, decimated as far as the levels may go
+// NOTE: The collapses removing the most triangles come last, triangles are laid out for that: the ones no
+// collapse removes first, then the removed ones from the last collapse back to the first
+static void GenProgressiveMesh(const std::vector<MeshDecimation::Vec3<MeshDecimation::Float>> &points,
+                               const std::vector<MeshDecimation::Vec3<int>> &triangles, unsigned int threadCount,
+                               const std::atomic<bool> *stop, ProgressiveMesh &pmesh)
+{
+    using namespace MeshDecimation;
+
+    // The decimator moves and renumbers what it is given
+    std::vector<Vec3<Float>> decimatedPoints(points);
+    std::vector<Vec3<int>> decimatedTriangles(triangles);
+
+    MeshDecimator decimator;
+    decimator.SetEColBoundaryConstraint(true);
+    decimator.SetNThreads(threadCount);
+    decimator.SetVertexSplitRecording(true);
+    decimator.SetStopFlag(stop);
+    decimator.Initialize(decimatedPoints.size(), decimatedTriangles.size(), decimatedPoints.data(), decimatedTriangles.data());
+    decimator.Decimate(0, MESH_LOD_MIN_TRIANGLES, MESH_LOD_MAX_ERROR);
+
+    if ((decimator.GetNVertexSplits() == 0) || LODsStopped(stop)) return;
+
+    std::vector<MDVertexSplit> splits(decimator.GetNVertexSplits());
+    std::vector<int> removedTriangles(triangles.size() - decimator.GetNTriangles());
+    std::vector<int> movedCorners(decimator.GetNMovedCorners());
+    decimator.GetVertexSplits(splits.data(), removedTriangles.data(), movedCorners.data());
+
+    std::vector<int> slots(triangles.size(), 0);
+    for (size_t r = 0; r < removedTriangles.size(); r++) slots[removedTriangles[r]] = -1;
+
+    int slotCount = 0;
+    for (size_t t = 0; t < triangles.size(); t++)
+        if (slots[t] == 0) slots[t] = slotCount++;
+    for (size_t r = removedTriangles.size(); r-- > 0;) slots[removedTriangles[r]] = slotCount++;
+
+    Mesh &mesh = pmesh.mesh;
+    mesh.vertexCount = (int)points.size();
+    mesh.triangleCount = (int)triangles.size();
+    mesh.vertices = (float *)RL_MALLOC(mesh.vertexCount*3*sizeof(float));
+    mesh.normals = (float *)RL_MALLOC(mesh.vertexCount*3*sizeof(float));
+    mesh.indices = (unsigned short *)RL_MALLOC(mesh.triangleCount*3*sizeof(unsigned short));
+
+    for (int v = 0; v < mesh.vertexCount; v++)
+        for (int k = 0; k < 3; k++) mesh.vertices[v*3 + k] = points[v][k];
+
+    std::vector<unsigned int> tris(triangles.size()*3);
+    for (size_t t = 0; t < triangles.size(); t++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            tris[t*3 + k] = (unsigned int)triangles[t][k];
+            mesh.indices[slots[t]*3 + k] = (unsigned short)triangles[t][k];
+        }
+    }
+
+    GenMeshSmoothNormals(mesh.vertices, mesh.vertexCount, tris.data(), mesh.triangleCount, mesh.normals);
+
+    pmesh.maxTriangleCount = mesh.triangleCount;
+    pmesh.minTriangleCount = (int)decimator.GetNTriangles();
+    pmesh.splitCount = (int)splits.size();
+    pmesh.splits = (ProgressiveSplit *)RL_MALLOC(splits.size()*sizeof(ProgressiveSplit));
+    pmesh.corners = (unsigned int *)RL_MALLOC(movedCorners.size()*sizeof(unsigned int));
+
+    for (size_t i = 0; i < splits.size(); i++)
+    {
+        ProgressiveSplit &split = pmesh.splits[i];
+        split.position = Vector3{ splits[i].m_pos[0], splits[i].m_pos[1], splits[i].m_pos[2] };
+        split.splitPosition = Vector3{ splits[i].m_splitPos[0], splits[i].m_splitPos[1], splits[i].m_splitPos[2] };
+        split.v1 = (unsigned short)splits[i].m_v1;
+        split.v2 = (unsigned short)splits[i].m_v2;
+        split.triangleCount = (unsigned short)splits[i].m_nRemovedTriangles;
+        split.cornerCount = (unsigned short)splits[i].m_nMovedCorners;
+    }
+
+    for (size_t c = 0; c < movedCorners.size(); c++) pmesh.corners[c] = (unsigned int)(slots[movedCorners[c]/3]*3 + movedCorners[c]%3);
+
+    ClearProgressiveMeshChanges(pmesh);
+}
+
+// Generate the levels of one mesh, each one decimated from the one before
+// NOTE: Decimation needs the surface connected, so vertices split along creases are welded first and
+// the normals of every level are split along creases again. Boundaries are kept, texcoords are not
+static void GenMeshLODLevels(const Mesh &mesh, const MeshLODTarget *targets, int targetCount, unsigned int threadCount,
+                             const std::atomic<bool> *stop, std::vector<Mesh> &levels, std::vector<float> &errors,
+                             ProgressiveMesh *progressive)
+{
+    using namespace MeshDecimation;
+    using stl_reader::stl_reader_impl::CoordWithIndex;
+
+    if ((mesh.vertices == NULL) || (mesh.indices == NULL) || (mesh.triangleCount <= MESH_LOD_MIN_TRIANGLES)) return;
+    if (LODsStopped(stop)) return;
+
+    std::vector<float> coords;
+    std::vector<unsigned int> tris(mesh.indices, mesh.indices + mesh.triangleCount*3);
+    std::vector<CoordWithIndex<float, unsigned int>> coordsWithIndex(mesh.vertexCount);
+
+    for (int v = 0; v < mesh.vertexCount; v++)
+    {
+        for (int k = 0; k < 3; k++) coordsWithIndex[v][k] = mesh.vertices[v*3 + k];
+        coordsWithIndex[v].index = (unsigned int)v;
+    }
+
+    stl_reader::stl_reader_impl::RemoveDoubles(coords, tris, coordsWithIndex);
+
+    std::vector<Vec3<Float>> points(coords.size()/3);
+    for (size_t v = 0; v < points.size(); v++) points[v] = Vec3<Float>(coords[v*3], coords[v*3 + 1], coords[v*3 + 2]);
+
+    // Welding can make triangles of the chunk degenerate
+    std::vector<Vec3<int>> triangles;
+    triangles.reserve(mesh.triangleCount);
+    for (size_t t = 0; t < tris.size(); t += 3)
+    {
+        const int a = (int)tris[t], b = (int)tris[t + 1], c = (int)tris[t + 2];
+        if ((a != b) && (b != c) && (c != a)) triangles.push_back(Vec3<int>(a, b, c));
+    }
+
+    const size_t fullCount = triangles.size();
+    if (fullCount <= MESH_LOD_MIN_TRIANGLES) return;
+
+    if (progressive != NULL) GenProgressiveMesh(points, triangles, threadCount, stop, *progressive);
+
+    // Vertex of the current level every welded vertex of the full mesh was merged into
+    const std::vector<float> fullCoords = coords;
+    std::vector<int> fullMap(points.size());
+    for (size_t v = 0; v < fullMap.size(); v++) fullMap[v] = (int)v;
+    std::vector<int> levelMap;
+
+    for (int l = 0; l < targetCount; l++)
+    {
+        const size_t triangleTarget = std::max((size_t)(targets[l].triangleRatio*fullCount), (size_t)MESH_LOD_MIN_TRIANGLES);
+        if (triangleTarget >= triangles.size()) continue;
+
+        // Chunks of a part share their borders, which must stay in place to meet at any mix of levels
+        MeshDecimator decimator;
+        decimator.SetEColBoundaryConstraint(true);
+        decimator.SetNThreads(threadCount);
+        decimator.SetStopFlag(stop);
+        decimator.Initialize(points.size(), triangles.size(), points.data(), triangles.data());
+        decimator.Decimate(0, triangleTarget, targets[l].maxError);
+
+        if (LODsStopped(stop)) break;
+
+        // Levels the error target barely let shrink are not worth switching to
+        if (decimator.GetNTriangles()*10 > triangles.size()*9) break;
+
+        std::vector<Vec3<Float>> levelPoints(decimator.GetNVertices());
+        std::vector<Vec3<int>> levelTriangles(decimator.GetNTriangles());
+        decimator.GetMeshData(levelPoints.data(), levelTriangles.data());
+
+        levelMap.resize(points.size());
+        decimator.GetVertexMap(levelMap.data());
+        for (size_t v = 0; v < fullMap.size(); v++) fullMap[v] = levelMap[fullMap[v]];
+
+        points.swap(levelPoints);
+        triangles.swap(levelTriangles);
+
+        coords.resize(points.size()*3);
+        for (size_t v = 0; v < points.size(); v++)
+            for (int k = 0; k < 3; k++) coords[v*3 + k] = points[v][k];
+
+        tris.resize(triangles.size()*3);
+        for (size_t t = 0; t < triangles.size(); t++)
+            for (int k = 0; k < 3; k++) tris[t*3 + k] = (unsigned int)triangles[t][k];
+
+        const float error = MeasureLODError(fullCoords, fullMap, coords, tris);
+
+        // Split creases can not push a level past the vertices of its chunk in practice, stop if they do
+        int meshCount = 0;
+        Mesh *meshes = GenMeshesIndexed(coords.data(), (int)points.size(), tris.data(), (int)triangles.size(), &meshCount);
+        if (meshCount != 1)
+        {
+            UnloadMeshesCPU(meshes, meshCount);
+            break;
+        }
+
+        OptimizeMesh(&meshes[0]);
+        levels.push_back(meshes[0]);
+        errors.push_back(error);
+        RL_FREE(meshes);
+    }
+}
+
+// Gather the levels of every mesh into one ModelLODs, the levels are moved, not copied
+static ModelLODs CollectModelLODs(const std::vector<std::vector<Mesh>> &levels, const std::vector<std::vector<float>> &errors,
+                                  ProgressiveMesh *progressive)
+{
+    const int meshCount = (int)levels.size();
+
+    ModelLODs lods = { 0 };
+    lods.meshCount = meshCount;
+    lods.levelStarts = (int *)RL_CALLOC(meshCount + 1, sizeof(int));
+    lods.progressive = progressive;
+
+    for (int i = 0; i < meshCount; i++) lods.levelStarts[i + 1] = lods.levelStarts[i] + (int)levels[i].size();
+
+    const int levelCount = lods.levelStarts[meshCount];
+    lods.meshes = (Mesh *)RL_CALLOC(levelCount, sizeof(Mesh));
+    lods.errors = (float *)RL_CALLOC(levelCount, sizeof(float));
+    lods.bounds = (BoundingBox *)RL_CALLOC(levelCount, sizeof(BoundingBox));
+
+    for (int i = 0; i < meshCount; i++)
+    {
+        for (size_t l = 0; l < levels[i].size(); l++)
+        {
+            const int level = lods.levelStarts[i] + (int)l;
+            lods.meshes[level] = levels[i][l];
+            lods.errors[level] = errors[i][l];
+            lods.bounds[level] = MeshBoundingBox(levels[i][l]);
+        }
+    }
+
+    return lods;
+}
+
+#if !defined(MESH_IMPORT_NO_CACHE)
+// Hash of everything levels are generated from: positions and indices of the meshes, the targets and limits
+// NOTE: Normals and texcoords of the meshes are not read by decimation, they are left out
+static uint64_t HashModelLODsInput(const Mesh *meshes, int meshCount, const MeshLODTarget *targets, int targetCount, bool progressive)
+{
+    const float limits[3] = { MESH_LOD_MAX_ERROR, (float)MESH_LOD_MIN_TRIANGLES, progressive? 1.0f : 0.0f };
+
+    uint64_t hash = HashBytes((const char *)limits, sizeof(limits), (uint64_t)meshCount);
+    if (targetCount > 0) hash = HashBytes((const char *)targets, targetCount*sizeof(MeshLODTarget), hash);
+
+    for (int i = 0; i < meshCount; i++)
+    {
+        const int counts[2] = { meshes[i].vertexCount, meshes[i].triangleCount };
+        hash = HashBytes((const char *)counts, sizeof(counts), hash);
+        if (meshes[i].vertices != NULL) hash = HashBytes((const char *)meshes[i].vertices, meshes[i].vertexCount*3*sizeof(float), hash);
+        if (meshes[i].indices != NULL) hash = HashBytes((const char *)meshes[i].indices, meshes[i].triangleCount*3*sizeof(unsigned short), hash);
+    }
+
+    return hash;
+}
+
+static std::string ModelLODsCacheFileName(uint64_t inputHash)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.lods", (unsigned long long)inputHash);
+    return std::string(MESH_CACHE_DIRECTORY) + "/" + name;
+}
+
+// Read the levels and progressive meshes following the header of a levels cache file
+// NOTE: Returns false if the file ends early or refers to vertices, indices or triangles it does not have,
+// whatever was read is left in levels and progressive to be freed. Collapses write through the stored corners
+// and split vertices, so they are checked like the indices
+static bool ReadModelLODsCache(const char *data, size_t size, int meshCount, std::vector<std::vector<Mesh>> &levels,
+                               std::vector<std::vector<float>> &errors, ProgressiveMesh *progressive)
+{
+    size_t offset = sizeof(ModelLODsCacheHeader);
+
+    // Next array of the file, NULL past its end
+    const auto take = [&](uint64_t bytes) -> const char *
+    {
+        if (bytes > size - offset) return NULL;
+        const char *array = data + offset;
+        offset = std::min((size_t)((offset + bytes + 3) & ~(uint64_t)3), size);
+        return array;
+    };
+
+    // Copy of an array of the file, NULL past its end
+    const auto copy = [&](uint64_t bytes, void **array) -> bool
+    {
+        const char *source = take(bytes);
+        if (source == NULL) return false;
+        *array = RL_MALLOC(bytes);
+        memcpy(*array, source, bytes);
+        return true;
+    };
+
+    for (int i = 0; i < meshCount; i++)
+    {
+        const char *levelCount = take(sizeof(uint32_t));
+        if (levelCount == NULL) return false;
+
+        uint32_t count;
+        memcpy(&count, levelCount, sizeof(count));
+
+        for (uint32_t l = 0; l < count; l++)
+        {
+            const char *record = take(sizeof(ModelLODsCacheLevel));
+            if (record == NULL) return false;
+
+            ModelLODsCacheLevel level;
+            memcpy(&level, record, sizeof(level));
+            if ((level.vertexCount > MAX_MESH_INDEXED_VERTICES) || (level.triangleCount > INT_MAX/3)) return false;
+
+            Mesh mesh = { 0 };
+            mesh.vboId = (unsigned int *)RL_CALLOC(MAX_MESH_VBO, sizeof(unsigned int));
+            mesh.vertexCount = (int)level.vertexCount;
+            mesh.triangleCount = (int)level.triangleCount;
+            levels[i].push_back(mesh);
+            errors[i].push_back(level.error);
+
+            Mesh &stored = levels[i].back();
+            if (!copy((uint64_t)level.vertexCount*3*sizeof(float), (void **)&stored.vertices) ||
+                !copy((uint64_t)level.vertexCount*3*sizeof(float), (void **)&stored.normals) ||
+                !copy((uint64_t)level.triangleCount*3*sizeof(unsigned short), (void **)&stored.indices)) return false;
+
+            if (!MeshIndicesInRange(stored.indices, (size_t)level.triangleCount*3, level.vertexCount)) return false;
+        }
+
+        if (progressive == NULL) continue;
+
+        const char *record = take(sizeof(ModelLODsCacheProgressive));
+        if (record == NULL) return false;
+
+        ModelLODsCacheProgressive entry;
+        memcpy(&entry, record, sizeof(entry));
+        if (entry.splitCount == 0) continue;
+        if ((entry.vertexCount > MAX_MESH_INDEXED_VERTICES) || (entry.maxTriangleCount > INT_MAX/3) ||
+            (entry.minTriangleCount > entry.maxTriangleCount)) return false;
+
+        ProgressiveMesh &pmesh = progressive[i];
+        pmesh.mesh.vertexCount = (int)entry.vertexCount;
+        pmesh.mesh.triangleCount = (int)entry.maxTriangleCount;
+        pmesh.maxTriangleCount = (int)entry.maxTriangleCount;
+        pmesh.minTriangleCount = (int)entry.minTriangleCount;
+
+        if (!copy((uint64_t)entry.vertexCount*3*sizeof(float), (void **)&pmesh.mesh.vertices) ||
+            !copy((uint64_t)entry.vertexCount*3*sizeof(float), (void **)&pmesh.mesh.normals) ||
+            !copy((uint64_t)entry.maxTriangleCount*3*sizeof(unsigned short), (void **)&pmesh.mesh.indices) ||
+            !copy((uint64_t)entry.splitCount*sizeof(ProgressiveSplit), (void **)&pmesh.splits) ||
+            !copy((uint64_t)entry.cornerCount*sizeof(unsigned int), (void **)&pmesh.corners)) return false;
+
+        pmesh.splitCount = (int)entry.splitCount;
+
+        if (!MeshIndicesInRange(pmesh.mesh.indices, (size_t)entry.maxTriangleCount*3, entry.vertexCount)) return false;
+
+        // Collapses walk the corners and triangles by the counts of the splits, they must add up
+        uint64_t cornerCount = 0, triangleCount = 0;
+        for (int k = 0; k < pmesh.splitCount; k++)
+        {
+            const ProgressiveSplit &split = pmesh.splits[k];
+            if ((split.v1 >= entry.vertexCount) || (split.v2 >= entry.vertexCount)) return false;
+
+            cornerCount += split.cornerCount;
+            triangleCount += split.triangleCount;
+        }
+
+        if ((cornerCount != entry.cornerCount) || (triangleCount != entry.maxTriangleCount - entry.minTriangleCount)) return false;
+
+        for (uint32_t c = 0; c < entry.cornerCount; c++)
+            if (pmesh.corners[c] >= entry.maxTriangleCount*3) return false;
+
+        ClearProgressiveMeshChanges(pmesh);
+    }
+
+    return true;
+}
+
+// Load levels from a cache file, levelStarts is NULL if there is no valid cache for the input
+static ModelLODs LoadModelLODsCache(const char *cacheFile, uint64_t inputHash, int meshCount, bool progressive)
+{
+    ModelLODs lods = { 0 };
+
+    stl_reader::stl_reader_impl::MappedFile file;
+    if (!file.open(cacheFile) || (file.size() < sizeof(ModelLODsCacheHeader))) return lods;
+
+    ModelLODsCacheHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+
+    if ((memcmp(header.magic, "LODCACHE", 8) != 0) || (header.version != MESH_CACHE_VERSION) ||
+        (header.inputHash != inputHash) || (header.meshCount != (uint32_t)meshCount) ||
+        (header.progressive != (progressive? 1u : 0u))) return lods;
+
+    std::vector<std::vector<Mesh>> levels(meshCount);
+    std::vector<std::vector<float>> errors(meshCount);
+    ProgressiveMesh *progressiveMeshes = progressive? (ProgressiveMesh *)RL_CALLOC(meshCount, sizeof(ProgressiveMesh)) : NULL;
+
+    if (ReadModelLODsCache(file.data(), file.size(), meshCount, levels, errors, progressiveMeshes))
+        return CollectModelLODs(levels, errors, progressiveMeshes);
+
+    for (int i = 0; i < meshCount; i++)
+    {
+        for (Mesh &mesh : levels[i])
+        {
+            RL_FREE(mesh.vertices);
+            RL_FREE(mesh.normals);
+            RL_FREE(mesh.indices);
+            RL_FREE(mesh.vboId);
+        }
+
+        if (progressiveMeshes == NULL) continue;
+        RL_FREE(progressiveMeshes[i].mesh.vertices);
+        RL_FREE(progressiveMeshes[i].mesh.normals);
+        RL_FREE(progressiveMeshes[i].mesh.indices);
+        RL_FREE(progressiveMeshes[i].splits);
+        RL_FREE(progressiveMeshes[i].corners);
+    }
+
+    RL_FREE(progressiveMeshes);
+
+    return lods;
+}
+
+// Write levels that were not uploaded yet to a cache file
+static void SaveModelLODsCache(const char *cacheFile, uint64_t inputHash, const ModelLODs &lods)
+{
+    std::vector<char> buffer;
+
+    const auto put = [&](const void *array, size_t bytes)
+    {
+        const size_t offset = buffer.size();
+        buffer.resize((offset + bytes + 3) & ~(size_t)3, 0);
+        if (bytes > 0) memcpy(buffer.data() + offset, array, bytes);
+    };
+
+    ModelLODsCacheHeader header = { 0 };
+    memcpy(header.magic, "LODCACHE", 8);
+    header.version = MESH_CACHE_VERSION;
+    header.meshCount = (uint32_t)lods.meshCount;
+    header.inputHash = inputHash;
+    header.progressive = (lods.progressive != NULL)? 1 : 0;
+    put(&header, sizeof(header));
+
+    for (int i = 0; i < lods.meshCount; i++)
+    {
+        const uint32_t levelCount = (uint32_t)(lods.levelStarts[i + 1] - lods.levelStarts[i]);
+        put(&levelCount, sizeof(levelCount));
+
+        for (int l = lods.levelStarts[i]; l < lods.levelStarts[i + 1]; l++)
+        {
+            const Mesh &mesh = lods.meshes[l];
+            const ModelLODsCacheLevel level = { (uint32_t)mesh.vertexCount, (uint32_t)mesh.triangleCount, lods.errors[l], 0 };
+            put(&level, sizeof(level));
+            put(mesh.vertices, mesh.vertexCount*3*sizeof(float));
+            put(mesh.normals, mesh.vertexCount*3*sizeof(float));
+            put(mesh.indices, mesh.triangleCount*3*sizeof(unsigned short));
+        }
+
+        if (lods.progressive == NULL) continue;
+
+        const ProgressiveMesh &pmesh = lods.progressive[i];
+        ModelLODsCacheProgressive entry = { 0 };
+        entry.splitCount = (uint32_t)pmesh.splitCount;
+
+        for (int k = 0; k < pmesh.splitCount; k++) entry.cornerCount += pmesh.splits[k].cornerCount;
+
+        if (pmesh.splitCount > 0)
+        {
+            entry.vertexCount = (uint32_t)pmesh.mesh.vertexCount;
+            entry.maxTriangleCount = (uint32_t)pmesh.maxTriangleCount;
+            entry.minTriangleCount = (uint32_t)pmesh.minTriangleCount;
+        }
+
+        put(&entry, sizeof(entry));
+        if (pmesh.splitCount == 0) continue;
+
+        put(pmesh.mesh.vertices, pmesh.mesh.vertexCount*3*sizeof(float));
+        put(pmesh.mesh.normals, pmesh.mesh.vertexCount*3*sizeof(float));
+        put(pmesh.mesh.indices, pmesh.maxTriangleCount*3*sizeof(unsigned short));
+        put(pmesh.splits, pmesh.splitCount*sizeof(ProgressiveSplit));
+        put(pmesh.corners, entry.cornerCount*sizeof(unsigned int));
+    }
+
+    WriteCacheFile(cacheFile, buffer);
+}
+#endif // MESH_IMPORT_NO_CACHE
+
+// Generate simplified levels of all meshes (CPU only), in parallel
+// NOTE: Levels of a mesh end early once it has MESH_LOD_MIN_TRIANGLES or less, or once a target does not
+// shrink it noticeably. Level errors accumulate over the chain, so they only ever grow. Once stop is set,
+// the meshes left get fewer levels or none, and nothing is cached
+ModelLODs GenModelLODs(const Mesh *meshes, int meshCount, const MeshLODTarget *targets, int targetCount, bool progressive,
+                       const std::atomic<bool> *stop)
+{
+#if !defined(MESH_IMPORT_NO_CACHE)
+    const uint64_t inputHash = HashModelLODsInput(meshes, meshCount, targets, targetCount, progressive);
+    const std::string cacheFile = ModelLODsCacheFileName(inputHash);
+
+    ModelLODs cached = LoadModelLODsCache(cacheFile.c_str(), inputHash, meshCount, progressive);
+    if (cached.levelStarts != NULL)
+    {
+        TraceLog(LOG_INFO, "MODEL: Levels of detail loaded from cache %s", cacheFile.c_str());
+        return cached;
+    }
+#endif
+
+    std::vector<std::vector<Mesh>> levels(meshCount);
+    std::vector<std::vector<float>> errors(meshCount);
+    ProgressiveMesh *progressiveMeshes = progressive? (ProgressiveMesh *)RL_CALLOC(meshCount, sizeof(ProgressiveMesh)) : NULL;
+
+    // Threads left over by models of few meshes decimate partitions of a mesh
+    const unsigned int threadCount = std::max(std::thread::hardware_concurrency()/std::max(meshCount, 1), 1u);
+
+    stl_reader::stl_reader_impl::ParallelFor(meshCount, 0, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) GenMeshLODLevels(meshes[i], targets, targetCount, threadCount, stop, levels[i], errors[i],
+                                                      progressive? &progressiveMeshes[i] : NULL);
+    }, 1);
+
+    ModelLODs lods = CollectModelLODs(levels, errors, progressiveMeshes);
+
+#if !defined(MESH_IMPORT_NO_CACHE)
+    if (!LODsStopped(stop)) SaveModelLODsCache(cacheFile.c_str(), inputHash, lods);
+#endif
+
+    return lods;
+}
+
+// Upload all levels to GPU, like the meshes of the model
+void UploadModelLODs(ModelLODs *lods, bool compact)
+{
+    for (int i = 0; i < lods->levelStarts[lods->meshCount]; i++)
+    {
+        if (compact) UploadMeshCompact(&lods->meshes[i]);
+        else rlLoadMesh(&lods->meshes[i], false);
+    }
+
+    // Progressive meshes move their vertices, they are never compact. The index buffer has room for the full mesh
+    for (int i = 0; (lods->progressive != NULL) && (i < lods->meshCount); i++)
+    {
+        ProgressiveMesh &pmesh = lods->progressive[i];
+        if (pmesh.splitCount == 0) continue;
+
+        const int triangleCount = pmesh.mesh.triangleCount;
+        pmesh.mesh.triangleCount = pmesh.maxTriangleCount;
+        rlLoadMesh(&pmesh.mesh, true);
+        pmesh.mesh.triangleCount = triangleCount;
+        ClearProgressiveMeshChanges(pmesh);
+    }
+}
+
+// Free the levels of an import that were never uploaded
+static void UnloadModelLODsCPU(ModelLODs lods)
+{
+    if (lods.levelStarts == NULL) return;
+
+    UnloadMeshesCPU(lods.meshes, lods.levelStarts[lods.meshCount]);
+
+    for (int i = 0; (lods.progressive != NULL) && (i < lods.meshCount); i++)
+    {
+        RL_FREE(lods.progressive[i].mesh.vertices);
+        RL_FREE(lods.progressive[i].mesh.normals);
+        RL_FREE(lods.progressive[i].mesh.indices);
+        RL_FREE(lods.progressive[i].splits);
+        RL_FREE(lods.progressive[i].corners);
+    }
+
+    RL_FREE(lods.levelStarts);
+    RL_FREE(lods.errors);
+    RL_FREE(lods.bounds);
+    RL_FREE(lods.progressive);
+}
+
+// Unload all levels from memory (RAM and/or VRAM)
+void UnloadModelLODs(ModelLODs lods)
+{
+    if (lods.levelStarts == NULL) return;
+
+    for (int i = 0; i < lods.levelStarts[lods.meshCount]; i++) UnloadMesh(lods.meshes[i]);
+
+    for (int i = 0; (lods.progressive != NULL) && (i < lods.meshCount); i++)
+    {
+        if (lods.progressive[i].splitCount > 0) UnloadMesh(lods.progressive[i].mesh);
+        RL_FREE(lods.progressive[i].splits);
+        RL_FREE(lods.progressive[i].corners);
+    }
+
+    RL_FREE(lods.meshes);
+    RL_FREE(lods.levelStarts);
+    RL_FREE(lods.errors);
+    RL_FREE(lods.bounds);
+    RL_FREE(lods.progressive);
+}
+
+// Start generating levels of all meshes on a worker thread
+// NOTE: The meshes are only read, but must stay loaded until the job is taken. Without targets,
+// MESH_LOD_LEVELS levels keep MESH_LOD_TRIANGLE_RATIO of the triangles of the level above each
+ModelLODsJob *GenModelLODsAsync(const Mesh *meshes, int meshCount, const MeshLODTarget *targets, int targetCount, bool progressive)
+{
+    std::vector<MeshLODTarget> levels(targets, targets + ((targets != nullptr)? targetCount : 0));
+
+    float ratio = 1.0f;
+    for (int l = 0; (targets == nullptr) && (l < MESH_LOD_LEVELS); l++)
+    {
+        ratio *= MESH_LOD_TRIANGLE_RATIO;
+        levels.push_back({ ratio, MESH_LOD_MAX_ERROR });
+    }
+
+    ModelLODsJob *job = new ModelLODsJob();
+
+    job->worker = std::thread([job, meshes, meshCount, levels, progressive]()
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        job->lods = GenModelLODs(meshes, meshCount, levels.data(), (int)levels.size(), progressive, &job->stop);
+
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        TraceLog(LOG_INFO, "MODEL: %i levels of detail generated for %i meshes in %.1f ms",
+                 job->lods.levelStarts[meshCount], meshCount, ms);
+
+        job->done.store(true, std::memory_order_release);
+    });
+
+    return job;
+}
+
+// Upload the levels of a finished job and free it (main thread only)
+// NOTE: Returns false and leaves the job alone while it is still running
+bool LoadModelLODsFromJob(ModelLODsJob *job, ModelLODs *lods, bool compact)
+{
+    if (!job->done.load(std::memory_order_acquire)) return false;
+
+    job->worker.join();
+    UploadModelLODs(&job->lods, compact);
+    *lods = job->lods;
+    delete job;
+
+    return true;
+}
+
+// Stop a job, wait for it and free it without uploading
+// NOTE: Decimation checks the stop flag between collapses, so this only waits for the step of a level running
+void UnloadModelLODsJob(ModelLODsJob *job)
+{
+    job->stop.store(true, std::memory_order_relaxed);
+    if (job->worker.joinable()) job->worker.join();
+
+    UnloadModelLODsCPU(job->lods);
+    delete job;
+}
+
+// Get level to draw a mesh with: 0 is the full mesh, level l is lods.meshes[lods.levelStarts[mesh] + l - 1]
+// NOTE: pixelsPerUnit is the screen size of an object space unit at the mesh. Starting from the level of the
+// last frame, a finer level is taken as soon as the error shows, a coarser one only well below that
+int GetMeshLOD(ModelLODs lods, int mesh, float pixelsPerUnit, int current)
+{
+    if ((lods.levelStarts == NULL) || (mesh < 0) || (mesh >= lods.meshCount)) return 0;
+
+    const float *errors = &lods.errors[lods.levelStarts[mesh]];
+    const int levelCount = lods.levelStarts[mesh + 1] - lods.levelStarts[mesh];
+
+    int level = std::min(std::max(current, 0), levelCount);
+
+    while ((level > 0) && (errors[level - 1]*pixelsPerUnit > MESH_LOD_PIXEL_ERROR)) level--;
+    while ((level < levelCount) && (errors[level]*pixelsPerUnit <= MESH_LOD_PIXEL_ERROR*MESH_LOD_HYSTERESIS)) level++;
+
+    return level;
+}
+
+// Move a vertex of a progressive mesh, it is uploaded with the next UpdateProgressiveMesh()
+static void SetProgressiveVertex(ProgressiveMesh *pmesh, int vertex, Vector3 position)
+{
+    float *v = &pmesh->mesh.vertices[vertex*3];
+    v[0] = position.x;
+    v[1] = position.y;
+    v[2] = position.z;
+
+    pmesh->dirtyVertices[0] = std::min(pmesh->dirtyVertices[0], vertex);
+    pmesh->dirtyVertices[1] = std::max(pmesh->dirtyVertices[1], vertex);
+}
+
+// Set an index of a progressive mesh, it is uploaded with the next UpdateProgressiveMesh()
+static void SetProgressiveIndex(ProgressiveMesh *pmesh, int index, unsigned short vertex)
+{
+    pmesh->mesh.indices[index] = vertex;
+
+    pmesh->dirtyIndices[0] = std::min(pmesh->dirtyIndices[0], index);
+    pmesh->dirtyIndices[1] = std::max(pmesh->dirtyIndices[1], index);
+}
+
+// Collapse or split a progressive mesh until it has the most triangles that fit triangleCount
+// NOTE: Takes time in proportion to the collapses walked, not to the mesh, so it can run every frame.
+// Below minTriangleCount the mesh stays at it
+void SetProgressiveMeshTriangles(ProgressiveMesh *pmesh, int triangleCount)
+{
+    Mesh &mesh = pmesh->mesh;
+
+    while ((pmesh->splitsApplied < pmesh->splitCount) && (mesh.triangleCount > triangleCount))
+    {
+        const ProgressiveSplit &split = pmesh->splits[pmesh->splitsApplied++];
+
+        for (int c = 0; c < split.cornerCount; c++) SetProgressiveIndex(pmesh, pmesh->corners[pmesh->cornersApplied++], split.v1);
+        SetProgressiveVertex(pmesh, split.v1, split.position);
+        mesh.triangleCount -= split.triangleCount;
+    }
+
+    while ((pmesh->splitsApplied > 0) && (mesh.triangleCount + pmesh->splits[pmesh->splitsApplied - 1].triangleCount <= triangleCount))
+    {
+        const ProgressiveSplit &split = pmesh->splits[--pmesh->splitsApplied];
+
+        pmesh->cornersApplied -= split.cornerCount;
+        for (int c = 0; c < split.cornerCount; c++) SetProgressiveIndex(pmesh, pmesh->corners[pmesh->cornersApplied + c], split.v2);
+        SetProgressiveVertex(pmesh, split.v1, split.splitPosition);
+        mesh.triangleCount += split.triangleCount;
+    }
+}
+
+// Upload the vertices and indices of a progressive mesh changed since the last upload (main thread only)
+// NOTE: Only the range between the first and the last change is sent. Triangles a collapse removes are not
+// drawn anymore but keep their indices, splitting brings them back without an upload
+void UpdateProgressiveMesh(ProgressiveMesh *pmesh)
+{
+    const Mesh &mesh = pmesh->mesh;
+    if (mesh.vaoId == 0) return;
+
+#if defined(GRAPHICS_API_OPENGL_33)
+    glBindVertexArray(mesh.vaoId);
+
+    if (pmesh->dirtyVertices[0] <= pmesh->dirtyVertices[1])
+    {
+        const int first = pmesh->dirtyVertices[0];
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vboId[0]);
+        glBufferSubData(GL_ARRAY_BUFFER, first*3*sizeof(float), (pmesh->dirtyVertices[1] - first + 1)*3*sizeof(float), &mesh.vertices[first*3]);
+    }
+
+    // The index buffer binding is part of the vertex array bound above
+    if (pmesh->dirtyIndices[0] <= pmesh->dirtyIndices[1])
+    {
+        const int first = pmesh->dirtyIndices[0];
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vboId[6]);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, first*sizeof(unsigned short), (pmesh->dirtyIndices[1] - first + 1)*sizeof(unsigned short), &mesh.indices[first]);
+    }
+
+    glBindVertexArray(0);
+#else
+    // Whole buffers, rlgl has no partial updates
+    if (pmesh->dirtyVertices[0] <= pmesh->dirtyVertices[1]) rlUpdateMesh(mesh, 0, mesh.vertexCount);
+    if (pmesh->dirtyIndices[0] <= pmesh->dirtyIndices[1]) rlUpdateBuffer(mesh.vboId[6], mesh.indices, pmesh->maxTriangleCount*3*sizeof(unsigned short));
+#endif
+
+    ClearProgressiveMeshChanges(*pmesh);
+}
+
+// Set up a clustering grid over box, gridSize cells along its longest side
+static void InitPreviewGrid(PreviewGrid &grid, BoundingBox box, int gridSize)
+{
+    const float extent[3] = { box.max.x - box.min.x, box.max.y - box.min.y, box.max.z - box.min.z };
+    float longest = std::max(extent[0], std::max(extent[1], extent[2]));
+    if (longest <= 0.0f) longest = 1.0f;
+
+    grid.origin[0] = box.min.x;
+    grid.origin[1] = box.min.y;
+    grid.origin[2] = box.min.z;
+    grid.invCellSize = gridSize/longest;
+
+    for (int i = 0; i < 3; i++) grid.size[i] = std::min(std::max((int)ceilf(extent[i]*grid.invCellSize), 1), gridSize);
+
+    grid.cellVertex.assign((size_t)grid.size[0]*grid.size[1]*grid.size[2], -1);
+    grid.cells.clear();
+    grid.positions.clear();
+    grid.normals.clear();
+    grid.counts.clear();
+}
+
+// Cluster a corner into its cell, corners outside the box go to the border cells
+static void AddPreviewCorner(PreviewGrid &grid, const float *p, const float *normal)
+{
+    int cell[3];
+    for (int i = 0; i < 3; i++) cell[i] = std::min(std::max((int)((p[i] - grid.origin[i])*grid.invCellSize), 0), grid.size[i] - 1);
+
+    const int index = (cell[2]*grid.size[1] + cell[1])*grid.size[0] + cell[0];
+    int &vertex = grid.cellVertex[index];
+    if (vertex < 0)
+    {
+        vertex = (int)grid.counts.size();
+        grid.cells.push_back(index);
+        grid.counts.push_back(0);
+        grid.positions.insert(grid.positions.end(), 3, 0.0f);
+        grid.normals.insert(grid.normals.end(), 3, 0.0f);
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        grid.positions[vertex*3 + i] += p[i];
+        grid.normals[vertex*3 + i] += normal[i];
+    }
+    grid.counts[vertex]++;
+}
+
+// Cluster the corners of a sampled triangle along with its area weighted normal
+static void AddPreviewTriangle(PreviewGrid &grid, const float *corners)
+{
+    const float *a = &corners[0], *b = &corners[3], *c = &corners[6];
+    const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    const float n[3] = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+
+    for (int i = 0; i < 3; i++) AddPreviewCorner(grid, &corners[i*3], n);
+}
+
+// Emit a triangle of cell vertices, wound to face along their normals
+static void AddPreviewFace(const PreviewGrid &grid, const float *vertices, int a, int b, int c, std::vector<unsigned short> &indices)
+{
+    const float *pa = &vertices[a*3], *pb = &vertices[b*3], *pc = &vertices[c*3];
+    const float e1[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+    const float e2[3] = { pc[0] - pa[0], pc[1] - pa[1], pc[2] - pa[2] };
+    const float n[3] = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+
+    float dot = 0.0f;
+    for (int i = 0; i < 3; i++) dot += n[i]*(grid.normals[a*3 + i] + grid.normals[b*3 + i] + grid.normals[c*3 + i]);
+
+    indices.push_back((unsigned short)a);
+    indices.push_back((unsigned short)((dot < 0.0f)? c : b));
+    indices.push_back((unsigned short)((dot < 0.0f)? b : c));
+}
+
+// Generate the preview mesh (CPU only): a vertex at the mean of the corners in every occupied cell,
+// squares of four occupied neighbour cells along any axis plane become two triangles, three of them one
+// NOTE: Sampled triangles are far smaller than cells, so faces connect cells instead of clustering them
+static Mesh *GenPreviewMesh(const PreviewGrid &grid)
+{
+    const int vertexCount = (int)grid.counts.size();
+
+    std::vector<float> vertices(vertexCount*3);
+    for (int v = 0; v < vertexCount; v++)
+        for (int i = 0; i < 3; i++) vertices[v*3 + i] = grid.positions[v*3 + i]/grid.counts[v];
+
+    // Each square is emitted from the first of its occupied cells
+    const int stride[3] = { 1, grid.size[0], grid.size[0]*grid.size[1] };
+    std::vector<unsigned short> indices;
+
+    for (int v = 0; v < vertexCount; v++)
+    {
+        const int cell = grid.cells[v];
+        const int coord[3] = { cell%grid.size[0], (cell/grid.size[0])%grid.size[1], cell/stride[2] };
+
+        for (int plane = 0; plane < 3; plane++)
+        {
+            const int u = (plane + 1)%3, w = (plane + 2)%3;
+
+            for (int corner = 0; corner < 4; corner++)
+            {
+                // Square whose corner this cell is, corners counted around it
+                const int su = coord[u] - (((corner == 1) || (corner == 2))? 1 : 0);
+                const int sw = coord[w] - ((corner >= 2)? 1 : 0);
+                if ((su < 0) || (sw < 0) || (su + 1 >= grid.size[u]) || (sw + 1 >= grid.size[w])) continue;
+
+                int square[4];
+                int occupied = 0;
+                int first = -1;
+                for (int k = 0; k < 4; k++)
+                {
+                    const int cu = su + (((k == 1) || (k == 2))? 1 : 0);
+                    const int cw = sw + ((k >= 2)? 1 : 0);
+                    square[k] = grid.cellVertex[cell + (cu - coord[u])*stride[u] + (cw - coord[w])*stride[w]];
+                    if (square[k] >= 0)
+                    {
+                        occupied++;
+                        if (first < 0) first = k;
+                    }
+                }
+
+                if ((occupied < 3) || (square[first] != v)) continue;
+
+                if (occupied == 4)
+                {
+                    AddPreviewFace(grid, vertices.data(), square[0], square[1], square[2], indices);
+                    AddPreviewFace(grid, vertices.data(), square[0], square[2], square[3], indices);
+                }
+                else
+                {
+                    int tri[3], n = 0;
+                    for (int k = 0; k < 4; k++) if (square[k] >= 0) tri[n++] = square[k];
+                    AddPreviewFace(grid, vertices.data(), tri[0], tri[1], tri[2], indices);
+                }
+            }
+        }
+    }
+
+    Mesh *mesh = (Mesh *)RL_CALLOC(1, sizeof(Mesh));
+    mesh->vertexCount = vertexCount;
+    mesh->triangleCount = (int)indices.size()/3;
+    mesh->vboId = (unsigned int *)RL_CALLOC(MAX_MESH_VBO, sizeof(unsigned int));
+    mesh->vertices = (float *)RL_MALLOC(vertexCount*3*sizeof(float));
+    mesh->normals = (float *)RL_MALLOC(vertexCount*3*sizeof(float));
+    mesh->indices = (unsigned short *)RL_MALLOC(indices.size()*sizeof(unsigned short));
+
+    if (vertexCount > 0) memcpy(mesh->vertices, vertices.data(), vertices.size()*sizeof(float));
+    for (int v = 0; v < vertexCount; v++) NormalizeNormal(&grid.normals[v*3], &mesh->normals[v*3]);
+    if (!indices.empty()) memcpy(mesh->indices, indices.data(), indices.size()*sizeof(unsigned short));
+
+    return mesh;
+}
+
+// Read the triangle of an ascii stl facet, its lines start at facet
+static bool ReadPreviewFacetSTL(const char *facet, const char *end, float *corners)
+{
+    using namespace stl_reader::stl_reader_impl;
+
+    // facet, outer loop, 3 vertices, endloop, endfacet
+    const char *facetEnd = facet;
+    for (int i = 0; i < 7 && facetEnd < end; i++) facetEnd = LineEnd(facetEnd, end) + 1;
+
+    AsciiChunk<float, unsigned int> chunk;
+    ParseAsciiRange(facet, std::min(facetEnd, end), chunk);
+    if ((chunk.errorPos != NULL) || (chunk.tris.size() != 3)) return false;
+
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) corners[i*3 + j] = chunk.coords[chunk.tris[i]][j];
+
+    return true;
+}
+
+// Visit sampleCount triangles spread evenly over the stl data, all of them if there are fewer
+// NOTE: Samples grow the box and are clustered into grid, if given. Returns true if every triangle
+// of the file was visited, stops early when stop is set
+static bool SamplePreviewTrianglesSTL(const char *data, size_t size, bool ascii, size_t sampleCount,
+                                      PreviewGrid *grid, BoundingBox &box, const std::atomic<bool> &stop)
+{
+    using namespace stl_reader::stl_reader_impl;
+
+    size_t triangleCount = 0;
+    if (!ascii && !BinaryTriangleCount(data, size, triangleCount)) return true;
+    if (!ascii) triangleCount = std::min(triangleCount, (size - BINARY_HEADER_SIZE)/BINARY_TRI_SIZE);
+
+    // An ascii facet takes about 250 bytes
+    const size_t available = ascii ? size/250 + 1 : triangleCount;
+    const size_t count = std::min(sampleCount, available);
+
+    const char *end = data + size;
+    const char *lastFacet = NULL;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (((i & 0xFFFF) == 0) && stop) return false;
+
+        float corners[9];
+        if (ascii)
+        {
+            const char *facet = FindFacetLine(data, data + i*(size/count), end);
+            if ((facet == end) || (facet == lastFacet) || !ReadPreviewFacetSTL(facet, end, corners)) continue;
+            lastFacet = facet;
+        }
+        else memcpy(corners, data + BINARY_HEADER_SIZE + (i*triangleCount/count)*BINARY_TRI_SIZE + 12, sizeof(corners));
+
+        for (int c = 0; c < 3; c++)
+        {
+            const Vector3 p = { corners[c*3], corners[c*3 + 1], corners[c*3 + 2] };
+            box.min = Vector3Min(box.min, p);
+            box.max = Vector3Max(box.max, p);
+        }
+
+        if (grid != NULL) AddPreviewTriangle(*grid, corners);
+    }
+
+    return count == available;
+}
+
+// Publish previews from growing samples of the file, until the import finished
+// NOTE: Each pass clusters four times the samples on a grid fine enough for them to still occupy
+// neighbour cells, spanning the box the previous samples covered. Compressed files get no preview
+static void RunImportPreview(ModelImport *import)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    stl_reader::stl_reader_impl::MappedFile file;
+    if (!file.open(import->fileName.c_str()) || stl_reader::StlBufferIsCompressed(file.data(), file.size())) return;
+
+    const bool ascii = stl_reader::StlBufferHasASCIIFormat(file.data(), file.size());
+
+    // The first samples only find the box the grid spans
+    BoundingBox box = { { INFINITY, INFINITY, INFINITY }, { -INFINITY, -INFINITY, -INFINITY } };
+    SamplePreviewTrianglesSTL(file.data(), file.size(), ascii, MESH_PREVIEW_SAMPLES, NULL, box, import->previewStop);
+    if (box.min.x > box.max.x) return;
+
+    PreviewGrid grid;
+
+    for (size_t samples = MESH_PREVIEW_SAMPLES; samples <= MESH_PREVIEW_MAX_SAMPLES; samples *= 4)
+    {
+        // Sampled corners spread over about size^2 surface cells
+        const int gridSize = std::min(std::max((int)sqrtf(samples*3/16.0f), 8), MESH_PREVIEW_GRID);
+        BoundingBox sampleBox = box;
+        InitPreviewGrid(grid, box, gridSize);
+
+        const bool complete = SamplePreviewTrianglesSTL(file.data(), file.size(), ascii, samples, &grid, sampleBox, import->previewStop);
+        if (import->previewStop) return;
+
+        Mesh *mesh = GenPreviewMesh(grid);
+        if (samples == MESH_PREVIEW_SAMPLES)
+        {
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            TraceLog(LOG_INFO, "[%s] STL preview of %i triangles after %.1f ms", import->fileName.c_str(), mesh->triangleCount, ms);
+        }
+
+        // Samples too sparse to connect any cells are not worth showing
+        if (mesh->triangleCount == 0) UnloadMeshesCPU(mesh, 1);
+        else
+        {
+            Mesh *old = import->preview.exchange(mesh, std::memory_order_acq_rel);
+            if (old != nullptr) UnloadMeshesCPU(old, 1);
+        }
+
+        if (complete) return;
+        box = sampleBox;
+    }
+}
+
+// Upload loaded meshes and build a model of them
+// NOTE: Falls back to a cube mesh when meshes is NULL, just like LoadModel()
+static Model LoadModelFromLoadedMeshes(const char *fileName, Mesh *meshes, int meshCount, bool compact)
+{
+    if (meshes == NULL)
+    {
+        TraceLog(LOG_WARNING, "[%s] No meshes can be loaded, default to cube mesh", fileName);
+        return LoadModelFromMesh(GenMeshCube(1.0f, 1.0f, 1.0f));
+    }
+
+    // Upload vertex data to GPU (static mesh)
+    for (int i = 0; i < meshCount; i++)
+    {
+        if (compact) UploadMeshCompact(&meshes[i]);
+        else rlLoadMesh(&meshes[i], false);
+    }
+
+    return LoadModelFromMeshes(meshes, meshCount);
+}
+
+// Load indexed model from stl file (welded vertices)
+// NOTE: Falls back to a cube mesh when the file can not be read, just like LoadModel()
+Model LoadModelSTL(const char *fileName, bool compact)
+{
+    int meshCount = 0;
+    Mesh *meshes = LoadMeshesSTL(fileName, &meshCount, NULL);
+
+    return LoadModelFromLoadedMeshes(fileName, meshes, meshCount, compact);
+}
+
+// Load indexed model from obj file, one or more meshes per object or group
+// NOTE: Falls back to a cube mesh when the file can not be read, just like LoadModel()
+Model LoadModelOBJ(const char *fileName, bool compact)
+{
+    int meshCount = 0;
+    Mesh *meshes = LoadMeshesOBJ(fileName, &meshCount, NULL);
+
+    return LoadModelFromLoadedMeshes(fileName, meshes, meshCount, compact);
+}
+
+// Start importing a stl or obj model on a worker thread
+// NOTE: Several imports may run at the same time. With preview, a second worker publishes coarse
+// previews of stl files meanwhile, see LoadImportPreview()
+ModelImport *ImportModelAsync(const char *fileName, bool preview)
+{
+    ModelImport *import = new ModelImport();
+    import->fileName = fileName;
+
+    const bool obj = IsFileExtension(fileName, ".obj");
+    if (preview && !obj) import->previewWorker = std::thread(RunImportPreview, import);
+
+    import->worker = std::thread([import, obj]()
+    {
+        if (obj)
+            import->meshes = LoadMeshesOBJ(import->fileName.c_str(), &import->meshCount, &import->meshParts, &import->progress);
+        else
+            import->meshes = LoadMeshesSTL(import->fileName.c_str(), &import->meshCount, &import->meshParts, &import->progress);
+        import->failed = (import->meshes == NULL);
+
+        import->previewStop = true;
+        if (import->previewWorker.joinable()) import->previewWorker.join();
+
+        // Lock-free push, the release makes the meshes visible to the thread polling
+        ModelImport *head = finishedImports.load(std::memory_order_relaxed);
+        do import->next = head;
+        while (!finishedImports.compare_exchange_weak(head, import, std::memory_order_release, std::memory_order_relaxed));
+    });
+
+    return import;
+}
+
+// Take finished imports, oldest first, linked through next
+ModelImport *PollModelImports(void)
+{
+    ModelImport *list = finishedImports.exchange(nullptr, std::memory_order_acquire);
+
+    // The queue is a stack, reverse it into finishing order
+    ModelImport *ordered = nullptr;
+
+    while (list != nullptr)
+    {
+        ModelImport *next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+    }
+
+    return ordered;
+}
+
+// Upload the latest preview of a running import as a new model (main thread only)
+// NOTE: Returns false when there is no preview newer than the one taken last
+bool LoadImportPreview(ModelImport *import, Model *model, bool compact)
+{
+    Mesh *preview = import->preview.exchange(nullptr, std::memory_order_acquire);
+    if (preview == nullptr) return false;
+
+    *model = LoadModelFromLoadedMeshes(import->fileName.c_str(), preview, 1, compact);
+
+    return true;
+}
+
+// Upload a finished import and free it (main thread only)
+// NOTE: Falls back to a cube mesh when the import failed, just like LoadModel(),
+// meshParts is freed along with the import
+Model LoadModelFromImport(ModelImport *import, bool compact)
+{
+    if (import->worker.joinable()) import->worker.join();
+
+    Model model = LoadModelFromLoadedMeshes(import->fileName.c_str(), import->meshes, import->meshCount, compact);
+
+    Mesh *preview = import->preview.exchange(nullptr);
+    if (preview != nullptr) UnloadMeshesCPU(preview, 1);
+    RL_FREE(import->meshParts);
+    delete import;
+
+    return model;
+}
+
+// Wait for an import and free it without uploading
+// NOTE: Meant for shutdown, an import still queued must not be polled afterwards
+void UnloadModelImport(ModelImport *import)
+{
+    if (import->worker.joinable()) import->worker.join();
+
+    UnloadMeshesCPU(import->meshes, import->meshCount);
+    Mesh *preview = import->preview.exchange(nullptr);
+    if (preview != nullptr) UnloadMeshesCPU(preview, 1);
+    RL_FREE(import->meshParts);
+
+    delete import;
+}
+
+#endif // MESH_IMPORT_IMPLEMENTATION
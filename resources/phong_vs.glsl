@@ -10,21 +10,42 @@ in vec4 vertexColor;
 uniform mat4 mvp;
 uniform mat4 matModel;
 
+// Compact vertices: positions are normalized to the mesh box,
+// normals are octahedral encoded in vertexNormal.xy
+uniform bool compactVertices;
+uniform vec3 quantOffset;
+uniform vec3 quantScale;
+
 // Output vertex attributes (to fragment shader)
 out vec3 fragPosition;
 out vec2 fragTexCoord;
 out vec4 fragColor;
 out vec3 fragNormal;
 
+vec3 octahedral_decode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
 void main() {
+    vec3 position = vertexPosition;
+    vec3 normal = vertexNormal;
+
+    if (compactVertices) {
+        position = quantOffset + quantScale*vertexPosition;
+        normal = octahedral_decode(vertexNormal.xy);
+    }
+
     // Send vertex attributes to fragment shader
-    fragPosition = vec3(matModel*vec4(vertexPosition, 1.0f));
+    fragPosition = vec3(matModel*vec4(position, 1.0f));
     fragTexCoord = vertexTexCoord;
     fragColor = vertexColor;
     
     mat3 normalMatrix = transpose(inverse(mat3(matModel)));
-    fragNormal = normalize(normalMatrix*vertexNormal);
+    fragNormal = normalize(normalMatrix*normal);
 
     // Calculate final vertex position
-    gl_Position = mvp*vec4(vertexPosition, 1.0);
+    gl_Position = mvp*vec4(position, 1.0);
 }
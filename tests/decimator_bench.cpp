@@ -0,0 +1,100 @@
+// Wall-clock timings of the serial and the partitioned MeshDecimator.
+// Not part of tests/run_tests, build and run from the repository root:
+//   g++ -std=c++17 -O2 -Iinclude/ -I. -pthread tests/decimator_bench.cpp mdMeshDecimator.cpp -o tests/bin/decimator_bench
+//   tests/bin/decimator_bench [file.stl ...]
+// Without arguments it times models/Base3_stn_dec.stl and two synthetic
+// height field grids. Speedups are only meaningful on as many cores as threads.
+
+#include "mdMeshDecimator.h"
+#include "stl_reader.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace MeshDecimation;
+
+struct BenchMesh {
+	std::string					name;
+	std::vector<Vec3<Float>>	points;
+	std::vector<Vec3<int>>		triangles;
+};
+
+static BenchMesh load_stl (const char* path)
+{
+	std::vector<float> coords, normals;
+	std::vector<unsigned int> tris, solids;
+	stl_reader::ReadStlFile (path, coords, normals, tris, solids);
+
+	BenchMesh mesh;
+	mesh.name = path;
+	for(size_t i = 0; i + 2 < coords.size(); i += 3)
+		mesh.points.push_back (Vec3<Float>(coords[i], coords[i + 1], coords[i + 2]));
+	for(size_t i = 0; i + 2 < tris.size(); i += 3)
+		mesh.triangles.push_back (Vec3<int>(tris[i], tris[i + 1], tris[i + 2]));
+	return mesh;
+}
+
+//	n x n quads of a smooth height field, 2 n^2 triangles
+static BenchMesh make_grid (int n)
+{
+	BenchMesh mesh;
+	mesh.name = "grid " + std::to_string (n) + "x" + std::to_string (n);
+	for(int i = 0; i <= n; ++i)
+		for(int j = 0; j <= n; ++j)
+			mesh.points.push_back (Vec3<Float>(i, j, sin (i * 0.1) * cos (j * 0.13) * 3));
+	for(int i = 0; i < n; ++i)
+		for(int j = 0; j < n; ++j){
+			const int a = i * (n + 1) + j, b = a + 1, c = a + n + 1, d = c + 1;
+			mesh.triangles.push_back (Vec3<int>(a, b, d));
+			mesh.triangles.push_back (Vec3<int>(a, d, c));
+		}
+	return mesh;
+}
+
+//	decimates to a tenth of the triangles, returns the wall-clock time in seconds
+static double time_decimation (const BenchMesh& mesh, unsigned int nThreads, size_t& nTrianglesOut)
+{
+	std::vector<Vec3<Float>> points = mesh.points;
+	std::vector<Vec3<int>> triangles = mesh.triangles;
+
+	const auto start = std::chrono::steady_clock::now();
+	MeshDecimator decimator;
+	decimator.SetNThreads (nThreads);
+	decimator.Initialize (points.size(), triangles.size(), points.data(), triangles.data());
+	decimator.Decimate (0, triangles.size() / 10, 1e30);
+	nTrianglesOut = decimator.GetNTriangles();
+	return std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+}
+
+int main (int argc, char** argv)
+{
+	std::vector<BenchMesh> meshes;
+	if(argc > 1){
+		for(int i = 1; i < argc; ++i)
+			meshes.push_back (load_stl (argv[i]));
+	}
+	else{
+		meshes.push_back (load_stl ("models/Base3_stn_dec.stl"));
+		meshes.push_back (make_grid (200));
+		meshes.push_back (make_grid (300));
+	}
+
+	const unsigned int nCores = std::thread::hardware_concurrency();
+	printf("hardware threads: %u\n", nCores);
+	for(const BenchMesh& mesh : meshes){
+		size_t nSerial = 0;
+		const double serial = time_decimation (mesh, 1, nSerial);
+		printf("%s: %zu -> %zu triangles, serial %.2f s\n", mesh.name.c_str(),
+		       mesh.triangles.size(), nSerial, serial);
+		for(unsigned int nThreads = 2; nThreads <= 8; nThreads *= 2){
+			size_t n = 0;
+			const double t = time_decimation (mesh, nThreads, n);
+			printf("  %u threads: %zu triangles, %.2f s, speedup %.2fx%s\n", nThreads, n, t,
+			       serial / t, nThreads > nCores ? " (more threads than cores)" : "");
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,112 @@
+// Regression checks for MeshDecimator, run by tests/run_tests.
+
+#include "mdMeshDecimator.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace MeshDecimation;
+
+static int failures = 0;
+
+static bool partitioned = false;
+
+static void check (bool cond, const char* what)
+{
+	if(!cond){
+		printf("FAIL: %s\n", what);
+		++failures;
+	}
+}
+
+//	Records whether Decimate went through SimplifyPartitions
+static void record_partitions (const char* msg)
+{
+	if(strncmp (msg, "+ Simplification of partitions", 30) == 0)
+		partitioned = true;
+}
+
+//	Closed UV sphere with welded poles. Nearly every vertex quadric here is
+//	close to singular, which used to turn edge costs into NaN and stall the
+//	decimation far above the target.
+static void make_sphere (int n, std::vector<Vec3<Float>>& points, std::vector<Vec3<int>>& triangles)
+{
+	const int m = n / 2;
+	points.push_back (Vec3<Float>(0, 0, 1));
+	for(int j = 1; j < m; ++j)
+		for(int i = 0; i < n; ++i){
+			const double u = 2.0 * M_PI * i / n, v = M_PI * j / m;
+			points.push_back (Vec3<Float>(cos(u) * sin(v), sin(u) * sin(v), cos(v)));
+		}
+	points.push_back (Vec3<Float>(0, 0, -1));
+	const int south = (int) points.size() - 1;
+	auto id = [&](int i, int j){ return 1 + (j - 1) * n + (i % n); };
+	for(int i = 0; i < n; ++i){
+		triangles.push_back (Vec3<int>(0, id(i, 1), id(i + 1, 1)));
+		triangles.push_back (Vec3<int>(south, id(i + 1, m - 1), id(i, m - 1)));
+	}
+	for(int j = 1; j < m - 1; ++j)
+		for(int i = 0; i < n; ++i){
+			const int a = id(i, j), b = id(i + 1, j), c = id(i + 1, j + 1), d = id(i, j + 1);
+			triangles.push_back (Vec3<int>(a, d, c));
+			triangles.push_back (Vec3<int>(a, c, b));
+		}
+}
+
+static void test_smooth_sphere (int segments, unsigned int nThreads)
+{
+	std::vector<Vec3<Float>> points;
+	std::vector<Vec3<int>> triangles;
+	make_sphere (segments, points, triangles);
+
+	const size_t target = triangles.size() / 10;
+	MeshDecimator decimator;
+	decimator.SetNThreads (nThreads);
+	decimator.SetCallBack (record_partitions);
+	partitioned = false;
+	decimator.Initialize (points.size(), triangles.size(), points.data(), triangles.data());
+	decimator.Decimate (0, target, 1e30);
+	check (decimator.GetNTriangles() <= target, "smooth_sphere: target triangle count reached");
+	check (partitioned == (nThreads > 1), "smooth_sphere: partitions used only with several threads");
+
+	std::vector<Vec3<Float>> outPoints (decimator.GetNVertices());
+	std::vector<Vec3<int>> outTriangles (decimator.GetNTriangles());
+	decimator.GetMeshData (outPoints.data(), outTriangles.data());
+	bool onSphere = true;
+	for(const Vec3<Float>& p : outPoints){
+		const double r = sqrt (p.X() * p.X() + p.Y() * p.Y() + p.Z() * p.Z());
+		onSphere = onSphere && std::isfinite (r) && fabs (r - 1.0) < 0.05;
+	}
+	check (onSphere, "smooth_sphere: vertices stay finite and on the sphere");
+}
+
+//	A set stop flag ends decimation before the first collapse, on partitions too
+static void test_stop_flag (int segments, unsigned int nThreads)
+{
+	std::vector<Vec3<Float>> points;
+	std::vector<Vec3<int>> triangles;
+	make_sphere (segments, points, triangles);
+
+	const std::atomic<bool> stop (true);
+	MeshDecimator decimator;
+	decimator.SetNThreads (nThreads);
+	decimator.SetStopFlag (&stop);
+	decimator.SetCallBack (record_partitions);
+	partitioned = false;
+	decimator.Initialize (points.size(), triangles.size(), points.data(), triangles.data());
+	decimator.Decimate (0, triangles.size() / 10, 1e30);
+	check (decimator.GetNTriangles() == triangles.size(), "stop_flag: no triangle collapsed");
+	check (partitioned == (nThreads > 1), "stop_flag: partitions used only with several threads");
+}
+
+int main ()
+{
+	//	67080 triangles, enough for three partitions of MD_MIN_PARTITION_TRIANGLES
+	test_smooth_sphere (120, 1);
+	test_smooth_sphere (260, 3);
+	test_stop_flag (120, 1);
+	test_stop_flag (260, 3);
+	printf("decimator_tests: %s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
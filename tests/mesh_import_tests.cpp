@@ -0,0 +1,58 @@
+// Regression checks for mesh_import.h, run by tests/run_tests.
+// Links against raylib like the animator.
+
+#define MESH_IMPORT_IMPLEMENTATION
+#define MESH_IMPORT_NO_CACHE
+#include "mesh_import.h"
+
+#include <cmath>
+#include <cstdio>
+
+static int failures = 0;
+
+static void check (bool cond, const char* what)
+{
+	if(!cond){
+		printf("FAIL: %s\n", what);
+		++failures;
+	}
+}
+
+//	Fan around the origin: a vertical triangle first, then four flat ones out
+//	of fan order. Groups of the flat corners used to be rooted at a later
+//	corner, and one flat corner took the split vertex of the vertical triangle.
+static void test_crease_fan_out_of_order ()
+{
+	float vertices[] = { 0, 0, 0,  1, 0, 0,  0, 1, 0,  -1, 0, 0,  0, -1, 0,  1, 0, 1 };
+	unsigned int indices[] = { 0, 5, 1,  0, 3, 4,  0, 1, 2,  0, 4, 1,  0, 2, 3 };
+
+	int meshCount = 0;
+	Mesh *meshes = GenMeshesIndexed (vertices, 6, indices, 5, &meshCount);
+	check (meshCount == 1, "crease_fan_out_of_order: one mesh");
+	if(meshCount != 1) return;
+
+	const Mesh &mesh = meshes[0];
+	bool smooth = true;
+	for(int t = 0; t < mesh.triangleCount; ++t){
+		const unsigned short *tri = &mesh.indices[t*3];
+		const float *a = &mesh.vertices[tri[0]*3], *b = &mesh.vertices[tri[1]*3], *c = &mesh.vertices[tri[2]*3];
+
+	//	flat triangles have all corners at z = 0, their normals must be exactly up
+		if((a[2] != 0) || (b[2] != 0) || (c[2] != 0)) continue;
+		for(int k = 0; k < 3; ++k)
+			smooth = smooth && (mesh.normals[tri[k]*3 + 2] > 0.999f);
+	}
+	check (smooth, "crease_fan_out_of_order: flat triangles keep their normal");
+	check (mesh.vertexCount == 8, "crease_fan_out_of_order: origin split in two");
+
+	for(int i = 0; i < meshCount; ++i)
+		UnloadMesh (meshes[i]);
+	RL_FREE(meshes);
+}
+
+int main ()
+{
+	test_crease_fan_out_of_order ();
+	printf("mesh_import_tests: %s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
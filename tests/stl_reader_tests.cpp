@@ -0,0 +1,125 @@
+// Regression checks for stl_reader.h, run by tests/run_tests.
+// Build with -fsanitize=thread to catch races in the compressed reader.
+
+#include "stl_reader.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void check (bool cond, const char* what)
+{
+	if(!cond){
+		printf("FAIL: %s\n", what);
+		++failures;
+	}
+}
+
+//	zlib binary STL with 10490 identical triangles followed by 4000 bytes of
+//	garbage records. The inflater used to grow its output buffer past the
+//	binary size while the triangles were being decoded from it.
+static void test_binary_trailing_bytes (const char* dataDir)
+{
+	const std::string path = std::string(dataDir) + "/binary_trailing_bytes.stl.z";
+	for(int i = 0; i < 16; ++i){
+		std::vector<float> coords, normals;
+		std::vector<unsigned int> tris, solids;
+		stl_reader::ReadStlFile (path.c_str(), coords, normals, tris, solids);
+		check (tris.size() == 10490 * 3, "binary_trailing_bytes: triangle count");
+		check (normals.size() == 10490 * 3, "binary_trailing_bytes: normal count");
+	}
+}
+
+//	Two triangles with corners 0.9 epsilon apart in neighbouring weld cells.
+//	They used to be merged in one file order but not in the other, since only
+//	the neighbour cells towards the closer borders were searched.
+static void test_weld_order_independent ()
+{
+	const char* triA = "facet normal 1 0 0\nouter loop\n"
+	                   "vertex 0.3 0 0\nvertex 0.3 10 0\nvertex 0.3 0 10\n"
+	                   "endloop\nendfacet\n";
+	const char* triB = "facet normal 1 0 0\nouter loop\n"
+	                   "vertex 1.2 0 0\nvertex 1.2 0 -10\nvertex 1.2 -10 0\n"
+	                   "endloop\nendfacet\n";
+
+	for(int lowMemory = 0; lowMemory < 2; ++lowMemory){
+		for(int order = 0; order < 2; ++order){
+			const std::string file = std::string("solid weld\n") + (order ? triB : triA)
+			                         + (order ? triA : triB) + "endsolid weld\n";
+
+			stl_reader::ReadOptions options;
+			options.weldMode = stl_reader::WELD_HASH;
+			options.weldEpsilon = 1;
+			options.lowMemory = lowMemory != 0;
+
+			std::vector<float> coords, normals;
+			std::vector<unsigned int> tris, solids;
+			stl_reader::ReadStlBuffer (file.data(), file.size(), coords, normals, tris, solids, options);
+			check (coords.size() == 5 * 3, lowMemory ? "weld_order_independent: low memory"
+			                                         : "weld_order_independent");
+		}
+	}
+}
+
+static std::string read_file (const std::string& path)
+{
+	std::ifstream in (path.c_str(), std::ios::binary);
+	return std::string (std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static bool read_fails (const std::string& buffer)
+{
+	std::vector<float> coords, normals;
+	std::vector<unsigned int> tris, solids;
+	try{
+		stl_reader::ReadStlBuffer (buffer.data(), buffer.size(), coords, normals, tris, solids);
+	}
+	catch(std::runtime_error&){
+		return true;
+	}
+	return false;
+}
+
+//	Corrupted compressed files which still inflate without error. Only the
+//	gzip CRC-32 and size or the zlib Adler-32 tell them apart.
+static void test_compressed_checksums (const char* dataDir)
+{
+//	gzip with a stored block, so that changing a coordinate keeps the stream valid
+	const std::string gz = read_file (std::string(dataDir) + "/ascii_stored.stl.gz");
+	check (!read_fails (gz), "compressed_checksums: intact gzip file");
+
+	std::string corrupt = gz;
+	corrupt[corrupt.find ("vertex 1") + 7] = '2';
+	check (read_fails (corrupt), "compressed_checksums: gzip CRC-32");
+
+	corrupt = gz;
+	corrupt[corrupt.size() - 4] ^= 1;
+	check (read_fails (corrupt), "compressed_checksums: gzip size");
+
+//	the trailing bytes of this file are behind the inflate limit of its triangles
+	const std::string z = read_file (std::string(dataDir) + "/binary_trailing_bytes.stl.z");
+	check (!read_fails (z), "compressed_checksums: intact zlib file");
+
+	corrupt = z;
+	corrupt[corrupt.size() - 1] ^= 1;
+	check (read_fails (corrupt), "compressed_checksums: zlib Adler-32");
+}
+
+int main (int argc, char** argv)
+{
+	const char* dataDir = argc > 1 ? argv[1] : "tests/data";
+	try{
+		test_binary_trailing_bytes (dataDir);
+		test_weld_order_independent ();
+		test_compressed_checksums (dataDir);
+	}
+	catch(std::exception& e){
+		printf("FAIL: %s\n", e.what());
+		++failures;
+	}
+	printf("stl_reader_tests: %s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
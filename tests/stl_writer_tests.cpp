@@ -0,0 +1,53 @@
+// Regression checks for stl_writer.h, run by tests/run_tests.
+
+#include "stl_writer.h"
+#include <cstdio>
+#include <vector>
+
+static int failures = 0;
+
+static void check (bool cond, const char* what)
+{
+	if(!cond){
+		printf("FAIL: %s\n", what);
+		++failures;
+	}
+}
+
+//	Index container claiming more triangles than a binary file can count,
+//	without storing them. The writer must refuse it before reading indices.
+struct HugeIndices {
+	typedef unsigned int value_type;
+	size_t size () const					{return 3 * (size_t(0xFFFFFFFF) + 1);}
+	unsigned int operator [] (size_t) const	{return 0;}
+};
+
+static void test_binary_triangle_count_overflow ()
+{
+	const std::vector<float> coords (9, 0.f), normals;
+	bool thrown = false;
+	try{
+		std::vector<char> buffer;
+		stl_writer::WriteStlBuffer_BINARY (buffer, coords, normals, HugeIndices());
+	}
+	catch(std::runtime_error&){
+		thrown = true;
+	}
+	check (thrown, "binary_triangle_count_overflow: buffer");
+
+	thrown = false;
+	try{
+		stl_writer::WriteStlFile ("tests/bin/overflow.stl", coords, normals, HugeIndices());
+	}
+	catch(std::runtime_error&){
+		thrown = true;
+	}
+	check (thrown, "binary_triangle_count_overflow: file");
+}
+
+int main ()
+{
+	test_binary_triangle_count_overflow ();
+	printf("stl_writer_tests: %s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}